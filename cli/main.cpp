@@ -1,21 +1,130 @@
 #include "data_access_layer.h"
 #include "collection.h"
+#include "transaction.h"
 #include "utils.h"
+#include <algorithm>
+#include <fstream>
 
 using namespace toocal::core;
 using namespace toocal::core::data_access_layer;
 using namespace toocal::core::collection;
 using namespace toocal::core::page;
 
+/** The collection called name in the catalog of dal, created if there is
+ ** none. */
+static auto _open_collection(Data_access_layer & dal, const std::string & name)
+  -> collection::Collection *
+{
+  const auto key = std::vector<uint8_t>{name.begin(), name.end()};
+  return dal.get_collection(key)
+    .and_then([&](const auto && collection) -> tl::expected<collection::Collection *, Error> {
+      if (collection != nullptr)
+        return collection;
+      return dal.create_collection(key);
+    })
+    .map_error([&](const auto && error) { return error.panic(); })
+    .value();
+}
+
+/** toocal bulk-load <database> <collection> <input>: load the tab separated
+ ** key value lines of input into the collection with Collection::bulk_load,
+ ** the collection is created if it does not exist and must be empty. */
+static auto bulk_load(const std::string & path, const std::string & name, const std::string & input)
+  -> int
+{
+  auto file = std::ifstream{input};
+  if (!file.is_open())
+    fatal(fmt::format("unable to open {}", input));
+
+  auto items = std::vector<node::Item>{};
+  for (std::string line; std::getline(file, line);)
+    {
+      const auto separator = line.find('\t');
+      if (separator == std::string::npos)
+        fatal(fmt::format("{}: expected a tab separated key and value: {}", input, line));
+
+      items.push_back(node::Item{
+        {line.begin(), line.begin() + static_cast<int64_t>(separator)},
+        {line.begin() + static_cast<int64_t>(separator) + 1, line.end()}});
+    }
+
+  std::ranges::sort(items, [](const auto & a, const auto & b) {
+    return utils::Safecmp::bytescmp(a.key, b.key) < 0;
+  });
+
+  auto       dal = Data_access_layer{path};
+  const auto collection = _open_collection(dal, name);
+
+  spdlog::info("bulk loading {} items into {} of {}", items.size(), name, dal.path);
+  const auto start_time = std::chrono::high_resolution_clock::now();
+  {
+    /* The catalog records the root when the transaction commits. */
+    auto transaction = transaction::Transaction{&dal};
+    collection->bulk_load(items.begin(), items.end())
+      .and_then([&](const auto && _) { return transaction.commit(); })
+      .map_error([&](const auto && error) { return error.panic(); });
+  }
+  const auto end_time = std::chrono::high_resolution_clock::now();
+
+  dal.close();
+  spdlog::info(
+    "bulk loading completed, spend {}ms, {}KB",
+    std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count(),
+    utils::Filesystem::sizeof_file(dal.path));
+
+  return 0;
+}
+
+/** toocal compact <database> <collection>: rewrite the collection with
+ ** collection::Compaction and truncate the file. */
+static auto compact(const std::string & path, const std::string & name) -> int
+{
+  auto       dal = Data_access_layer{path};
+  const auto collection =
+    dal.get_collection(std::vector<uint8_t>{name.begin(), name.end()})
+      .map_error([&](const auto && error) { return error.panic(); })
+      .value();
+  if (collection == nullptr)
+    fatal(fmt::format("{} has no collection {}", dal.path, name));
+
+  const auto size = utils::Filesystem::sizeof_file(dal.path);
+  const auto start_time = std::chrono::high_resolution_clock::now();
+  auto       compaction = Compaction{collection};
+  compaction.run().map_error([&](const auto && error) { return error.panic(); });
+  const auto end_time = std::chrono::high_resolution_clock::now();
+
+  dal.close();
+  spdlog::info(
+    "compaction completed, spend {}ms, {}KB to {}KB",
+    std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count(),
+    size,
+    utils::Filesystem::sizeof_file(dal.path));
+
+  return 0;
+}
+
 int main(int argc, char ** argv)
 {
+  if (argc > 1 && std::string{argv[1]} == "bulk-load")
+    {
+      if (argc != 5)
+        fatal("usage: toocal bulk-load <database> <collection> <input>");
+      return bulk_load(argv[2], argv[3], argv[4]);
+    }
+
+  if (argc > 1 && std::string{argv[1]} == "compact")
+    {
+      if (argc != 4)
+        fatal("usage: toocal compact <database> <collection>");
+      return compact(argv[2], argv[3]);
+    }
+
   const auto data_size = 1000;
   const auto collection_name = std::string{"collection1"};
 
   auto dal = Data_access_layer{"cli.db"};
 
-  auto collection = Collection{
-    &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, dal.meta.root};
+  auto &collection = *_open_collection(dal, collection_name);
 
   std::string keys[data_size], values[data_size];
 
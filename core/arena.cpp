@@ -0,0 +1,52 @@
+#include "arena.h"
+#include <algorithm>
+#include <numeric>
+
+namespace toocal::core::arena
+{
+  [[nodiscard]] auto Arena::allocate(const size_t size, const size_t alignment) -> void *
+  {
+    /* The current chunk, then the free ones after it. A chunk large enough
+     * is inserted when none of them has room. */
+    for (; this->chunk < this->chunks.size(); this->chunk++, this->used = 0)
+      {
+        const auto &chunk = this->chunks[this->chunk];
+        const auto  start = (this->used + alignment - 1) / alignment * alignment;
+        if (start + size <= chunk.size)
+          {
+            this->used = start + size;
+            return chunk.data.get() + start;
+          }
+      }
+
+    const auto chunk_size = std::max(this->chunk_size, size);
+    this->chunks.push_back(Chunk{std::make_unique<std::byte[]>(chunk_size), chunk_size});
+    this->chunk = this->chunks.size() - 1;
+    this->used = size;
+    return this->chunks.back().data.get();
+  }
+
+  [[nodiscard]] auto Arena::copy(const std::span<const uint8_t> bytes) -> std::span<const uint8_t>
+  {
+    const auto copy = this->allocate<uint8_t>(bytes.size());
+    std::copy(bytes.begin(), bytes.end(), copy.begin());
+    return copy;
+  }
+
+  [[nodiscard]] auto Arena::size() const noexcept -> size_t
+  {
+    return std::accumulate(
+      this->chunks.begin(),
+      this->chunks.begin() + std::min(this->chunk, this->chunks.size()),
+      this->chunk < this->chunks.size() ? this->used : 0,
+      [](const size_t size, const auto &chunk) { return size + chunk.size; });
+  }
+
+  [[nodiscard]] auto Arena::capacity() const noexcept -> size_t
+  {
+    return std::accumulate(
+      this->chunks.begin(), this->chunks.end(), size_t{0}, [](const size_t size, const auto &chunk) {
+        return size + chunk.size;
+      });
+  }
+} // namespace toocal::core::arena
@@ -0,0 +1,93 @@
+#ifndef TOOCAL_CORE_ARENA_H
+#define TOOCAL_CORE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace toocal::core::arena
+{
+  /** Arena hands out memory from a few large chunks and frees it all at
+   ** once, at the end of the operation that used it. The chunks are kept
+   ** for the next operations, so once they are allocated an operation
+   ** working in the arena does not allocate anymore. Only trivially
+   ** destructible objects are allocated in it, they are never destroyed. */
+  class Arena
+  {
+  public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    /** Scope frees what was allocated in the arena since it was created when
+     ** it is destroyed. Scopes nest, the memory of the outer scope stays. */
+    class Scope
+    {
+    public:
+      explicit Scope(Arena &arena) noexcept
+        : arena(arena), chunk(arena.chunk), used(arena.used)
+      {}
+
+      ~Scope()
+      {
+        this->arena.chunk = this->chunk;
+        this->arena.used = this->used;
+      }
+
+      Scope(const Scope &) = delete;
+      Scope(Scope &&) = delete;
+
+    private:
+      Arena &arena;
+      size_t chunk;
+      size_t used;
+    };
+
+    explicit Arena(const size_t chunk_size = CHUNK_SIZE) : chunk_size(chunk_size) {}
+
+    /* The spans handed out point into the chunks. */
+    Arena(const Arena &) = delete;
+    Arena(Arena &&) = delete;
+
+    /** count value initialized Tp_object, valid until the end of the scope
+     ** they were allocated in. */
+    template <typename Tp_object> [[nodiscard]] auto allocate(const size_t count) -> std::span<Tp_object>
+    {
+      static_assert(std::is_trivially_destructible_v<Tp_object>);
+
+      auto *objects = static_cast<Tp_object *>(this->allocate(count * sizeof(Tp_object), alignof(Tp_object)));
+      std::uninitialized_value_construct_n(objects, count);
+      return {objects, count};
+    }
+
+    /** A copy of bytes in the arena. */
+    [[nodiscard]] auto copy(std::span<const uint8_t> bytes) -> std::span<const uint8_t>;
+
+    /** The bytes of the chunks in use, up to the last byte handed out. */
+    [[nodiscard]] auto size() const noexcept -> size_t;
+
+    /** The bytes of the chunks. */
+    [[nodiscard]] auto capacity() const noexcept -> size_t;
+
+  private:
+    class Chunk
+    {
+    public:
+      std::unique_ptr<std::byte[]> data;
+      size_t                       size;
+    };
+
+    const size_t       chunk_size;
+    std::vector<Chunk> chunks;
+
+    /** The chunk allocated from and the bytes used in it, the chunks after
+     ** it are free. */
+    size_t chunk{};
+    size_t used{};
+
+    [[nodiscard]] auto allocate(size_t size, size_t alignment) -> void *;
+  };
+} // namespace toocal::core::arena
+
+#endif /* TOOCAL_CORE_ARENA_H */
@@ -1,31 +1,163 @@
 #include "collection.h"
+#include "arena.h"
+#include "cursor.h"
 #include "data_access_layer.h"
 #include "errors.hpp"
 #include "node.h"
 #include "page.h"
+#include "transaction.h"
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <vector>
 #include "tl/expected.hpp"
 #include "utils.h"
 
 namespace toocal::core::collection
 {
-  [[nodiscard]] auto Collection::find(std::vector<uint8_t> key) const noexcept
+  [[nodiscard]] auto Collection::find(const std::vector<uint8_t> &key) const noexcept
     -> tl::expected<tl::optional<node::Item>, Error>
   {
-    return this->dal->get_node(this->root)
-      .and_then([&](const auto &node) { return node.find_key(key, true); })
-      .map([&](const auto &result) -> tl::optional<node::Item> {
-        const auto [index, containing_node, _] = result;
-        if (-1 == index)
+    /* Descend with Node_view, the pages are searched in place and only the
+     * found item is copied out. */
+    if (0 == this->root)
+      return tl::nullopt;
+
+    auto page_num = this->root;
+
+    while (true)
+      {
+        const auto data = this->dal->view_page(page_num);
+        if (!data.has_value())
+          return tl::make_unexpected(data.error());
+
+        const auto node = node::Node_view{data.value()};
+        const auto [was_found, index] = node.find_key_in_node(key);
+
+        if (!node.is_leaf())
+          {
+            page_num = node.child(Node::child_index(was_found, index));
+            continue;
+          }
+
+        if (!was_found)
           return tl::nullopt;
-        return containing_node->items[index];
-      });
+
+        /* The value is only read from its overflow chain once found. */
+        auto item = node.item(index);
+        return this->dal->load_value(item).map(
+          [&](const auto &&_) { return tl::optional<node::Item>{std::move(item)}; });
+      }
+  }
+
+  [[nodiscard]] auto Collection::find_many(const std::span<const std::vector<uint8_t>> keys) const noexcept
+    -> tl::expected<std::vector<tl::optional<node::Item>>, Error>
+  {
+    auto items = std::vector<tl::optional<node::Item>>(keys.size());
+    if (0 == this->root || keys.empty())
+      return items;
+
+    /* The indexes of keys in key order. */
+    auto order = std::vector<uint32_t>(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::sort(order, [&](const auto left, const auto right) {
+      return utils::Safecmp::bytescmp(keys[left], keys[right]) < 0;
+    });
+
+    /* The pages left to read with the range of order leading to each, the
+     * leftmost on top. The ranges of the children are taken before the
+     * first child is read, the page of a view may be read over by it. */
+    class Range
+    {
+    public:
+      page::Page_num page_num;
+      size_t         first;
+      size_t         last;
+    };
+
+    auto ranges = std::vector<Range>{{this->root, 0, order.size()}};
+    auto children = std::vector<Range>{};
+    auto found = std::vector<uint32_t>{};
+
+    while (!ranges.empty())
+      {
+        const auto [page_num, first, last] = ranges.back();
+        ranges.pop_back();
+
+        const auto data = this->dal->view_page(page_num);
+        if (!data.has_value())
+          return tl::make_unexpected(data.error());
+
+        const auto node = node::Node_view{data.value()};
+
+        if (!node.is_leaf())
+          {
+            /* The keys are sorted, so are their children. */
+            children.clear();
+            for (auto i = first; i < last; i++)
+              {
+                const auto [was_found, index] = node.find_key_in_node(keys[order[i]]);
+                const auto child = node.child(Node::child_index(was_found, index));
+                if (children.empty() || children.back().page_num != child)
+                  children.push_back(Range{child, i, i + 1});
+                else
+                  children.back().last = i + 1;
+              }
+
+            ranges.insert(ranges.end(), children.rbegin(), children.rend());
+            continue;
+          }
+
+        /* The values are only read from their overflow chains once the items
+         * are copied out of the leaf. */
+        found.clear();
+        for (auto i = first; i < last; i++)
+          if (const auto [was_found, index] = node.find_key_in_node(keys[order[i]]); was_found)
+            {
+              items[order[i]] = node.item(index);
+              found.push_back(order[i]);
+            }
+
+        for (const auto i : found)
+          if (auto result = this->dal->load_value(items[i].value()); !result.has_value())
+            return tl::make_unexpected(result.error());
+      }
+
+    return items;
   }
 
   [[nodiscard]] auto Collection::put(std::vector<uint8_t> key, std::vector<uint8_t> value) noexcept
     -> tl::expected<std::nullptr_t, Error>
   {
-    const auto item = node::Item{std::move(key), std::move(value)};
+    return this->in_transaction([&] {
+      this->changes++;
+      return this->insert(node::Item{std::move(key), std::move(value)});
+    });
+  }
+
+  /** With Options::copy_on_write, have the active transaction copy the nodes
+   ** of path when it commits, see transaction::Transaction::record. */
+  static auto _record(data_access_layer::Data_access_layer *dal, const Path &path) noexcept -> void
+  {
+    if (dal->options.copy_on_write && dal->transaction != nullptr)
+      for (const auto &node : path.nodes)
+        dal->transaction->record(node.page_num);
+  }
+
+  [[nodiscard]] auto Collection::insert(node::Item item) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (item.key.size() > this->dal->max_key_size())
+      return Err(fmt::format(
+        "the key of {} bytes is larger than the maximum of {} bytes",
+        item.key.size(),
+        this->dal->max_key_size()));
+
+    if (auto result = this->dal->store_value(item); !result.has_value())
+      return result;
 
     /* On first insertion the root node does not exist,
      * so it should be created. */
@@ -41,152 +173,1170 @@ namespace toocal::core::collection
         });
       }
 
-    this->dal->get_node(this->root)
-      .map([&](const auto &exist_root) { root = exist_root; })
-      .map_error([&](auto &&error) {
-        error.append("get_node error in Collection::put");
-        return error.panic();
-      });
+    auto in_leaf = this->insert_in_leaf(item);
+    if (!in_leaf.has_value())
+      return tl::make_unexpected(in_leaf.error());
+    else if (in_leaf.value() == tl::nullopt)
+      return nullptr;
 
-    /* Find the path to the node where the insertion should happen */
-    return root.find_key(item.key, false).and_then([&](auto &&result) {
-      auto &[insertion_index, node_to_insertin, ancestors_indexes] = result;
+    auto &path = in_leaf.value().value();
+    _record(this->dal, path);
 
-      /* If key already exists */
-      if (
-        node_to_insertin.has_value() && !node_to_insertin->items.empty()
-        && 0 == utils::Safecmp::bytescmp(node_to_insertin.value().items[insertion_index].key, key))
-        node_to_insertin->items.insert(node_to_insertin->items.begin() + insertion_index, item);
+    /* If key already exists, replace its value and release the overflow
+     * chain of the previous one. */
+    auto &leaf = path.leaf();
+    if (path.was_found)
+      {
+        if (const auto &previous = leaf.items[path.index]; previous.is_overflow())
+          if (auto result = this->dal->delete_overflow(previous.overflow, previous.overflow_size);
+              !result.has_value())
+            return result;
+
+        leaf.items[path.index] = item;
+      }
 
-      else /* Add item to the leaf node */
-        node_to_insertin.value().add_item(item, insertion_index);
+    else /* Add item to the leaf node */
+      leaf.add_item(item, path.index);
 
-      node_to_insertin.value().dal->write_node(node_to_insertin.value()).map_error([&](auto &&error) {
+    /* An over populated leaf may not fit in a page, it is only written
+     * once split. */
+    if (!leaf.is_over_populated())
+      this->dal->write_node(leaf).map_error([&](auto &&error) {
         error.append("write_node error in Collection::put");
         return error.panic();
       });
 
-      return this->get_nodes(ancestors_indexes).map([&](auto &&ancestors) {
-        /* Rebalanced the nodes all the way up. Start From one node before
-         * the last and go all the way up. Exclude root. */
-        for (auto i = static_cast<int64_t>(ancestors.size() - 2); i >= 0; i--)
+    /* Rebalanced the nodes all the way up. Start From one node before
+     * the last and go all the way up. Exclude root. The ancestors are
+     * split in place, so a split parent is seen by the next iteration. */
+    auto &ancestors = path.nodes;
+    for (auto i = static_cast<int64_t>(ancestors.size() - 2); i >= 0; i--)
+      {
+        auto &previous_node = ancestors[i];
+
+        if (auto &node = ancestors[i + 1]; node.is_over_populated())
+          previous_node.split(node, path.indexes[i + 1]);
+      }
+
+    /* Handle root */
+    if (auto &root_node = ancestors[0]; root_node.is_over_populated())
+      {
+        auto new_root = this->dal->new_node({}, {root_node.page_num}, root_node.page_num);
+        new_root.split(root_node, 0);
+
+        /* commit newly created root */
+        this->dal->write_node(new_root)
+          .map([&](const auto &&_) { this->root = new_root.page_num; })
+          .map_error([&](auto &&error) {
+            error.append("write_node error in Collection::put");
+            return error.panic();
+          });
+      }
+
+    return nullptr;
+  }
+
+  /** A node decoded from data, the page page_num. */
+  static auto _decode(
+    data_access_layer::Data_access_layer *dal,
+    const page::Page_num                  page_num,
+    const std::span<const uint8_t>        data) noexcept -> tl::expected<Node, Error>
+  {
+    auto node = types::Serializer<Node>::deserialize(data);
+    if (node.has_value())
+      {
+        node->dal = dal;
+        node->page_num = page_num;
+      }
+    return node;
+  }
+
+  /** An internal node of the descent of Collection::insert_in_leaf, in the
+   ** arena: the page, the child descended into and the level above. */
+  class Descent
+  {
+  public:
+    page::Page_num           page_num;
+    std::span<const uint8_t> data;
+    uint32_t                 index;
+    const Descent           *parent;
+  };
+
+  [[nodiscard]] auto Collection::insert_in_leaf(const node::Item &item) noexcept
+    -> tl::expected<tl::optional<Path>, Error>
+  {
+    auto      &arena = this->dal->arena;
+    const auto scope = arena::Arena::Scope{arena};
+
+    /* The page a view points into may be read over by the next read, the
+     * internal pages are copied in case the leaf has to be split. */
+    const Descent *descent = nullptr;
+
+    for (auto page_num = this->root;;)
+      {
+        const auto data = this->dal->view_page(page_num);
+        if (!data.has_value())
+          return tl::make_unexpected(data.error());
+
+        const auto node = node::Node_view{data.value()};
+        const auto [was_found, index] = node.find_key_in_node(item.key);
+
+        if (!node.is_leaf())
+          {
+            auto &level = arena.allocate<Descent>(1).front();
+            level = Descent{page_num, arena.copy(data.value()), Node::child_index(was_found, index), descent};
+            descent = &level;
+            page_num = node.child(level.index);
+            continue;
+          }
+
+        /* The items of the leaf, with item replacing the one of the same key
+         * or inserted at its position. */
+        const auto items_count = node.items_count();
+        const auto items = arena.allocate<node::Item_view>(items_count + (was_found ? 0 : 1));
+        for (uint32_t i = 0; i < items_count; i++)
+          items[was_found || i < index ? i : i + 1] = node.item_view(i, arena);
+
+        const auto previous = items[index];
+        items[index] = node::Item_view{item};
+
+        /* The path is decoded from the leaf, which is still in its page, and
+         * the copies of the internal pages. */
+        if (this->dal->is_over_populated(items))
           {
-            auto previous_node = ancestors[i];
+            auto path = Path{};
+            path.was_found = was_found;
+            path.index = index;
+
+            if (auto leaf = _decode(this->dal, page_num, data.value()); !leaf.has_value())
+              return tl::make_unexpected(leaf.error());
+            else
+              path.nodes.push_front(std::move(leaf.value()));
+
+            for (; descent != nullptr; descent = descent->parent)
+              {
+                path.indexes.push_front(descent->index);
+                if (auto ancestor = _decode(this->dal, descent->page_num, descent->data); !ancestor.has_value())
+                  return tl::make_unexpected(ancestor.error());
+                else
+                  path.nodes.push_front(std::move(ancestor.value()));
+              }
 
-            if (auto node = ancestors[i + 1]; node.is_over_populated())
-              previous_node.split(node, ancestors_indexes[i + 1]);
+            path.indexes.push_front(/* index of root */ 0);
+            return path;
           }
 
-        /* Handle root */
-        if (auto &root_node = ancestors[0]; root_node.is_over_populated())
+        /* The values of the items point into the page of the leaf, it is
+         * only overwritten once they are copied. */
+        const auto buffer = arena.allocate<uint8_t>(this->dal->options.page_size);
+        if (auto result = types::Serializer<Node>::serialize(items, node.prev(), node.next(), page_num, buffer);
+            !result.has_value())
+          return tl::make_unexpected(result.error());
+
+        if (was_found && previous.is_overflow())
+          if (auto result = this->dal->delete_overflow(previous.overflow, previous.overflow_size);
+              !result.has_value())
+            return tl::make_unexpected(result.error());
+
+        if (this->dal->options.copy_on_write && this->dal->transaction != nullptr)
           {
-            auto new_root = this->dal->new_node({}, {root_node.page_num});
-            new_root.split(root_node, 0);
+            this->dal->transaction->record(page_num);
+            for (auto *level = descent; level != nullptr; level = level->parent)
+              this->dal->transaction->record(level->page_num);
+          }
+
+        return this->dal->write_page(page_num, buffer).map([](const auto &&_) { return tl::optional<Path>{}; });
+      }
+  }
+
+  /** Whether node is filled past threshold or does not fit in a page anymore.
+   ** An internal node lacks its last child, room is kept for it. */
+  static auto _is_full(
+    const data_access_layer::Data_access_layer *dal, const Node &node, const float threshold) noexcept
+    -> bool
+  {
+    const auto last_child = node.children.empty() ? 0 : sizeof(page::Page_num);
+    return node.items.size() > 1
+           && (static_cast<float>(node.size()) > threshold
+               || node.serialized_size() + last_child > dal->options.page_size);
+  }
+
+  /** The index of the separator after every node but the last one when items
+   ** are packed into nodes filled up to threshold bytes, see _bulk_load_level.
+   ** For an internal level, children holds one more page than items. */
+  static auto _split_ends(
+    const data_access_layer::Data_access_layer *dal,
+    const std::vector<node::Item>              &items,
+    const std::vector<page::Page_num>          &children,
+    const float                                 threshold) noexcept -> std::vector<size_t>
+  {
+    const auto is_leaf = children.empty();
+
+    /* Once a node is full, the next item starts the next leaf, or becomes
+     * the separator of an internal node. */
+    auto ends = std::vector<size_t>{};
+    auto candidate = Node{};
 
-            /* commit newly created root */
-            this->dal->write_node(new_root)
-              .map([&](const auto &&_) { this->root = new_root.page_num; })
-              .map_error([&](auto &&error) {
-                error.append("write_node error in Collection::put");
-                return error.panic();
-              });
+    for (size_t i = 0; i < items.size(); i++)
+      {
+        candidate.items.push_back(items[i]);
+        if (!is_leaf)
+          candidate.children.push_back(children[i]);
+
+        if (_is_full(dal, candidate, threshold))
+          {
+            ends.push_back(i);
+            candidate.items.clear();
+            candidate.children.clear();
+            if (is_leaf)
+              candidate.items.push_back(items[i]);
           }
+      }
+
+    /* An internal separator must not be the last item, the last node would be
+     * empty. Move it one item to the left, or merge the last two nodes if that
+     * would empty the node before it. */
+    if (!is_leaf && !ends.empty() && ends.back() == items.size() - 1)
+      {
+        const auto begin = ends.size() > 1 ? ends[ends.size() - 2] + 1 : 0;
+        if (begin < items.size() - 2)
+          ends.back()--;
+        else
+          ends.pop_back();
+      }
+
+    return ends;
+  }
+
+  /** Pack one level of the tree built by Collection::bulk_load. items are
+   ** split into nodes filled up to threshold bytes. Between two leaves the
+   ** shortest key separating them is copied up as a separator, see
+   ** Node::separator, between two internal nodes the item is moved up. For
+   ** an internal level, children holds one more page than items. The nodes
+   ** are written from left to right, the leaves linked in that order, and
+   ** their pages and the separators form the next level. */
+  static auto _bulk_load_level(
+    data_access_layer::Data_access_layer *dal,
+    std::vector<node::Item>             &&items,
+    const std::vector<page::Page_num>    &children,
+    std::vector<node::Item>              &separators,
+    std::vector<page::Page_num>          &pages,
+    const float                           threshold) noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    const auto is_leaf = children.empty();
+    const auto ends = _split_ends(dal, items, children, threshold);
+
+    /* The pages are taken first, so every leaf is written once with both
+     * of its links. */
+    auto nodes = std::vector<Node>{};
+    nodes.reserve(ends.size() + 1);
+    for (size_t node_index = 0, begin = 0; node_index <= ends.size(); node_index++)
+      {
+        const auto end = node_index < ends.size() ? ends[node_index] : items.size();
 
-        return nullptr;
+        if (node_index < ends.size())
+          separators.push_back(
+            is_leaf ? node::Item{Node::separator(items[end - 1].key, items[end].key), {}}
+                    : std::move(items[end]));
+
+        nodes.push_back(dal->new_node(
+          std::deque<node::Item>{
+            std::make_move_iterator(items.begin() + begin), std::make_move_iterator(items.begin() + end)},
+          is_leaf ? std::deque<page::Page_num>{}
+                  : std::deque<page::Page_num>{children.begin() + begin, children.begin() + end + 1},
+          nodes.empty() ? page::Page_num{0} : nodes.back().page_num));
+
+        begin = is_leaf ? end : end + 1;
+      }
+
+    for (size_t node_index = 0; node_index < nodes.size(); node_index++)
+      {
+        auto &node = nodes[node_index];
+        if (is_leaf && node_index > 0)
+          node.prev = nodes[node_index - 1].page_num;
+        if (is_leaf && node_index + 1 < nodes.size())
+          node.next = nodes[node_index + 1].page_num;
+
+        if (auto result = dal->write_node(node); !result.has_value())
+          return result;
+
+        pages.push_back(node.page_num);
+      }
+
+    return nullptr;
+  }
+
+  [[nodiscard]] auto Collection::bulk_load(const std::function<tl::optional<node::Item>()> &next) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (0 != this->root)
+      return Err("Collection::bulk_load requires an empty collection");
+
+    this->changes++;
+
+    auto items = std::vector<node::Item>{};
+    for (auto item = next(); item.has_value(); item = next())
+      {
+        if (!items.empty() && utils::Safecmp::bytescmp(items.back().key, item->key) >= 0)
+          return Err(fmt::format(
+            "Collection::bulk_load requires strictly increasing keys, {} is out of order",
+            std::string{item->key.begin(), item->key.end()}));
+
+        if (item->key.size() > this->dal->max_key_size())
+          return Err(fmt::format(
+            "the key of {} bytes is larger than the maximum of {} bytes",
+            item->key.size(),
+            this->dal->max_key_size()));
+
+        if (auto result = this->dal->store_value(item.value()); !result.has_value())
+          return result;
+
+        items.push_back(std::move(item.value()));
+      }
+
+    if (items.empty())
+      return nullptr;
+
+    if (this->dal->transaction != nullptr)
+      this->dal->transaction->track(this);
+
+    /* Build the levels bottom-up until a level fits in a single node, the root. */
+    auto children = std::vector<page::Page_num>{};
+    while (true)
+      {
+        auto separators = std::vector<node::Item>{};
+        auto pages = std::vector<page::Page_num>{};
+
+        if (auto result = _bulk_load_level(
+              this->dal, std::move(items), children, separators, pages, this->dal->max_threshold());
+            !result.has_value())
+          return result;
+
+        if (pages.size() == 1)
+          {
+            this->root = pages.front();
+            break;
+          }
+
+        items = std::move(separators);
+        children = std::move(pages);
+      }
+
+    /* Within a transaction, the freelist is written when it commits. */
+    if (this->dal->transaction != nullptr)
+      return nullptr;
+
+    return this->dal->write_freelist().and_then([&](const auto &&_) { return this->dal->commit(); });
+  }
+
+  [[nodiscard]] auto Collection::descend(const std::vector<uint8_t> &key) const noexcept
+    -> tl::expected<Path, Error>
+  {
+    auto path = Path{};
+    return this->descend(key, path, 0)
+      .and_then([&](const auto &leaf) { return _decode(this->dal, leaf.first, leaf.second.data); })
+      .map([&](auto &&leaf) {
+        const auto [was_found, index] = leaf.find_key_in_node(key);
+        path.was_found = was_found;
+        path.index = index;
+        path.nodes.push_back(std::move(leaf));
+        return std::move(path);
       });
+  }
+
+  [[nodiscard]] auto Collection::descend(const std::vector<uint8_t> &key, Path &path, const size_t kept) const noexcept
+    -> tl::expected<std::pair<page::Page_num, node::Node_view>, Error>
+  {
+    /* Keep the nodes the key goes through, down to the first one it leaves. */
+    auto page_num = this->root;
+    auto depth = size_t{0};
+    if (0 != kept && !path.nodes.empty() && path.nodes.front().page_num == this->root)
+      do
+        {
+          const auto &node = path.nodes[depth];
+          const auto [was_found, index] = node.find_key_in_node(key);
+          path.indexes.resize(++depth);
+          path.indexes.push_back(Node::child_index(was_found, index));
+          page_num = node.children[path.indexes.back()];
+        }
+      while (depth < kept && page_num == path.nodes[depth].page_num);
+
+    path.nodes.erase(path.nodes.begin() + static_cast<int64_t>(depth), path.nodes.end());
+    if (0 == depth)
+      path.indexes.assign(1, /* index of root */ 0);
+
+    for (;;)
+      {
+        const auto data = this->dal->view_page(page_num);
+        if (!data.has_value())
+          return tl::make_unexpected(data.error());
+        if (const auto view = node::Node_view{data.value()}; view.is_leaf())
+          return std::pair{page_num, view};
+
+        auto node = _decode(this->dal, page_num, data.value());
+        if (!node.has_value())
+          return tl::make_unexpected(node.error());
+
+        /* The items are in the leaves, a separator equal to the key only
+         * tells which child to descend into. */
+        const auto [was_found, index] = node->find_key_in_node(key);
+        path.nodes.push_back(std::move(node.value()));
+        path.indexes.push_back(Node::child_index(was_found, index));
+        page_num = path.leaf().children[path.indexes.back()];
+      }
+  }
+
+  [[nodiscard]] auto Collection::remove(const std::vector<uint8_t> &key) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    return this->in_transaction([&] {
+      this->changes++;
+      return this->erase(key);
     });
   }
 
-  [[nodiscard]] auto Collection::get_nodes(std::deque<uint32_t> indexes) const noexcept
-    -> tl::expected<std::deque<Node>, Error>
+  [[nodiscard]] auto Collection::erase(const std::vector<uint8_t> &key) noexcept
+    -> tl::expected<std::nullptr_t, Error>
   {
-    return this->dal->get_node(this->root).map([&](const auto &root) {
-      auto nodes = std::deque<Node>{root};
-      auto child = root;
+    if (0 == this->root)
+      return tl::unexpected(_error(fmt::format(
+        "key {} not found in Collection::remove", std::string{key.begin(), key.end()})));
 
-      for (uint32_t i = 1; i < indexes.size(); i++)
-        this->dal->get_node(child.children[indexes[i]])
-          .map([&](auto &&new_child) {
-            child = std::move(new_child);
-            nodes.push_back(child);
-          })
-          .map_error([&](auto &&error) {
-            error.append("get_node error in Collection::get_nodes");
-            return error.panic();
-          });
+    return this->descend(key).and_then([&](auto &&path) -> tl::expected<std::nullptr_t, Error> {
+      if (!path.was_found)
+        return tl::unexpected(_error(fmt::format(
+          "key {} not found in Collection::remove", std::string{key.begin(), key.end()})));
+
+      _record(this->dal, path);
+
+      /* The item is dropped below, release its overflow chain first. */
+      if (const auto &item = path.leaf().items[path.index]; item.is_overflow())
+        if (auto result = this->dal->delete_overflow(item.overflow, item.overflow_size);
+            !result.has_value())
+          return result;
+
+      /* The items are all in the leaves. A separator equal to the key
+       * stays, it still divides its children. */
+      path.leaf().remove_item_from_leaf(path.index);
+
+      /* Rebalance the nodes all the way up.
+       * Start From one node before the last and go all the way up. Exclude root.
+       * The ancestors are rebalanced in place, so a modified parent is seen by the
+       * next iteration. */
+      auto &ancestors = path.nodes;
+      for (auto i = static_cast<int64_t>(ancestors.size() - 2); i >= 0; i--)
+        {
+          auto &pnode = ancestors[i];
+          auto &node = ancestors[i + 1];
+
+          if (node.is_under_populated())
+            pnode.rebalance_remove(node, path.indexes[i + 1]).map_error([&](auto &&error) {
+              error.append("rebalance_remove error in Collection::remove");
+              return error.panic();
+            });
+        }
 
-      return nodes;
+      /* If the root has no items after rebalancing, its only child is the new
+       * root. There's no need to save it because we ignore it. */
+      if (const auto &root = ancestors[0]; root.items.empty() && !root.children.empty())
+        {
+          this->dal->delete_node(root.page_num);
+          this->root = root.children[0];
+        }
+
+      return nullptr;
     });
   }
 
-  [[nodiscard]] auto Collection::remove(const std::vector<uint8_t> &key) noexcept
+  [[nodiscard]] auto Locality::fragmentation() const noexcept -> double
+  {
+    if (this->leaves < 2)
+      return 0;
+    return 1 - static_cast<double>(this->sequential) / static_cast<double>(this->leaves - 1);
+  }
+
+  [[nodiscard]] auto Locality::average_distance() const noexcept -> double
+  {
+    if (this->leaves < 2)
+      return 0;
+    return static_cast<double>(this->distance) / static_cast<double>(this->leaves - 1);
+  }
+
+  [[nodiscard]] auto Collection::locality() const noexcept -> tl::expected<Locality, Error>
+  {
+    auto locality = Locality{};
+    if (0 == this->root)
+      return locality;
+
+    /* The children of every level in key order form the next one, down to
+     * the leaves, which are not read. */
+    auto level = std::vector<page::Page_num>{this->root};
+    for (auto is_leaf = false; !is_leaf;)
+      {
+        auto children = std::vector<page::Page_num>{};
+        for (const auto page_num : level)
+          {
+            const auto data = this->dal->view_page(page_num);
+            if (!data.has_value())
+              return tl::make_unexpected(data.error());
+
+            const auto node = node::Node_view{data.value()};
+            if ((is_leaf = node.is_leaf()))
+              break;
+
+            for (uint32_t i = 0; i <= node.items_count(); i++)
+              children.push_back(node.child(i));
+          }
+
+        if (!is_leaf)
+          level = std::move(children);
+      }
+
+    locality.leaves = level.size();
+    for (size_t i = 1; i < level.size(); i++)
+      {
+        const auto previous = level[i - 1], page_num = level[i];
+        locality.sequential += page_num == previous + 1 ? 1 : 0;
+        locality.distance += page_num > previous ? page_num - previous : previous - page_num;
+      }
+
+    return locality;
+  }
+
+  Compaction::Compaction(Collection *collection)
+    : Compaction(collection, collection->dal->options.max_fill_percent)
+  {}
+
+  Compaction::Compaction(Collection *collection, const float fill_percent)
+    : collection(collection), fill_percent(fill_percent)
+  {}
+
+  Compaction::~Compaction()
+  {
+    if (!this->leaves.empty() || 0 != this->candidate.page_num)
+      this->restart().map_error([&](auto &&error) {
+        error.append("restart error in Compaction::~Compaction");
+        return error.panic();
+      });
+  }
+
+  [[nodiscard]] auto Compaction::is_complete() const noexcept -> bool { return this->complete; }
+
+  [[nodiscard]] auto Compaction::run() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    while (true)
+      {
+        const auto result = this->step(std::numeric_limits<uint32_t>::max());
+        if (!result.has_value())
+          return tl::make_unexpected(result.error());
+        if (result.value())
+          return nullptr;
+      }
+  }
+
+  [[nodiscard]] auto Compaction::step(const uint32_t max_pages) noexcept -> tl::expected<bool, Error>
+  {
+    if (this->complete)
+      return true;
+
+    auto *dal = this->collection->dal;
+    if (dal->transaction != nullptr)
+      return Err("a compaction step cannot run during a transaction");
+
+    if (
+      !this->started || this->changes != this->collection->changes
+      || this->root != this->collection->root)
+      {
+        if (this->started)
+          this->restarts++;
+        if (auto result = this->restart(); !result.has_value())
+          return tl::make_unexpected(result.error());
+      }
+
+    auto       transaction = transaction::Transaction{dal};
+    const auto first_leaf = this->leaves.size();
+    const auto first_candidate = this->candidate.page_num;
+
+    /* A failed step is rolled back with the leaves it wrote and the pages it
+     * took, the next step starts over. */
+    const auto fail = [&](const Error &error) -> tl::expected<bool, Error> {
+      this->leaves.resize(first_leaf);
+      this->candidate.page_num = first_candidate;
+      this->started = false;
+      return tl::make_unexpected(error);
+    };
+
+    /* Continue from the first item not rewritten yet. The new leaves are not
+     * part of the old tree, the cursor only reads the old one. */
+    auto       cursor = cursor::Cursor{this->collection};
+    const auto position = this->next_key.empty() ? cursor.first() : cursor.seek(this->next_key);
+    if (!position.has_value())
+      return fail(position.error());
+
+    auto valid = position.value();
+    while (valid && this->leaves.size() - first_leaf < max_pages)
+      {
+        if (auto result = this->add(cursor.stored_item()); !result.has_value())
+          return fail(result.error());
+
+        const auto next = cursor.next();
+        if (!next.has_value())
+          return fail(next.error());
+        valid = next.value();
+      }
+
+    if (valid)
+      {
+        const auto key = cursor.key();
+        this->next_key.assign(key.begin(), key.end());
+
+        if (auto result = transaction.commit(); !result.has_value())
+          return fail(result.error());
+        return false;
+      }
+
+    if (auto result = this->finish().and_then([&](const auto &&_) { return transaction.commit(); });
+        !result.has_value())
+      return fail(result.error());
+
+    this->complete = true;
+    this->leaves.clear();
+    this->separators.clear();
+
+    return dal->truncate().map([](const auto &&_) { return true; });
+  }
+
+  [[nodiscard]] auto Compaction::restart() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    auto *dal = this->collection->dal;
+
+    /* The rewritten leaves are released in a transaction of their own, unless
+     * one is active already. */
+    auto transaction = tl::optional<transaction::Transaction>{};
+    if (dal->transaction == nullptr)
+      transaction.emplace(dal);
+
+    for (const auto page_num : this->leaves)
+      dal->delete_node(page_num);
+    if (0 != this->candidate.page_num)
+      dal->delete_node(this->candidate.page_num);
+
+    this->started = true;
+    this->changes = this->collection->changes;
+    this->root = this->collection->root;
+    this->next_key.clear();
+    this->candidate = Node{};
+    this->leaves.clear();
+    this->separators.clear();
+
+    if (!transaction.has_value())
+      return nullptr;
+    return transaction->commit();
+  }
+
+  [[nodiscard]] auto Compaction::add(node::Item item) noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    auto *dal = this->collection->dal;
+
+    if (0 == this->candidate.page_num)
+      this->candidate = dal->new_node({}, {}, 0);
+
+    /* The item making the candidate full starts the next leaf, whose page
+     * is taken right after the candidate's so the leaves stay in order. */
+    this->candidate.items.push_back(std::move(item));
+    if (!_is_full(dal, this->candidate, this->fill_percent * static_cast<float>(dal->options.page_size)))
+      return nullptr;
+
+    auto next = dal->new_node({std::move(this->candidate.items.back())}, {}, this->candidate.page_num);
+    this->candidate.items.pop_back();
+    this->candidate.next = next.page_num;
+    next.prev = this->candidate.page_num;
+
+    return dal->write_node(this->candidate).map([&](const auto &&_) {
+      this->leaves.push_back(this->candidate.page_num);
+      this->separators.push_back(
+        node::Item{Node::separator(this->candidate.items.back().key, next.items.front().key), {}});
+      this->candidate = std::move(next);
+      return nullptr;
+    });
+  }
+
+  [[nodiscard]] auto Compaction::finish() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    auto *dal = this->collection->dal;
+
+    /* The candidate is the last leaf, it holds at least one item. */
+    if (!this->candidate.items.empty())
+      {
+        if (auto result = dal->write_node(this->candidate); !result.has_value())
+          return result;
+
+        this->leaves.push_back(this->candidate.page_num);
+        this->candidate = Node{};
+      }
+
+    /* Build the internal levels bottom-up until a level fits in a single
+     * node. The leaves are kept until the transaction commits. */
+    auto items = this->separators;
+    auto children = this->leaves;
+    while (children.size() > 1)
+      {
+        auto separators = std::vector<node::Item>{};
+        auto pages = std::vector<page::Page_num>{};
+
+        if (auto result = _bulk_load_level(
+              dal,
+              std::move(items),
+              children,
+              separators,
+              pages,
+              this->fill_percent * static_cast<float>(dal->options.page_size));
+            !result.has_value())
+          return result;
+
+        items = std::move(separators);
+        children = std::move(pages);
+      }
+
+    /* Release the old tree, depth first. */
+    auto old_pages = std::vector<page::Page_num>{};
+    for (auto pages = std::vector<page::Page_num>{this->collection->root}; 0 != this->collection->root
+                                                                           && !pages.empty();)
+      {
+        const auto page_num = pages.back();
+        pages.pop_back();
+        old_pages.push_back(page_num);
+
+        const auto data = dal->view_page(page_num);
+        if (!data.has_value())
+          return tl::make_unexpected(data.error());
+
+        const auto node = node::Node_view{data.value()};
+        if (!node.is_leaf())
+          for (uint32_t i = 0; i <= node.items_count(); i++)
+            pages.push_back(node.child(i));
+      }
+
+    for (const auto page_num : old_pages)
+      dal->delete_node(page_num);
+
+    const auto root = children.empty() ? page::Page_num{0} : children.front();
+    /* The catalog records the root when the transaction commits. */
+    dal->transaction->track(this->collection);
+
+    this->collection->root = root;
+    return nullptr;
+  }
+
+  [[nodiscard]] auto Collection::in_transaction(
+    const std::function<tl::expected<std::nullptr_t, Error>()> &operation) noexcept
     -> tl::expected<std::nullptr_t, Error>
   {
-    return this->dal->get_node(this->root)
-      .and_then([&](auto &&root) {
-        return root.find_key(key, true).and_then(
-          [&](auto &&result) -> tl::expected<std::nullptr_t, Error> {
-            auto &[remove_item_index, node_to_remove_from, ancestors_indexes] = result;
+    if (auto *transaction = this->dal->active_transaction(); transaction != nullptr)
+      {
+        transaction->track(this);
+        return operation();
+      }
+
+    auto transaction = transaction::Transaction{this->dal};
+    transaction.track(this);
 
-            if (remove_item_index == -1)
-              return tl::unexpected(_error(fmt::format(
-                "key {} not found in Collection::remove", std::string{key.begin(), key.end()})));
+    return operation().and_then([&](const auto &&_) { return transaction.commit(); });
+  }
 
-            if (node_to_remove_from->is_leaf())
-              node_to_remove_from->remove_item_from_leaf(remove_item_index);
+  /** Delete the overflow chains of the items dropped from a leaf. */
+  static auto _drop_overflows(
+    data_access_layer::Data_access_layer *dal, const std::span<const node::Item_view> dropped) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    for (const auto &item : dropped)
+      if (auto result = dal->delete_overflow(item.overflow, item.overflow_size); !result.has_value())
+        return result;
+    return nullptr;
+  }
+
+  /** Link the leaf page_num after the leaf prev. */
+  static auto _link_prev(
+    data_access_layer::Data_access_layer *dal, const page::Page_num page_num, const page::Page_num prev) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    return dal->get_node(page_num).and_then([&](auto &&node) {
+      node.prev = prev;
+      return dal->write_node(node);
+    });
+  }
+
+  /** Split an over populated node into as few nodes as it takes for each to
+   ** be filled up to Options::max_fill_percent, evenly. node keeps the first
+   ** items and its page, the other nodes are taken near it, and every node is
+   ** written. Their pages and the separators before them are added to pages
+   ** and separators, in order, and the leaves are linked between node and the
+   ** leaf after it, whose own prev link is left to the caller. */
+  static auto _split_node(
+    data_access_layer::Data_access_layer *dal,
+    Node                                 &node,
+    std::vector<node::Item>              &separators,
+    std::vector<page::Page_num>          &pages) noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    const auto is_leaf = node.is_leaf();
+    const auto size = static_cast<float>(node.size());
+    const auto threshold = size / std::ceil(size / dal->max_threshold());
+
+    auto items = std::vector<node::Item>{
+      std::make_move_iterator(node.items.begin()), std::make_move_iterator(node.items.end())};
+    const auto children = std::vector<page::Page_num>{node.children.begin(), node.children.end()};
+    const auto ends = _split_ends(dal, items, children, threshold);
+
+    auto nodes = std::vector<Node>{};
+    nodes.reserve(ends.size());
+    for (size_t node_index = 0, begin = 0; node_index <= ends.size(); node_index++)
+      {
+        const auto end = node_index < ends.size() ? ends[node_index] : items.size();
+
+        if (node_index < ends.size())
+          separators.push_back(
+            is_leaf ? node::Item{Node::separator(items[end - 1].key, items[end].key), {}}
+                    : std::move(items[end]));
+
+        auto node_items = std::deque<node::Item>{
+          std::make_move_iterator(items.begin() + begin), std::make_move_iterator(items.begin() + end)};
+        auto node_children = is_leaf ? std::deque<page::Page_num>{}
+                                     : std::deque<page::Page_num>{children.begin() + begin, children.begin() + end + 1};
+
+        if (0 == node_index)
+          {
+            node.items = std::move(node_items);
+            node.children = std::move(node_children);
+          }
+        else
+          nodes.push_back(dal->new_node(
+            std::move(node_items), std::move(node_children), nodes.empty() ? node.page_num : nodes.back().page_num));
+
+        begin = is_leaf ? end : end + 1;
+      }
+
+    /* The new leaves go between node and the leaf after it. */
+    if (is_leaf && !nodes.empty())
+      {
+        nodes.back().next = node.next;
+        for (size_t node_index = 0; node_index < nodes.size(); node_index++)
+          {
+            auto &previous = 0 == node_index ? node : nodes[node_index - 1];
+            nodes[node_index].prev = previous.page_num;
+            previous.next = nodes[node_index].page_num;
+          }
+      }
+
+    if (auto result = dal->write_node(node); !result.has_value())
+      return result;
+
+    for (auto &new_node : nodes)
+      {
+        if (auto result = dal->write_node(new_node); !result.has_value())
+          return result;
+        pages.push_back(new_node.page_num);
+      }
+
+    return nullptr;
+  }
+
+  auto Write_batch::put(std::vector<uint8_t> key, std::vector<uint8_t> value) -> void
+  {
+    this->mutations.push_back(Mutation{std::move(key), std::move(value)});
+  }
+
+  auto Write_batch::remove(std::vector<uint8_t> key) -> void
+  {
+    this->mutations.push_back(Mutation{std::move(key), tl::nullopt});
+  }
+
+  [[nodiscard]] auto Write_batch::size() const noexcept -> size_t { return this->mutations.size(); }
+
+  [[nodiscard]] auto Write_batch::commit() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    const auto *dal = this->collection->dal;
+    for (const auto &mutation : this->mutations)
+      if (mutation.key.size() > dal->max_key_size())
+        {
+          const auto size = mutation.key.size();
+          this->mutations.clear();
+          return Err(fmt::format(
+            "the key of {} bytes is larger than the maximum of {} bytes", size, dal->max_key_size()));
+        }
+
+    /* The last mutation of a key wins, the sort is stable. */
+    std::ranges::stable_sort(this->mutations, [](const auto &left, const auto &right) {
+      return utils::Safecmp::bytescmp(left.key, right.key) < 0;
+    });
+
+    auto mutations = std::vector<Mutation>{};
+    for (size_t i = 0; i < this->mutations.size(); i++)
+      if (
+        i + 1 == this->mutations.size()
+        || 0 != utils::Safecmp::bytescmp(this->mutations[i].key, this->mutations[i + 1].key))
+        mutations.push_back(std::move(this->mutations[i]));
+
+    this->mutations.clear();
+    this->collection->changes++;
+    return this->collection->in_transaction([&] { return this->apply(mutations); });
+  }
+
+  [[nodiscard]] auto Write_batch::apply(std::vector<Mutation> &mutations) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    auto *dal = this->collection->dal;
+
+    /* An empty collection is bulk loaded, there is nothing to remove. */
+    if (0 == this->collection->root)
+      {
+        auto items = std::vector<node::Item>{};
+        for (auto &mutation : mutations)
+          if (mutation.value != tl::nullopt)
+            items.push_back(node::Item{std::move(mutation.key), std::move(mutation.value.value())});
+
+        return this->collection->bulk_load(
+          std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+      }
+
+    auto separators = std::vector<node::Item>{};
+    auto pages = std::vector<page::Page_num>{};
+
+    /* The leaves are reached in key order, the ancestors left up to date by
+     * the previous leaf are kept for the next descent. */
+    auto path = Path{};
+    auto kept = size_t{0};
+
+    /* The leaf after a split one is usually the next leaf modified, it only
+     * gets its prev link then. With copy on write the links are not kept. */
+    auto unlinked_leaf = page::Page_num{0};
+    auto unlinked_prev = page::Page_num{0};
+
+    /* Reused by the leaves: the items put and the overflow chains dropped. */
+    auto puts = std::vector<node::Item>{};
+    auto dropped = std::vector<node::Item_view>{};
+
+    for (size_t first = 0, last = 0; first < mutations.size(); first = last)
+      {
+        auto descent = this->collection->descend(mutations[first].key, path, kept);
+        if (!descent.has_value())
+          return tl::make_unexpected(descent.error());
+
+        auto &nodes = path.nodes;
+        auto [page_num, view] = descent.value();
+        kept = nodes.size();
+
+        /* Linking the other leaf may read over the page of this one. */
+        const auto relinked = page_num == unlinked_leaf;
+        if (!relinked && 0 != unlinked_leaf)
+          {
+            if (auto result = _link_prev(dal, unlinked_leaf, unlinked_prev); !result.has_value())
+              return result;
+            if (auto data = dal->view_page(page_num); !data.has_value())
+              return tl::make_unexpected(data.error());
             else
-              {
-                node_to_remove_from->remove_item_from_internal(remove_item_index)
-                  .map([&](const auto &affected_nodes) {
-                    return ancestors_indexes.insert(
-                      ancestors_indexes.end(), affected_nodes.begin(), affected_nodes.end());
-                  })
-                  .map_error([&](auto &&error) {
-                    error.append("remove_item_from_internal error in Collection::remove");
-                    return error.panic();
-                  });
-              }
+              view = node::Node_view{data.value()};
+          }
+        const auto prev = relinked ? unlinked_prev : view.prev();
+        unlinked_leaf = 0;
 
-            return this->get_nodes(ancestors_indexes).map([&](auto &&ancestors) {
-              /* Rebalance the nodes all the way up.
-               * Start From one node before the last and go all the way up. Exclude root. */
-              for (auto i = static_cast<int64_t>(ancestors.size() - 2); i >= 0; i--)
-                {
-                  auto pnode = ancestors[i];
-                  auto node = ancestors[i + 1];
-
-                  if (node.is_under_populated())
-                    pnode.rebalance_remove(node, ancestors_indexes[i + 1])
-                      .map_error([&](auto &&error) {
-                        error.append("rebalance_remove error in Collection::remove");
-                        return error.panic();
-                      });
-                }
-
-              root = ancestors[0];
-
-              /* If the root has no items after rebalancing,
-               * there's no need to save it because we ignore it. */
-              if (root.items.empty() && !root.children.empty())
-                this->root = ancestors[1].page_num;
-
-              return nullptr;
-            });
-          });
-      })
-      .and_then([&](const auto &) -> tl::expected<std::nullptr_t, Error> {
-        return this->find(key).and_then([&](const auto &item) {
-          if (item != tl::nullopt)
+        /* The keys of the leaf are below the separator after it in the
+         * deepest ancestor that has one. */
+        const std::vector<uint8_t> *fence = nullptr;
+        for (auto level = nodes.size(); level > 0 && fence == nullptr; level--)
+          if (const auto index = path.indexes[level]; index < nodes[level - 1].items.size())
+            fence = &nodes[level - 1].items[index].key;
+
+        last = first;
+        while (last < mutations.size()
+               && (fence == nullptr || utils::Safecmp::bytescmp(mutations[last].key, *fence) < 0))
+          last++;
+
+        /* The values are stored first, which only stages pages: the view of
+         * the leaf stays valid. */
+        puts.clear();
+        for (auto i = first; i < last; i++)
+          if (auto &mutation = mutations[i]; mutation.value != tl::nullopt)
             {
-              // Key still exists after removal attempt - this is unexpected
-              spdlog::warn(
-                "failed to remove key: {}, key still exists", std::string{key.begin(), key.end()});
-              // We're not retrying because the original implementation had an infinite loop
-              // Could implement retry logic with a counter if needed
+              puts.push_back(node::Item{std::move(mutation.key), std::move(mutation.value.value())});
+              if (auto result = dal->store_value(puts.back()); !result.has_value())
+                return result;
             }
-          return tl::expected<std::nullptr_t, Error>(nullptr);
-        });
-      });
-  }
 
+        /* Merge the mutations of the leaf into its items in one pass, as
+         * views of the page of the leaf and of the items put. */
+        auto      &arena = dal->arena;
+        const auto scope = arena::Arena::Scope{arena};
+        const auto count = view.items_count();
+        const auto previous = arena.allocate<node::Item_view>(count);
+        for (uint32_t index = 0; index < count; index++)
+          previous[index] = view.item_view(index, arena);
+
+        const auto items = arena.allocate<node::Item_view>(count + puts.size());
+        auto       size = size_t{0};
+        auto       index = size_t{0};
+        auto       put = puts.begin();
+        auto       modified = relinked;
+        dropped.clear();
+
+        for (auto i = first; i < last; i++)
+          {
+            const auto is_put = mutations[i].value != tl::nullopt;
+            const auto key = std::span<const uint8_t>{is_put ? put->key : mutations[i].key};
+            for (; index < count && utils::Safecmp::bytescmp(previous[index].key, key) < 0; index++)
+              items[size++] = previous[index];
+
+            /* The previous item of the key is dropped with its overflow chain. */
+            if (index < count && 0 == utils::Safecmp::bytescmp(previous[index].key, key))
+              {
+                if (previous[index].is_overflow())
+                  dropped.push_back(previous[index]);
+                index++;
+                modified = true;
+              }
+
+            if (is_put)
+              {
+                items[size++] = node::Item_view{*put++};
+                modified = true;
+              }
+          }
+
+        if (!modified)
+          continue;
+
+        for (; index < count; index++)
+          items[size++] = previous[index];
+        const auto merged = items.first(size);
+
+        _record(dal, path);
+        if (dal->options.copy_on_write && dal->transaction != nullptr)
+          dal->transaction->record(page_num);
+
+        /* A leaf that is neither split nor rebalanced is written from the
+         * views, without being decoded. Otherwise it is decoded before the
+         * chains are dropped, they may read over its page. */
+        const auto is_root = nodes.empty();
+        if (!dal->is_over_populated(merged) && (is_root || !dal->is_under_populated(merged)))
+          {
+            const auto buffer = arena.allocate<uint8_t>(dal->options.page_size);
+            if (auto result = types::Serializer<Node>::serialize(merged, prev, view.next(), page_num, buffer);
+                !result.has_value())
+              return result;
+
+            if (auto result = dal->write_page(page_num, buffer); !result.has_value())
+              return result;
+
+            if (auto result = _drop_overflows(dal, dropped); !result.has_value())
+              return result;
+            continue;
+          }
+
+        auto leaf = Node{dal, page_num, {}, {}};
+        for (const auto &item : merged)
+          leaf.items.push_back(node::Item{
+            {item.key.begin(), item.key.end()}, {item.value.begin(), item.value.end()}, item.overflow, item.overflow_size});
+        leaf.prev = prev;
+        leaf.next = view.next();
+        nodes.push_back(std::move(leaf));
+
+        if (auto result = _drop_overflows(dal, dropped); !result.has_value())
+          return result;
+
+        /* An over populated leaf may not fit in a page, it is only written
+         * once split. */
+        if (!nodes.back().is_over_populated())
+          if (auto result = dal->write_node(nodes.back()); !result.has_value())
+            return result;
+
+        /* Split or rebalance the nodes up, excluding the root, as long as the
+         * parents change. The nodes split are added to their parent at once,
+         * an ancestor left as it was is not rebalanced again by every leaf
+         * under it. */
+        auto changed = true;
+        for (auto level = nodes.size() - 1; level > 0 && changed; level--)
+          {
+            auto      &node = nodes[level];
+            auto      &parent = nodes[level - 1];
+            const auto node_index = path.indexes[level];
+
+            if (node.is_over_populated())
+              {
+                separators.clear();
+                pages.clear();
+                const auto next = node.next;
+                if (auto result = _split_node(dal, node, separators, pages); !result.has_value())
+                  return result;
+
+                if (node.is_leaf() && !dal->options.copy_on_write)
+                  {
+                    unlinked_leaf = next;
+                    unlinked_prev = pages.back();
+                  }
+
+                parent.items.insert(
+                  parent.items.begin() + node_index,
+                  std::make_move_iterator(separators.begin()),
+                  std::make_move_iterator(separators.end()));
+                parent.children.insert(parent.children.begin() + node_index + 1, pages.begin(), pages.end());
+
+                /* An over populated parent is split in turn, and only
+                 * written then. */
+                if (!parent.is_over_populated())
+                  if (auto result = dal->write_node(parent); !result.has_value())
+                    return result;
+              }
+
+            /* The node may be merged into a sibling, or get items from one. */
+            else if (node.is_under_populated())
+              {
+                kept = std::min(kept, level);
+                if (auto result = parent.rebalance_remove(node, node_index); !result.has_value())
+                  return tl::make_unexpected(result.error());
+              }
+
+            else
+              changed = false;
+          }
+
+        /* An over populated root is split under a new one, as many times as
+         * it takes. A root left without items is replaced by its only child. */
+        auto &root = nodes[0];
+        if (root.items.empty() && !root.children.empty())
+          {
+            dal->delete_node(root.page_num);
+            this->collection->root = root.children[0];
+            kept = 0;
+          }
+
+        else if (root.is_over_populated())
+          {
+            do
+              {
+                separators.clear();
+                pages.clear();
+                if (auto result = _split_node(dal, root, separators, pages); !result.has_value())
+                  return result;
+
+                auto children = std::deque<page::Page_num>{root.page_num};
+                children.insert(children.end(), pages.begin(), pages.end());
+
+                root = dal->new_node(
+                  std::deque<node::Item>{
+                    std::make_move_iterator(separators.begin()), std::make_move_iterator(separators.end())},
+                  std::move(children),
+                  root.page_num);
+                this->collection->root = root.page_num;
+              }
+            while (root.is_over_populated());
+            kept = 0;
+
+            if (auto result = dal->write_node(root); !result.has_value())
+              return result;
+          }
+      }
+
+    if (0 != unlinked_leaf)
+      return _link_prev(dal, unlinked_leaf, unlinked_prev);
+    return nullptr;
+  }
 } // namespace toocal::core::collection
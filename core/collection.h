@@ -8,6 +8,9 @@
 #include "tl/optional.hpp"
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <span>
 
 namespace toocal::core::data_access_layer
 {
@@ -19,6 +22,51 @@ namespace toocal::core::collection
   using errors::Error;
   using node::Node;
 
+  /** How the leaves of a collection are laid out in the file, in key order.
+   ** A scan reads the leaves in this order, it is sequential when every leaf
+   ** is on the page after the previous one. */
+  class Locality
+  {
+  public:
+    uint64_t leaves{};
+
+    /** The leaves on the page right after the previous leaf. */
+    uint64_t sequential{};
+
+    /** The sum of the distances, in pages, between consecutive leaves. */
+    uint64_t distance{};
+
+    /** The share of the consecutive leaves that are not sequential, from 0
+     ** for a collection scanned sequentially to 1. */
+    [[nodiscard]] auto fragmentation() const noexcept -> double;
+
+    /** The average distance, in pages, between consecutive leaves. */
+    [[nodiscard]] auto average_distance() const noexcept -> double;
+  };
+
+  /** Path is the descent from the root of a collection to the leaf of a key:
+   ** the nodes on the way, each decoded once, and the index of every node
+   ** among the children of the one before it. Put and remove modify the leaf
+   ** and then split or rebalance the nodes of the path from the leaf up, so
+   ** the ancestors are not read again. */
+  class Path
+  {
+  public:
+    /** The root first and the leaf last. */
+    std::deque<Node> nodes;
+
+    /** The index of every node among the children of its parent, 0 for the
+     ** root. */
+    std::deque<uint32_t> indexes;
+
+    /** Whether the leaf holds the key, and the index of the key in the leaf
+     ** or the position it is inserted at. */
+    bool     was_found{};
+    uint32_t index{};
+
+    [[nodiscard]] auto leaf() noexcept -> Node & { return this->nodes.back(); }
+  };
+
   class Collection
   {
   public:
@@ -26,6 +74,10 @@ namespace toocal::core::collection
     std::vector<uint8_t>                  name;
     page::Page_num                        root;
 
+    /** Counts the calls to put, remove and bulk_load, so a Compaction notices
+     ** the collection changed between two of its steps. */
+    uint64_t changes{};
+
     Collection(std::vector<uint8_t> name, const page::Page_num root)
       : dal{nullptr}, name(std::move(name)), root(root)
     {}
@@ -36,40 +88,231 @@ namespace toocal::core::collection
     {}
 
     /** Returns an item according based on the given key by performing a
-     ** binary search. */
-    [[nodiscard]] auto find(std::vector<uint8_t> key) const noexcept
+     ** binary search. The pages are searched in place with node::Node_view,
+     ** so the lookup only allocates the returned item, and only the found
+     ** item reads its value from an overflow chain. */
+    [[nodiscard]] auto find(const std::vector<uint8_t> &key) const noexcept
       -> tl::expected<tl::optional<node::Item>, Error>;
 
-    /** Put adds a key to the tree. It finds the correct node and the insertion
-     ** index and adds the item. When performing the search, the ancestors are
-     ** returned as well. This way we can iterate over them to check which nodes
+    /** Returns the items of keys, in the order of keys, with nullopt for the
+     ** keys not found. The keys are sorted and the batch is split between the
+     ** children of every node on the way down, so every page is read once
+     ** however many of the keys lead to it, and the leaves are read in key
+     ** order. Like find, only the found items read their overflow chains. */
+    [[nodiscard]] auto find_many(std::span<const std::vector<uint8_t>> keys) const noexcept
+      -> tl::expected<std::vector<tl::optional<node::Item>>, Error>;
+
+    /** Put adds a key to the tree. It finds the correct leaf and the insertion
+     ** index and adds the item. A full leaf is split in two linked leaves, and
+     ** the first key of the right one is copied to the parent as the separator
+     ** between them. When performing the search, the ancestors are
+     ** returned as well, see Path. This way we can iterate over them to check which nodes
      ** were modified and balance by splitting them accordingly. If the root
      ** has too many items, then a new root of a new layer is created and the
-     ** created nodes from the split are added as children. */
+     ** created nodes from the split are added as children. If the key already
+     ** exists its value is replaced. A value making the item larger than
+     ** Data_access_layer::max_item_size is stored in an overflow chain, and
+     ** the key must not be larger than Data_access_layer::max_key_size.
+     ** Without an active transaction::Transaction the put runs in its own
+     ** transaction, which commits the modified pages. A put that does not
+     ** split its leaf does not decode any node, and a put that splits it does
+     ** not read the pages of the descent again, see insert_in_leaf. */
     [[nodiscard]] auto put(std::vector<uint8_t> key, std::vector<uint8_t> value) noexcept
       -> tl::expected<std::nullptr_t, Error>;
 
-    /** Returns a list of nodes based on their indexes (the breadcrumbs from the
-     ** root):
-     **            p
-     **        /       \
-     **      a          b
-     **   /     \     /   \
-     **  c       d   e     f
-     **  For [0,1,0] -> p,b,e    */
-    [[nodiscard]] auto get_nodes(std::deque<uint32_t> indexes) const noexcept
-      -> tl::expected<std::deque<Node>, Error>;
+    /** Descend from the root to the leaf of key, reading every node on the
+     ** way once. The collection must not be empty. */
+    [[nodiscard]] auto descend(const std::vector<uint8_t> &key) const noexcept
+      -> tl::expected<Path, Error>;
+
+    /** Descend like descend into path, down to the parent of the leaf, and
+     ** return the page of the leaf with a view of it, it is not decoded. The
+     ** first kept nodes of path are still those of the tree: they are not
+     ** read again as long as key goes through them. */
+    [[nodiscard]] auto descend(const std::vector<uint8_t> &key, Path &path, size_t kept) const noexcept
+      -> tl::expected<std::pair<page::Page_num, node::Node_view>, Error>;
 
     /** Remove removes a key from the tree.
-     ** It finds the correct node and the index to remove the item from and removes it.
-     ** When performing the search, the ancestors are returned as well.
+     ** It finds the correct leaf and the index to remove the item from and removes it,
+     ** the separators of the internal nodes are kept as long as they still separate their children.
+     ** When performing the search, the ancestors are returned as well, see Path.
      ** This way we can iterate over them to check which nodes were modified and rebalance by
      ** rotating or merging the unbalanced nodes. Rotation is done first.
      ** If the siblings don't have enough items, then merging occurs.
      ** If the root is without items after a split, then the root is removed and the tree is one
-     ** level shorter. */
+     ** level shorter. Without an active transaction::Transaction the remove runs in its own
+     ** transaction, which commits the modified pages. */
     [[nodiscard]] auto remove(const std::vector<uint8_t> &key) noexcept
       -> tl::expected<std::nullptr_t, Error>;
+
+    /** Build the tree bottom-up from items returned by next in strictly
+     ** increasing key order, until next returns nullopt. The leaves are packed
+     ** up to Options::max_fill_percent and written from left to right, then
+     ** every internal level is built from the separators of the level below
+     ** in one pass, so every page is written once, in page order. Only the
+     ** last node of every level may be less filled. This is much faster than
+     ** calling put for every item and produces a smaller file. The collection
+     ** must be empty. */
+    [[nodiscard]] auto bulk_load(const std::function<tl::optional<node::Item>()> &next) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** bulk_load the node::Item of a sorted range. */
+    template <typename Tp_iterator>
+    [[nodiscard]] auto bulk_load(Tp_iterator first, const Tp_iterator last) noexcept
+      -> tl::expected<std::nullptr_t, Error>
+    {
+      return this->bulk_load([&]() -> tl::optional<node::Item> {
+        if (first == last)
+          return tl::nullopt;
+        return *first++;
+      });
+    }
+
+    /** Walk the leaves in key order to measure their locality. */
+    [[nodiscard]] auto locality() const noexcept -> tl::expected<Locality, Error>;
+
+    /** Run operation in the active transaction, or in a new one committed when
+     ** the operation succeeds and rolled back otherwise. */
+    [[nodiscard]] auto
+      in_transaction(const std::function<tl::expected<std::nullptr_t, Error>()> &operation) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+  private:
+
+    [[nodiscard]] auto insert(node::Item item) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Put item in its leaf if the leaf does not have to be split. The pages
+     ** are searched with node::Node_view, and the leaf is rewritten from its
+     ** node::Item_views and item in Data_access_layer::arena, so no node is
+     ** decoded and nothing is allocated once the leaf is staged in the
+     ** transaction. When the leaf has to be split, returns the Path to it
+     ** without changing anything: the internal pages of the descent are
+     ** copied to the arena, so they are decoded without being read again. */
+    [[nodiscard]] auto insert_in_leaf(const node::Item &item) noexcept
+      -> tl::expected<tl::optional<Path>, Error>;
+
+    [[nodiscard]] auto erase(const std::vector<uint8_t> &key) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+  };
+
+  /** Compaction rewrites a collection in key order into new nodes, filled up
+   ** to fill_percent and taken from the lowest released pages of the file, so
+   ** the leaves end up dense and in order at the start of the file. Then the
+   ** old nodes are released and the released pages at the end of the file
+   ** are truncated with Data_access_layer::truncate.
+   **
+   ** The work is split in steps. Every step rewrites a few leaves in its own
+   ** transaction, and the collection is still read through its old tree
+   ** between the steps. The last step builds the internal levels from the
+   ** separators of the leaves like Collection::bulk_load, switches the root
+   ** of the collection, and of the meta if it was the same, and truncates the
+   ** file. A put, a remove or a bulk_load on the collection between two steps
+   ** restarts the compaction, releasing the leaves rewritten so far. The
+   ** values stored in overflow chains stay where they are. Without enough
+   ** released pages the new nodes are appended to the file, which only
+   ** shrinks at the next compaction. */
+  class Compaction
+  {
+  public:
+    Collection *collection;
+
+    /** The fill of the rewritten nodes, like Options::max_fill_percent. */
+    const float fill_percent;
+
+    /** The number of times the collection changed during the compaction. */
+    uint32_t restarts{};
+
+    /** Compact collection with nodes filled up to Options::max_fill_percent. */
+    explicit Compaction(Collection *collection);
+    Compaction(Collection *collection, float fill_percent);
+
+    /* An unfinished compaction releases the leaves it rewrote. */
+    Compaction(const Compaction &) = delete;
+    Compaction(Compaction &&) = delete;
+    ~Compaction();
+
+    /** Rewrite up to max_pages more leaves, or finish the compaction once
+     ** every leaf is rewritten. Returns whether the compaction is complete.
+     ** Must not be called during a transaction. */
+    [[nodiscard]] auto step(uint32_t max_pages) noexcept -> tl::expected<bool, Error>;
+
+    /** Run the steps until the compaction is complete. */
+    [[nodiscard]] auto run() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    [[nodiscard]] auto is_complete() const noexcept -> bool;
+
+  private:
+    bool started = false;
+    bool complete = false;
+
+    /** The changes and the root of the collection when the compaction started. */
+    uint64_t       changes{};
+    page::Page_num root{};
+
+    /** The key of the next item to rewrite, empty before the first one. */
+    std::vector<uint8_t> next_key;
+
+    /** The leaf being filled. Its page is taken when the leaf before it is
+     ** written, so that leaf is written once, linked to it. */
+    Node candidate;
+
+    /** The rewritten leaves and the separators between them. */
+    std::vector<page::Page_num> leaves;
+    std::vector<node::Item>     separators;
+
+    /** Release the rewritten leaves and start over from the first item. */
+    [[nodiscard]] auto restart() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Add the next item in key order to the candidate leaf, and write the
+     ** candidate once it is full. */
+    [[nodiscard]] auto add(node::Item item) noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Write the last leaves, build the internal levels and switch the root. */
+    [[nodiscard]] auto finish() noexcept -> tl::expected<std::nullptr_t, Error>;
+  };
+
+  /** Write_batch collects puts and removes on a collection and applies them
+   ** together in one transaction. The mutations are sorted by key, the last
+   ** one of a key wins, and all the ones falling in the same leaf are merged
+   ** into it in one pass from a single descent. The leaf is then split once
+   ** into as many nodes as it takes, evenly filled up to
+   ** Options::max_fill_percent, or rebalanced once like after a remove, and
+   ** so are its ancestors. The puts on an empty collection are bulk loaded,
+   ** see Collection::bulk_load. Removing a missing key does nothing. */
+  class Write_batch
+  {
+  public:
+    Collection *collection;
+
+    explicit Write_batch(Collection *collection) : collection(collection) {}
+
+    auto put(std::vector<uint8_t> key, std::vector<uint8_t> value) -> void;
+    auto remove(std::vector<uint8_t> key) -> void;
+
+    /** The number of mutations collected so far. */
+    [[nodiscard]] auto size() const noexcept -> size_t;
+
+    /** Apply the mutations in the active transaction::Transaction, or in a
+     ** new one committed when they all succeed. Nothing is applied if a key
+     ** is larger than Data_access_layer::max_key_size. The batch is empty
+     ** afterwards either way, and can be filled again. */
+    [[nodiscard]] auto commit() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+  private:
+    /** A put, or a remove without value. */
+    class Mutation
+    {
+    public:
+      std::vector<uint8_t>                 key;
+      tl::optional<std::vector<uint8_t>> value;
+    };
+
+    std::vector<Mutation> mutations;
+
+    /** Apply mutations, sorted by key without duplicates, in key order. */
+    [[nodiscard]] auto apply(std::vector<Mutation> &mutations) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
   };
 } // namespace toocal::core::collection
 
@@ -0,0 +1,269 @@
+#include "cursor.h"
+#include "collection.h"
+#include "data_access_layer.h"
+#include <algorithm>
+
+namespace toocal::core::cursor
+{
+  [[nodiscard]] auto Cursor::first() noexcept -> tl::expected<bool, Error>
+  {
+    this->depth = 0;
+    if (0 == this->collection->root)
+      return false;
+
+    return this->descend(this->collection->root, Direction::FORWARD)
+      .and_then([&](const auto &&_) { return this->settle(Direction::FORWARD); })
+      .map([&](const auto &&_) { return this->is_valid(); });
+  }
+
+  [[nodiscard]] auto Cursor::last() noexcept -> tl::expected<bool, Error>
+  {
+    this->depth = 0;
+    if (0 == this->collection->root)
+      return false;
+
+    return this->descend(this->collection->root, Direction::BACKWARD)
+      .and_then([&](const auto &&_) { return this->settle(Direction::BACKWARD); })
+      .map([&](const auto &&_) { return this->is_valid(); });
+  }
+
+  [[nodiscard]] auto Cursor::seek(const std::span<const uint8_t> key) noexcept
+    -> tl::expected<bool, Error>
+  {
+    this->depth = 0;
+    if (0 == this->collection->root)
+      return false;
+
+    auto page_num = this->collection->root;
+
+    while (true)
+      {
+        if (auto result = this->push(page_num, Direction::FORWARD); !result.has_value())
+          return tl::make_unexpected(result.error());
+
+        auto      &frame = this->path[this->depth - 1];
+        const auto node = frame.view();
+        const auto [was_found, index] = node.find_key_in_node(key);
+
+        /* In a leaf, index is the item or where the key would be inserted,
+         * the next item is then in the following leaf if it is past the end. */
+        if (node.is_leaf())
+          {
+            frame.index = frame.prefetched_ahead = frame.prefetched_behind = index;
+            return this->settle(Direction::FORWARD).map([&](const auto &&_) { return this->is_valid(); });
+          }
+
+        frame.index = frame.prefetched_ahead = frame.prefetched_behind =
+          node::Node::child_index(was_found, index);
+        this->read_ahead(frame, Direction::FORWARD);
+        page_num = node.child(frame.index);
+      }
+  }
+
+  [[nodiscard]] auto Cursor::next() noexcept -> tl::expected<bool, Error>
+  {
+    if (!this->is_valid())
+      return false;
+
+    this->path[this->depth - 1].index++;
+    return this->settle(Direction::FORWARD).map([&](const auto &&_) { return this->is_valid(); });
+  }
+
+  [[nodiscard]] auto Cursor::prev() noexcept -> tl::expected<bool, Error>
+  {
+    if (!this->is_valid())
+      return false;
+
+    this->path[this->depth - 1].index--;
+    return this->settle(Direction::BACKWARD).map([&](const auto &&_) { return this->is_valid(); });
+  }
+
+  [[nodiscard]] auto Cursor::is_valid() const noexcept -> bool { return this->depth > 0; }
+
+  [[nodiscard]] auto Cursor::key() const noexcept -> std::span<const uint8_t>
+  {
+    return this->current_key;
+  }
+
+  [[nodiscard]] auto Cursor::value() noexcept -> tl::expected<std::span<const uint8_t>, Error>
+  {
+    const auto &frame = this->path[this->depth - 1];
+    const auto  node = frame.view();
+
+    if (!node.is_overflow(frame.index))
+      return node.value(frame.index);
+
+    const auto item = node.item(frame.index);
+    return this->collection->dal->read_overflow(item.overflow, item.overflow_size)
+      .map([&](auto &&value) {
+        this->overflow_value = std::move(value);
+        return std::span<const uint8_t>{this->overflow_value};
+      });
+  }
+
+  [[nodiscard]] auto Cursor::item() const noexcept -> tl::expected<node::Item, Error>
+  {
+    const auto &frame = this->path[this->depth - 1];
+    auto        item = frame.view().item(frame.index);
+    return this->collection->dal->load_value(item).map([&](const auto &&_) { return std::move(item); });
+  }
+
+  [[nodiscard]] auto Cursor::stored_item() const noexcept -> node::Item
+  {
+    const auto &frame = this->path[this->depth - 1];
+    return frame.view().item(frame.index);
+  }
+
+  [[nodiscard]] auto Cursor::push(const page::Page_num page_num, const Direction direction) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    return this->collection->dal->view_page(page_num).map([&](const auto &data) {
+      if (this->depth == this->path.size())
+        this->path.emplace_back();
+
+      /* The view is only valid until the next call to the data access layer,
+       * the copy reuses the page of a previous frame at this depth. */
+      auto &frame = this->path[this->depth++];
+      frame.page.assign(data.begin(), data.end());
+
+      /* A leaf starts on its first or last item, an internal node on its
+       * first or last child. */
+      const auto node = frame.view();
+      const auto count = static_cast<int64_t>(node.items_count()) + (node.is_leaf() ? 0 : 1);
+
+      frame.index = direction == Direction::FORWARD ? 0 : count - 1;
+      frame.prefetched_ahead = frame.prefetched_behind = frame.index;
+      return nullptr;
+    });
+  }
+
+  [[nodiscard]] auto Cursor::descend(page::Page_num page_num, const Direction direction) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    while (true)
+      {
+        if (auto result = this->push(page_num, direction); !result.has_value())
+          return result;
+
+        auto &frame = this->path[this->depth - 1];
+        if (frame.view().is_leaf())
+          return nullptr;
+
+        this->read_ahead(frame, direction);
+        page_num = frame.view().child(frame.index);
+      }
+  }
+
+  [[nodiscard]] auto Cursor::settle(const Direction direction) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    while (true)
+      {
+        const auto node = this->path[this->depth - 1].view();
+        const auto index = this->path[this->depth - 1].index;
+        if (index >= 0 && index < node.items_count())
+          {
+            const auto prefix = node.prefix();
+            const auto suffix = node.suffix(index);
+            this->current_key.assign(prefix.begin(), prefix.end());
+            this->current_key.insert(this->current_key.end(), suffix.begin(), suffix.end());
+            return nullptr;
+          }
+
+        /* Past the end of the leaf, move to the one linked after or before it.
+         * With copy on write the links of a committed leaf are not kept, the
+         * leaf is the child of the parent follow moved to. */
+        auto sibling = direction == Direction::FORWARD ? node.next() : node.prev();
+        if (auto result = this->follow(direction); !result.has_value())
+          return result;
+
+        if (this->collection->dal->options.copy_on_write)
+          {
+            const auto *parent = 0 == this->depth ? nullptr : &this->path[this->depth - 1];
+            sibling = parent == nullptr ? 0 : parent->view().child(parent->index);
+          }
+
+        if (0 == sibling)
+          {
+            this->depth = 0;
+            return nullptr;
+          }
+
+        if (auto result = this->push(sibling, direction); !result.has_value())
+          return result;
+      }
+  }
+
+  [[nodiscard]] auto Cursor::follow(const Direction direction) noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    /* Find the deepest internal node with a child left in that direction,
+     * the frames below it are entered again on their first or last child. */
+    const auto leaf_depth = this->depth;
+    for (this->depth--; this->depth > 0; this->depth--)
+      {
+        auto &frame = this->path[this->depth - 1];
+
+        if (direction == Direction::FORWARD && frame.index < frame.view().items_count())
+          {
+            frame.index++;
+            break;
+          }
+
+        if (direction == Direction::BACKWARD && frame.index > 0)
+          {
+            frame.index--;
+            break;
+          }
+      }
+
+    /* Without one the sibling is still read, only without reading ahead. */
+    if (0 == this->depth)
+      return nullptr;
+
+    this->read_ahead(this->path[this->depth - 1], direction);
+    while (this->depth < leaf_depth - 1)
+      {
+        const auto &parent = this->path[this->depth - 1];
+        if (auto result = this->push(parent.view().child(parent.index), direction); !result.has_value())
+          {
+            this->depth = 0;
+            return result;
+          }
+
+        this->read_ahead(this->path[this->depth - 1], direction);
+      }
+
+    return nullptr;
+  }
+
+  auto Cursor::read_ahead(Frame &frame, const Direction direction) noexcept -> void
+  {
+    const auto node = frame.view();
+    auto       begin = int64_t{0}, end = int64_t{-1};
+
+    if (direction == Direction::FORWARD)
+      {
+        begin = std::max(frame.index, frame.prefetched_ahead) + 1;
+        end = std::min<int64_t>(frame.index + READ_AHEAD, node.items_count());
+        frame.prefetched_ahead = std::max(frame.prefetched_ahead, end);
+      }
+    else
+      {
+        begin = std::max<int64_t>(frame.index - READ_AHEAD, 0);
+        end = std::min(frame.index, frame.prefetched_behind) - 1;
+        frame.prefetched_behind = std::min(frame.prefetched_behind, begin);
+      }
+
+    /* Siblings written one after the other, as by Collection::bulk_load, are
+     * prefetched with a single hint. */
+    for (auto i = begin; i <= end;)
+      {
+        auto count = uint32_t{1};
+        while (i + count <= end && node.child(i + count) == node.child(i) + count)
+          count++;
+
+        this->collection->dal->prefetch_pages(node.child(i), count);
+        i += count;
+      }
+  }
+} // namespace toocal::core::cursor
@@ -0,0 +1,129 @@
+#ifndef TOOCAL_CORE_CURSOR_H
+#define TOOCAL_CORE_CURSOR_H
+
+#include "errors.hpp"
+#include "node.h"
+#include "page.h"
+#include "tl/expected.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace toocal::core::collection
+{
+  class Collection;
+}
+
+namespace toocal::core::cursor
+{
+  using errors::Error;
+
+  /** Cursor iterates over the items of a collection in key order, in both
+   ** directions. It keeps a copy of the leaf holding its current item, and
+   ** moving past either end of the leaf follows the link to the next or
+   ** previous leaf, never descending again from the root. With
+   ** Options::copy_on_write the links are not kept, the next or previous leaf
+   ** is taken from its parent on the path instead. The items are
+   ** decoded in place with node::Node_view. The internal nodes on the path to
+   ** the leaf are kept as well, only to prefetch the next READ_AHEAD leaves
+   ** in the direction of the move with Data_access_layer::prefetch_pages, so
+   ** a scan does not wait on every leaf.
+   **
+   ** first, last, seek, next and prev return whether the cursor is on an item,
+   ** it is not once it moved past either end. The cursor is invalidated by
+   ** any modification of the collection, seek again afterwards. */
+  class Cursor
+  {
+  public:
+    static constexpr uint32_t READ_AHEAD = 8;
+
+    const collection::Collection *collection;
+
+  private:
+    enum class Direction
+    {
+      FORWARD,
+      BACKWARD,
+    };
+
+    /** A page of the path. The index is the current item in the leaf, the
+     ** last frame, and the child leading to the next frame in the others. */
+    class Frame
+    {
+    public:
+      std::vector<uint8_t> page;
+      int64_t              index;
+
+      /** The children prefetched so far, on both sides. */
+      int64_t prefetched_ahead;
+      int64_t prefetched_behind;
+
+      [[nodiscard]] auto view() const noexcept -> node::Node_view { return node::Node_view{this->page}; }
+    };
+
+    /** The frames beyond depth are kept to reuse their pages. */
+    std::vector<Frame> path;
+    size_t             depth = 0;
+
+    /** The key of the current item, the prefix of its leaf followed by its suffix. */
+    std::vector<uint8_t> current_key;
+
+    /** Holds the value of the current item when it is read from an overflow chain. */
+    std::vector<uint8_t> overflow_value;
+
+  public:
+    explicit Cursor(const collection::Collection *collection) : collection(collection) {}
+
+    /** Move to the smallest item. */
+    [[nodiscard]] auto first() noexcept -> tl::expected<bool, Error>;
+
+    /** Move to the greatest item. */
+    [[nodiscard]] auto last() noexcept -> tl::expected<bool, Error>;
+
+    /** Move to the smallest item whose key is greater than or equal to key. */
+    [[nodiscard]] auto seek(std::span<const uint8_t> key) noexcept -> tl::expected<bool, Error>;
+
+    [[nodiscard]] auto next() noexcept -> tl::expected<bool, Error>;
+    [[nodiscard]] auto prev() noexcept -> tl::expected<bool, Error>;
+
+    /** Whether the cursor is on an item. */
+    [[nodiscard]] auto is_valid() const noexcept -> bool;
+
+    /** The key and the value of the current item. They are only
+     ** valid until the cursor moves, and the cursor must be on an item. A
+     ** value stored in an overflow chain is only read by value, so scanning
+     ** the keys never reads the overflow pages. */
+    [[nodiscard]] auto key() const noexcept -> std::span<const uint8_t>;
+    [[nodiscard]] auto value() noexcept -> tl::expected<std::span<const uint8_t>, Error>;
+
+    /** Copies the current item with its value, the cursor must be on an item. */
+    [[nodiscard]] auto item() const noexcept -> tl::expected<node::Item, Error>;
+
+    /** Copies the current item as it is stored in its node, the value of an
+     ** overflow item is left in its chain. */
+    [[nodiscard]] auto stored_item() const noexcept -> node::Item;
+
+  private:
+    /** Copy page_num onto the path, starting on its first or last entry. */
+    [[nodiscard]] auto push(page::Page_num page_num, Direction direction) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Push page_num and descend to its first or last item. */
+    [[nodiscard]] auto descend(page::Page_num page_num, Direction direction) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** If the leaf is past its items, move to the next or previous leaves
+     ** until one holds the next or previous item. */
+    [[nodiscard]] auto settle(Direction direction) noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Move the internal frames to the parent of the next or previous leaf
+     ** and read ahead from it, leaving the leaf to be pushed. */
+    [[nodiscard]] auto follow(Direction direction) noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Prefetch the siblings after or before the child at the index of frame. */
+    auto read_ahead(Frame &frame, Direction direction) noexcept -> void;
+  };
+} // namespace toocal::core::cursor
+
+#endif /* TOOCAL_CORE_CURSOR_H */
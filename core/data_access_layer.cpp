@@ -1,7 +1,9 @@
 #include "data_access_layer.h"
+#include "collection.h"
 #include "errors.hpp"
 #include "node.h"
 #include "page.h"
+#include "transaction.h"
 #include <algorithm>
 #include <cerrno>
 #include <cstddef>
@@ -9,6 +11,8 @@
 #include "tl/expected.hpp"
 #include <cstdint>
 #include <filesystem>
+#include <fstream>
+#include <mutex>
 #include <vector>
 
 namespace toocal::core::data_access_layer
@@ -18,23 +22,27 @@ namespace toocal::core::data_access_layer
   {
     this->freelist = Freelist{};
     this->meta.freelist_page = this->freelist.get_next_page();
+    this->freelist.pages = {this->meta.freelist_page};
 
     /* To create a database file, first create the missing directory in the path
      * based on path (nothing will be done if it exists), and then construct an
      * empty file through std::ofstream. */
     if (const auto parent = std::filesystem::path{this->path}.parent_path(); !parent.empty())
       create_directories(parent);
-    std::ofstream{this->path}.close();
+    if (!std::ofstream{this->path}.is_open())
+      fatal(fmt::format(
+        "unable to initialize database because {} cannot be created: {}",
+        this->path,
+        std::strerror(errno)));
 
-    this->file = std::fstream{path, std::fstream::out | std::fstream::in};
+    this->storage =
+      storage::open(this->options.storage_backend, this->path, this->options.page_size);
 
-    if (!this->file.is_open())
+    if (this->options.write_ahead_log)
       {
-        this->file.close();
-        fatal(fmt::format(
-          "unable to initialize database because {} cannot be created: {}",
-          this->path,
-          std::strerror(errno)));
+        std::filesystem::remove(this->wal_path());
+        this->wal = std::make_unique<write_ahead_log::Write_ahead_log>(
+          this->wal_path(), this->options.page_size, this->options.commit_delay);
       }
 
     return this->write_freelist()
@@ -44,18 +52,31 @@ namespace toocal::core::data_access_layer
 
         return this->write_node(node);
       })
-      .and_then([&](const auto &&_) { return this->write_meta(this->meta); });
+      .and_then([&](const auto &&_) { return this->write_meta(this->meta); })
+      .and_then([&](const auto &&_) { return this->commit(); });
   }
 
   auto Data_access_layer::load_database() noexcept -> tl::expected<std::nullptr_t, Error>
   {
-    this->file = std::fstream{path, std::fstream::out | std::fstream::in | std::fstream::binary};
+    this->storage =
+      storage::open(this->options.storage_backend, this->path, this->options.page_size);
 
-    if (!this->file.is_open())
+    /* A log left behind is recovered even if it is no longer enabled. */
+    if (this->options.write_ahead_log || std::filesystem::exists(this->wal_path()))
       {
-        this->file.close();
-        fatal(fmt::format(
-          "unable to load database, the {} is not exists: {}", this->path, std::strerror(errno)));
+        auto wal = std::make_unique<write_ahead_log::Write_ahead_log>(
+          this->wal_path(), this->options.page_size, this->options.commit_delay);
+
+        if (auto result = wal->recover(*this->storage); !result.has_value())
+          return result;
+
+        if (this->options.write_ahead_log)
+          this->wal = std::move(wal);
+        else
+          {
+            wal.reset();
+            std::filesystem::remove(this->wal_path());
+          }
       }
 
     return this->read_meta()
@@ -69,7 +90,175 @@ namespace toocal::core::data_access_layer
       });
   }
 
-  auto Data_access_layer::close() noexcept -> void { this->file.close(); }
+  auto Data_access_layer::close() noexcept -> void
+  {
+    if (this->storage == nullptr || !this->storage->is_open())
+      return;
+
+    if (this->transaction != nullptr)
+      this->transaction->rollback();
+
+    /* The retired pages are given back once the snapshots are gone. */
+    (0 == this->reclaim() ? tl::expected<std::nullptr_t, Error>{nullptr} : this->write_freelist())
+      .and_then([&](const auto &&_) { return this->flush(); })
+      .and_then([&](const auto &&_) { return this->commit(); })
+      .and_then([&](const auto &&_) -> tl::expected<std::nullptr_t, Error> {
+        if (this->wal == nullptr)
+          return nullptr;
+        return this->checkpoint();
+      })
+      .map_error([&](auto &&error) {
+        error.append("flush error in Data_access_layer::close");
+        return error.panic();
+      });
+
+    this->storage->close();
+
+    if (this->wal != nullptr)
+      {
+        this->wal.reset();
+        std::filesystem::remove(this->wal_path());
+      }
+  }
+
+  /** The value of a collection in the catalog: its root. */
+  static auto _root_value(const page::Page_num root) noexcept -> std::vector<uint8_t>
+  {
+    auto value = std::vector<uint8_t>(sizeof(page::Page_num));
+    endian::little_endian::put(root, value.data());
+    return value;
+  }
+
+  [[nodiscard]] auto Data_access_layer::open_catalog() noexcept -> collection::Collection &
+  {
+    this->catalog.root = this->meta.root;
+    return this->catalog;
+  }
+
+  [[nodiscard]] auto Data_access_layer::create_collection(std::vector<uint8_t> name) noexcept
+    -> tl::expected<collection::Collection *, Error>
+  {
+    if (this->transaction != nullptr)
+      return Err("a collection cannot be created during a transaction");
+
+    if (auto collection = this->get_collection(name); !collection.has_value())
+      return collection;
+    else if (collection.value() != nullptr)
+      return Err(fmt::format("the collection {} exists", std::string{name.begin(), name.end()}));
+
+    auto &catalog = this->open_catalog();
+    auto  transaction = transaction::Transaction{this};
+    return catalog.put(name, _root_value(0))
+      .and_then([&](const auto &&_) {
+        this->meta.root = catalog.root;
+        return transaction.commit();
+      })
+      .map([&](const auto &&_) {
+        auto &collection = this->collections[std::string{name.begin(), name.end()}];
+        collection = std::make_unique<collection::Collection>(this, std::move(name), 0);
+        return collection.get();
+      });
+  }
+
+  [[nodiscard]] auto Data_access_layer::get_collection(const std::vector<uint8_t> &name) noexcept
+    -> tl::expected<collection::Collection *, Error>
+  {
+    const auto key = std::string{name.begin(), name.end()};
+    if (const auto collection = this->collections.find(key); collection != this->collections.end())
+      return collection->second.get();
+
+    return this->open_catalog().find(name).map([&](const auto &&item) -> collection::Collection * {
+      if (item == tl::nullopt)
+        return nullptr;
+
+      const auto root = endian::little_endian::get<page::Page_num>(item->value.data());
+      auto      &collection = this->collections[key];
+      collection = std::make_unique<collection::Collection>(this, name, root);
+      return collection.get();
+    });
+  }
+
+  [[nodiscard]] auto Data_access_layer::drop_collection(const std::vector<uint8_t> &name) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (this->transaction != nullptr)
+      return Err("a collection cannot be dropped during a transaction");
+
+    const auto collection = this->get_collection(name);
+    if (!collection.has_value())
+      return tl::make_unexpected(collection.error());
+    if (collection.value() == nullptr)
+      return Err(fmt::format("the collection {} does not exist", std::string{name.begin(), name.end()}));
+
+    auto transaction = transaction::Transaction{this};
+
+    /* Release the tree, depth first, and the overflow chains of its leaves. */
+    for (auto pages = std::vector<page::Page_num>{collection.value()->root};
+         0 != collection.value()->root && !pages.empty();)
+      {
+        const auto page_num = pages.back();
+        pages.pop_back();
+
+        const auto node = this->get_node(page_num);
+        if (!node.has_value())
+          return tl::make_unexpected(node.error());
+
+        for (const auto &item : node->items)
+          if (item.is_overflow())
+            if (auto result = this->delete_overflow(item.overflow, item.overflow_size); !result.has_value())
+              return result;
+
+        pages.insert(pages.end(), node->children.begin(), node->children.end());
+        this->delete_node(page_num);
+      }
+
+    auto &catalog = this->open_catalog();
+    return catalog.remove(name)
+      .and_then([&](const auto &&_) {
+        this->meta.root = catalog.root;
+        return transaction.commit();
+      })
+      .map([&](const auto &&_) {
+        this->collections.erase(std::string{name.begin(), name.end()});
+        return nullptr;
+      });
+  }
+
+  [[nodiscard]] auto Data_access_layer::write_root(const collection::Collection &collection) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    const auto cached = this->collections.find(std::string{collection.name.begin(), collection.name.end()});
+    if (cached == this->collections.end() || cached->second.get() != &collection)
+      return nullptr;
+
+    auto &catalog = this->open_catalog();
+    return catalog.put(collection.name, _root_value(collection.root)).map([&](const auto &&_) {
+      this->meta.root = catalog.root;
+      return nullptr;
+    });
+  }
+
+  [[nodiscard]] auto Data_access_layer::is_catalog(const collection::Collection &collection) const noexcept
+    -> bool
+  {
+    return &collection == &this->catalog;
+  }
+
+  [[nodiscard]] auto Data_access_layer::flush() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    return this->page_cache.flush().and_then([&](const auto &&_) {
+      return this->storage->flush();
+    });
+  }
+
+  [[nodiscard]] auto Data_access_layer::sync() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    return this->flush().and_then([&](const auto &&_) {
+      const auto lock = std::lock_guard{this->mutex};
+      return this->storage->sync();
+    });
+  }
 
   [[nodiscard]] auto Data_access_layer::allocate_empty_page(
     const page::Page_num page_num = -1) const noexcept -> Page
@@ -80,93 +269,613 @@ namespace toocal::core::data_access_layer
   [[nodiscard]] auto Data_access_layer::write_page(const Page &page) noexcept
     -> tl::expected<std::nullptr_t, Error>
   {
-    if (this->file.seekp(static_cast<int64_t>(page.page_num * this->options.page_size)).fail())
-      return Err(std::strerror(errno));
+    const auto lock = std::lock_guard{this->mutex};
+    if (this->transaction != nullptr && this->transaction->is_staging())
+      {
+        this->transaction->stage(page);
+        return nullptr;
+      }
 
-    if (this->file
-          .write(
-            reinterpret_cast<const char *>(page.data.data()),
-            static_cast<int64_t>(page.data.size()))
-          .fail())
-      return Err(std::strerror(errno));
+    this->statistics.pages_written++;
 
-    return nullptr;
+    if (!this->page_cache.enabled())
+      return this->write_page_to_file(page);
+
+    return this->cache_page(Page{page}, false);
+  }
+
+  [[nodiscard]] auto Data_access_layer::cache_page(Page page, const bool staged) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    /* A commit may still fail, its pages stay pinned so they are not
+     * written back before it is logged. */
+    if (this->transaction == nullptr)
+      return this->page_cache.put(std::move(page), true).map([](const auto &&_) { return nullptr; });
+
+    const auto page_num = page.page_num;
+    auto       replaced = tl::optional<Page>{};
+    if (auto *frame = this->page_cache.find(page_num); frame != nullptr && frame->dirty)
+      replaced = std::move(frame->page);
+
+    return this->page_cache.put(std::move(page), true).map([&](const auto &&_) {
+      this->page_cache.pin(page_num);
+      this->written_pages.push_back(Written_page{page_num, std::move(replaced), staged});
+      return nullptr;
+    });
+  }
+
+  [[nodiscard]] auto
+    Data_access_layer::write_page(const page::Page_num page_num, const std::span<const uint8_t> data) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    if (this->transaction != nullptr && this->transaction->is_staging())
+      {
+        this->transaction->stage(page_num, data);
+        return nullptr;
+      }
+
+    return this->write_page(Page{page_num, {data.begin(), data.end()}});
+  }
+
+  [[nodiscard]] auto Data_access_layer::write_pages(std::span<Page *const> pages) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    if (this->transaction != nullptr && this->transaction->is_staging())
+      {
+        for (auto *page : pages)
+          this->transaction->stage(std::move(*page));
+        return nullptr;
+      }
+
+    this->statistics.pages_written += pages.size();
+
+    if (this->page_cache.enabled())
+      {
+        for (auto *page : pages)
+          if (auto result = this->cache_page(std::move(*page), true); !result.has_value())
+            return result;
+        return nullptr;
+      }
+
+    return this->write_pages_to_file(std::vector<const Page *>{pages.begin(), pages.end()});
   }
 
   [[nodiscard]] auto Data_access_layer::read_page(page::Page_num page_num) noexcept
     -> tl::expected<Page, Error>
   {
+    const auto lock = std::lock_guard{this->mutex};
+    if (this->transaction != nullptr)
+      if (const auto *page = this->transaction->find(page_num); page != nullptr)
+        return *page;
+
+    if (!this->page_cache.enabled())
+      return this->read_page_from_file(page_num);
+
+    if (const auto *page = this->page_cache.get(page_num); page != nullptr)
+      return *page;
+
+    return this->read_page_from_file(page_num).and_then([&](auto &&page) {
+      return this->page_cache.put(std::move(page), false).map([](const auto *page) {
+        return *page;
+      });
+    });
+  }
+
+  [[nodiscard]] auto Data_access_layer::active_transaction() const noexcept
+    -> transaction::Transaction *
+  {
+    return this->writer_thread.load() == std::this_thread::get_id() ? this->transaction : nullptr;
+  }
+
+  [[nodiscard]] auto Data_access_layer::commit() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    return this->log_commit().and_then([&](const auto lsn) { return this->sync_commit(lsn); });
+  }
+
+  [[nodiscard]] auto Data_access_layer::log_commit() noexcept
+    -> tl::expected<write_ahead_log::Lsn, Error>
+  {
+    if (this->wal == nullptr)
+      return 0;
+
+    /* Only handing the pages to the log needs the mutex, the snapshots keep
+     * reading while the commit waits for its fsync. */
+    const auto lock = std::lock_guard{this->mutex};
+    return this->page_cache.flush().map([&](const auto &&_) {
+      return this->wal->commit(this->wal_batch);
+    });
+  }
+
+  [[nodiscard]] auto Data_access_layer::sync_commit(const write_ahead_log::Lsn lsn) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (this->wal == nullptr)
+      return nullptr;
+
+    return this->wal->sync(lsn).and_then([&](const auto &&_) -> tl::expected<std::nullptr_t, Error> {
+      if (this->wal->size() < this->options.checkpoint_pages)
+        return nullptr;
+      return this->checkpoint();
+    });
+  }
+
+  auto Data_access_layer::keep_written_pages() noexcept -> void
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    for (const auto &page : this->written_pages)
+      this->page_cache.unpin(page.page_num);
+    this->written_pages.clear();
+  }
+
+  auto Data_access_layer::discard_written_pages() noexcept -> void
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    for (const auto &page : this->written_pages)
+      this->page_cache.unpin(page.page_num);
+
+    /* Backwards, a page written twice gets the image it had before the
+     * commit. The staged pages go back to the transaction. */
+    for (auto page = this->written_pages.rbegin(); page != this->written_pages.rend(); page++)
+      {
+        if (auto *frame = this->page_cache.find(page->page_num); page->staged && frame != nullptr)
+          this->transaction->stage(std::move(frame->page));
+
+        this->page_cache.invalidate(page->page_num);
+        if (page->replaced.has_value())
+          this->page_cache.put(std::move(page->replaced.value()), true).map_error([&](auto &&error) {
+            error.append("write back error in Data_access_layer::discard_written_pages");
+            return error.panic();
+          });
+      }
+    this->written_pages.clear();
+
+    this->wal_batch.clear();
+    this->freelist_images.clear();
+  }
+
+  [[nodiscard]] auto Data_access_layer::checkpoint() noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    /* The transaction of another thread reads the pages of the log. */
+    const auto writer = std::lock_guard{this->writer};
+    const auto lock = std::lock_guard{this->mutex};
+    if (this->wal == nullptr)
+      return nullptr;
+
+    return this->wal->checkpoint(*this->storage);
+  }
+
+  [[nodiscard]] auto Data_access_layer::truncate() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    if (this->transaction != nullptr)
+      return Err("the file cannot be truncated during a transaction");
+
+    if (0 == this->freelist.trim())
+      return nullptr;
+
+    return this->write_freelist()
+      .and_then([&](const auto &&_) { return this->flush(); })
+      .and_then([&](const auto &&_) { return this->commit(); })
+      .and_then([&](const auto &&_) { return this->checkpoint(); })
+      .and_then([&](const auto &&_) { return this->storage->truncate(this->freelist.max_page + 1); });
+  }
+
+  [[nodiscard]] auto Data_access_layer::wal_path() const noexcept -> std::string
+  {
+    return this->path + "-wal";
+  }
+
+  [[nodiscard]] auto Data_access_layer::view_page(page::Page_num page_num) noexcept
+    -> tl::expected<std::span<const uint8_t>, Error>
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    /* The active transaction holds the newest image of the pages it wrote. */
+    if (this->transaction != nullptr)
+      if (const auto *page = this->transaction->find(page_num); page != nullptr)
+        return std::span<const uint8_t>{page->data};
+
+    /* The page cache may hold a newer image than the log or the storage. */
+    if (this->page_cache.enabled())
+      if (const auto *page = this->page_cache.get(page_num); page != nullptr)
+        return std::span<const uint8_t>{page->data};
+
+    /* The log holds the latest image of the pages written since the last checkpoint. */
+    if (const auto data = this->find_logged_page(page_num); data.has_value())
+      return data.value();
+
+    auto view = this->storage->view(page_num);
+    if (!view.has_value())
+      return tl::make_unexpected(view.error());
+
+    if (view->has_value())
+      return view->value();
+
+    if (this->page_cache.enabled())
+      return this->read_page_from_file(page_num).and_then([&](auto &&page) {
+        return this->page_cache.put(std::move(page), false).map([](const auto *page) {
+          return std::span<const uint8_t>{page->data};
+        });
+      });
+
+    return this->read_page_from_file(page_num).map([&](auto &&page) {
+      this->scratch_page = std::move(page);
+      return std::span<const uint8_t>{this->scratch_page.data};
+    });
+  }
+
+  auto Data_access_layer::prefetch_pages(const page::Page_num page_num, const uint32_t count) noexcept
+    -> void
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    const auto is_resident = [&](const page::Page_num page_num) {
+      return (this->transaction != nullptr && this->transaction->find(page_num) != nullptr)
+             || (this->page_cache.enabled() && this->page_cache.contains(page_num))
+             || this->find_logged_page(page_num).has_value();
+    };
+
+    /* A batched storage reads the missing pages into the page cache at once,
+     * at most half of the cache so they do not evict each other. The pages
+     * are only a hint, they are dropped if the batch fails. */
+    if (this->storage->is_batched() && this->page_cache.enabled())
+      {
+        auto pages = std::vector<Page>{};
+        for (auto page = page_num;
+             page < page_num + count && pages.size() < this->options.page_cache_capacity / 2;
+             page++)
+          if (!is_resident(page))
+            pages.push_back(this->allocate_empty_page(page));
+
+        auto requests = std::vector<storage::Read_request>{};
+        requests.reserve(pages.size());
+        for (auto &page : pages)
+          requests.push_back({page.page_num, page.data});
+
+        if (!this->storage->read_batch(requests).has_value())
+          return;
+
+        this->statistics.pages_read += pages.size();
+        this->statistics.pages_prefetched += pages.size();
+        for (auto &page : pages)
+          if (!this->page_cache.put(std::move(page), false).has_value())
+            return;
+        return;
+      }
+
+    /* Coalesce the missing pages into runs, one hint per run. */
+    for (page::Page_num first = page_num; first < page_num + count;)
+      {
+        if (is_resident(first))
+          {
+            first++;
+            continue;
+          }
+
+        auto last = first + 1;
+        while (last < page_num + count && !is_resident(last))
+          last++;
+
+        this->storage->prefetch(first, static_cast<uint32_t>(last - first));
+        this->statistics.pages_prefetched += last - first;
+        first = last;
+      }
+  }
+
+  [[nodiscard]] auto Data_access_layer::pin_page(page::Page_num page_num) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    if (!this->page_cache.enabled() || this->page_cache.pin(page_num))
+      return nullptr;
+
+    return this->read_page(page_num).map([&](const auto &&_) {
+      this->page_cache.pin(page_num);
+      return nullptr;
+    });
+  }
+
+  auto Data_access_layer::unpin_page(page::Page_num page_num) noexcept -> void
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    this->page_cache.unpin(page_num);
+  }
+
+  [[nodiscard]] auto Data_access_layer::write_page_to_file(const Page &page) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (this->wal != nullptr)
+      {
+        this->wal->append(this->wal_batch, page);
+        return nullptr;
+      }
+
+    return this->storage->write(page.page_num, page.data);
+  }
+
+  [[nodiscard]] auto Data_access_layer::write_pages_to_file(std::span<const Page *const> pages) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (this->wal != nullptr)
+      {
+        for (const auto *page : pages)
+          this->wal->append(this->wal_batch, *page);
+        return nullptr;
+      }
+
+    auto requests = std::vector<storage::Write_request>{};
+    requests.reserve(pages.size());
+    for (const auto *page : pages)
+      requests.push_back({page->page_num, page->data});
+
+    return this->storage->write_batch(requests);
+  }
+
+  [[nodiscard]] auto Data_access_layer::find_logged_page(const page::Page_num page_num) const noexcept
+    -> tl::optional<std::span<const uint8_t>>
+  {
+    if (this->wal == nullptr)
+      return tl::nullopt;
+
+    /* The batch holds pages newer than the committed ones. */
+    if (const auto data = this->wal_batch.find(page_num); data.has_value())
+      return data;
+
+    if (const auto *data = this->wal->find(page_num); data != nullptr)
+      return std::span<const uint8_t>{*data};
+    return tl::nullopt;
+  }
+
+  [[nodiscard]] auto Data_access_layer::read_page_from_file(page::Page_num page_num) noexcept
+    -> tl::expected<Page, Error>
+  {
+    this->statistics.pages_read++;
+
+    auto page = this->allocate_empty_page(page_num);
+    if (const auto data = this->find_logged_page(page_num); data.has_value())
+      {
+        std::ranges::copy(data.value(), page.data.begin());
+        return page;
+      }
+
+    return this->storage->read(page_num, page.data).map([&](const auto &&_) {
+      return std::move(page);
+    });
+  }
+
+  [[nodiscard]] auto Data_access_layer::read_page_uncached(page::Page_num page_num) noexcept
+    -> tl::expected<Page, Error>
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    if (this->transaction != nullptr)
+      if (const auto *page = this->transaction->find(page_num); page != nullptr)
+        return *page;
+
+    if (this->page_cache.enabled())
+      if (const auto *page = this->page_cache.get(page_num); page != nullptr)
+        return *page;
+
+    return this->read_page_from_file(page_num);
+  }
+
+  [[nodiscard]] auto Data_access_layer::read_committed_page(page::Page_num page_num) noexcept
+    -> tl::expected<Page, Error>
+  {
+    {
+      const auto lock = std::lock_guard{this->mutex};
+
+      if (this->page_cache.enabled())
+        if (const auto *page = this->page_cache.get(page_num); page != nullptr)
+          return *page;
+
+      if (!this->storage->is_thread_safe())
+        return this->read_page_from_file(page_num);
+
+      this->statistics.pages_read++;
+    }
+
+    /* The write-ahead log has its own lock, and a thread safe storage is read
+     * while the writer goes on. */
     auto page = this->allocate_empty_page(page_num);
+    if (this->wal != nullptr && this->wal->read(page_num, page.data))
+      return page;
 
-    if (this->file.seekg(static_cast<int64_t>(page_num * this->options.page_size)).fail())
-      return Err(std::strerror(errno));
+    return this->storage->read(page_num, page.data).map([&](const auto &&_) {
+      return std::move(page);
+    });
+  }
 
-    if (this->file
-          .read(reinterpret_cast<char *>(page.data.data()), static_cast<int64_t>(page.data.size()))
-          .fail())
-      return Err(std::strerror(errno));
+  [[nodiscard]] auto Data_access_layer::acquire_epoch() noexcept -> uint64_t
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    this->snapshots.insert(this->epoch);
+    return this->epoch;
+  }
 
-    return page;
+  auto Data_access_layer::release_epoch(const uint64_t epoch) noexcept -> void
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    if (const auto snapshot = this->snapshots.find(epoch); snapshot != this->snapshots.end())
+      this->snapshots.erase(snapshot);
+  }
+
+  auto Data_access_layer::reclaim() noexcept -> uint64_t
+  {
+    const auto lock = std::lock_guard{this->mutex};
+
+    /* A snapshot of epoch e reads the trees committed by the first e commits,
+     * the pages retired by the following commits are still part of them. */
+    auto count = uint64_t{0};
+    while (!this->retired.empty()
+           && (this->snapshots.empty() || this->retired.front().first < *this->snapshots.begin()))
+      {
+        for (const auto page_num : this->retired.front().second)
+          this->freelist.release_page(page_num);
+
+        count += this->retired.front().second.size();
+        this->retired.pop_front();
+      }
+
+    return count;
+  }
+
+  auto Data_access_layer::publish(std::vector<page::Page_num> retired) noexcept -> void
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    if (!retired.empty())
+      this->retired.emplace_back(this->epoch, std::move(retired));
+    this->epoch++;
   }
 
   [[nodiscard]] auto Data_access_layer::read_freelist() noexcept -> tl::expected<Freelist, Error>
   {
-    return this->read_page(this->meta.freelist_page).and_then([&](const auto &page) {
-      return types::Serializer<Freelist>::deserialize(page.data);
-    });
+    auto pages = std::vector<page::Page_num>{};
+    auto buffer = std::vector<uint8_t>{};
+
+    /* Follow the chain from the first page, the next page is the first field
+     * after max_page. */
+    for (auto page_num = this->meta.freelist_page; page_num != 0;)
+      {
+        if (std::ranges::find(pages, page_num) != pages.end())
+          return Err(fmt::format("the freelist chain loops back to page {}", page_num));
+
+        auto page = this->read_page(page_num);
+        if (!page.has_value())
+          return tl::make_unexpected(page.error());
+
+        pages.push_back(page_num);
+        buffer.insert(buffer.end(), page->data.begin(), page->data.end());
+        page_num = endian::little_endian::get<page::Page_num>(
+          page->data.data() + (pages.size() == 1 ? sizeof(page::Page_num) : 0));
+      }
+
+    return types::Serializer<Freelist>::deserialize(buffer, pages, this->options.page_size)
+      .map([&](auto &&freelist) {
+        this->freelist_images.clear();
+        for (size_t i = 0; i < pages.size(); i++)
+          this->freelist_images.emplace_back(
+            buffer.begin() + i * this->options.page_size,
+            buffer.begin() + (i + 1) * this->options.page_size);
+        return std::move(freelist);
+      });
   }
 
   [[nodiscard]] auto Data_access_layer::write_freelist() noexcept
     -> tl::expected<std::nullptr_t, Error>
   {
-    auto page = this->allocate_empty_page(this->meta.freelist_page);
-    return types::Serializer<Freelist>::serialize(this->freelist).and_then([&](const auto &data) {
-      std::copy(data.begin(), data.end(), page.data.begin());
-      return this->write_page(page);
-    });
+    this->freelist.reserve_pages(this->options.page_size);
+
+    /* Staged pages may be rolled back, the images would not match the file anymore. */
+    const auto staging = this->transaction != nullptr && this->transaction->is_staging();
+    if (staging)
+      this->freelist_images.clear();
+
+    return types::Serializer<Freelist>::serialize(this->freelist, this->options.page_size)
+      .and_then([&](const auto &data) -> tl::expected<std::nullptr_t, Error> {
+        this->freelist_images.resize(this->freelist.pages.size());
+
+        for (size_t i = 0; i < this->freelist.pages.size(); i++)
+          {
+            const auto image = std::span{data}.subspan(i * this->options.page_size, this->options.page_size);
+            if (std::ranges::equal(image, this->freelist_images[i]))
+              continue;
+
+            auto page = this->allocate_empty_page(this->freelist.pages[i]);
+            std::ranges::copy(image, page.data.begin());
+
+            if (auto result = this->write_page(page); !result.has_value())
+              return result;
+
+            if (!staging)
+              this->freelist_images[i].assign(image.begin(), image.end());
+          }
+
+        return nullptr;
+      });
   }
 
   [[nodiscard]] auto Data_access_layer::read_meta() noexcept -> tl::expected<Meta, Error>
   {
-    return this->read_page(Meta::PAGE_NUM).and_then([&](const auto &page) {
-      return types::Serializer<Meta>::deserialize(page.data);
-    });
+    /* The valid copy of the highest generation. */
+    auto meta = tl::optional<Meta>{};
+    auto errors = std::vector<std::string>{};
+
+    for (page::Page_num page_num = 0; page_num < Meta::PAGES; page_num++)
+      {
+        const auto copy = this->read_page(page_num).and_then(
+          [&](const auto &page) { return types::Serializer<Meta>::deserialize(page.data); });
+
+        if (!copy.has_value())
+          errors.push_back(copy.error().message);
+        else if (meta == tl::nullopt || copy->generation > meta->generation)
+          meta = copy.value();
+      }
+
+    if (meta == tl::nullopt)
+      return Err(fmt::format("no valid meta page in {}: {}", this->path, fmt::join(errors, ", ")));
+
+    return meta.value();
   }
 
   [[nodiscard]] auto Data_access_layer::write_meta(const Meta &meta) noexcept
     -> tl::expected<std::nullptr_t, Error>
   {
-    auto page = this->allocate_empty_page(Meta::PAGE_NUM);
-    return types::Serializer<Meta>::serialize(meta).and_then([&](const auto &data) {
-      std::copy(data.begin(), data.end(), page.data.begin());
-      return this->write_page(page);
-    });
+    /* The copy of the previous generation is left untouched. */
+    auto next = meta;
+    next.generation = this->meta.generation + 1;
+
+    /* The nodes of a committed tree are never overwritten, so the meta only
+     * has to reach the file after the pages it points to. The log orders
+     * them otherwise. */
+    const auto ordered = this->wal == nullptr && this->options.copy_on_write
+                         && (this->transaction == nullptr || !this->transaction->is_staging());
+    const auto barrier = [&]() -> tl::expected<std::nullptr_t, Error> {
+      if (!ordered)
+        return nullptr;
+      return this->sync();
+    };
+
+    auto page = this->allocate_empty_page(next.page_num());
+    return types::Serializer<Meta>::serialize(next)
+      .and_then([&](const auto &data) {
+        std::copy(data.begin(), data.end(), page.data.begin());
+        return barrier();
+      })
+      .and_then([&](const auto &&_) { return this->write_page(page); })
+      .and_then([&](const auto &&_) { return barrier(); })
+      .map([&](const auto &&_) {
+        this->meta.generation = next.generation;
+        return nullptr;
+      });
   }
 
   [[nodiscard]] auto Data_access_layer::write_node(Node &node) noexcept
     -> tl::expected<std::nullptr_t, Error>
   {
-    auto page = this->allocate_empty_page();
     if (node.page_num == 0)
-      {
-        page.page_num = this->freelist.get_next_page();
-        node.page_num = page.page_num;
-      }
-    else
-      page.page_num = node.page_num;
+      node.page_num = this->freelist.get_next_page();
 
-    return types::Serializer<Node>::serialize(node).and_then([&](const auto &data) {
-      std::copy(data.begin(), data.end(), page.data.begin());
-      return this->write_page(page);
+    /* A page staged before is overwritten in place. */
+    const auto lock = std::lock_guard{this->mutex};
+    this->node_buffer.assign(this->options.page_size, 0);
+    return types::Serializer<Node>::serialize(node, this->node_buffer).and_then([&](const auto &&_) {
+      return this->write_page(node.page_num, this->node_buffer);
     });
   }
 
   [[nodiscard]] auto Data_access_layer::get_node(page::Page_num page_num) noexcept
     -> tl::expected<Node, Error>
   {
-    return this->read_page(page_num)
-      .and_then([](const auto&page) { return types::Serializer<Node>::deserialize(page.data); })
-      .map([&](const auto &node) { return Node{this, page_num, node.items, node.children}; });
+    auto node = this->view_page(page_num).and_then([](const auto &data) {
+      return types::Serializer<Node>::deserialize(data);
+    });
+
+    if (node.has_value())
+      {
+        node->dal = this;
+        node->page_num = page_num;
+      }
+    return node;
   }
 
   [[nodiscard]] auto Data_access_layer::max_threshold() const noexcept -> float
@@ -184,18 +893,52 @@ namespace toocal::core::data_access_layer
     return static_cast<float>(node.size()) < this->min_threshold();
   }
 
+  [[nodiscard]] auto
+    Data_access_layer::is_under_populated(const std::span<const node::Item_view> items) const noexcept -> bool
+  {
+    return static_cast<float>(Node::size(items)) < this->min_threshold();
+  }
+
   [[nodiscard]] auto Data_access_layer::is_over_populated(const Node &node) const noexcept -> bool
   {
-    return static_cast<float>(node.size()) > this->max_threshold();
+    return node.items.size() > 2
+           && (static_cast<float>(node.size()) > this->max_threshold()
+               || node.serialized_size() > this->options.page_size);
+  }
+
+  [[nodiscard]] auto
+    Data_access_layer::is_over_populated(const std::span<const node::Item_view> items) const noexcept -> bool
+  {
+    return items.size() > 2
+           && (static_cast<float>(Node::size(items)) > this->max_threshold()
+               || Node::serialized_size(items) > this->options.page_size);
+  }
+
+  [[nodiscard]] auto Data_access_layer::max_item_size() const noexcept -> uint32_t
+  {
+    return this->options.page_size / 8;
+  }
+
+  [[nodiscard]] auto Data_access_layer::max_key_size() const noexcept -> uint32_t
+  {
+    return this->max_item_size() - sizeof(page::Page_num);
   }
 
   [[nodiscard]] auto Data_access_layer::get_split_index(const Node &node) const noexcept -> uint32_t
   {
-    auto size = Node::HEADER_SIZE;
+    const auto prefix_size = node.prefix_size();
+    auto       size = Node::HEADER_SIZE + prefix_size;
+    auto       serialized_size = size;
 
     for (uint32_t i = 0; i < node.items.size(); i++)
       {
-        size += node.item_size(i);
+        size += node.item_size(i) - prefix_size;
+        serialized_size += sizeof(Node::Fingerprint) + sizeof(uint16_t) + node.items[i].cell_size(prefix_size)
+                           + (node.is_leaf() ? 0 : sizeof(page::Page_num));
+
+        /* An item past the end of the page starts the other side. */
+        if (serialized_size > this->options.page_size && i > 0)
+          return i;
 
         /* if we have a big enough page size (more than minimum), and didn't
          * reach the last node, which means we can spare an element. */
@@ -208,13 +951,131 @@ namespace toocal::core::data_access_layer
 
   auto Data_access_layer::delete_node(page::Page_num page_num) noexcept -> void
   {
-    this->freelist.release_page(page_num);
+    this->release_page(page_num);
+  }
+
+  auto Data_access_layer::release_page(const page::Page_num page_num) noexcept -> void
+  {
+    if (!this->options.copy_on_write)
+      this->freelist.release_page(page_num);
+    else if (this->transaction != nullptr)
+      this->transaction->retire(page_num);
+    else
+      {
+        const auto lock = std::lock_guard{this->mutex};
+        this->retired.emplace_back(this->epoch, std::vector{page_num});
+      }
+  }
+
+  [[nodiscard]] auto Data_access_layer::overflow_pages(const uint32_t size) const noexcept
+    -> uint32_t
+  {
+    const auto page_data_size = this->options.page_size - sizeof(page::Page_num);
+    return (size + page_data_size - 1) / page_data_size;
+  }
+
+  [[nodiscard]] auto Data_access_layer::write_overflow(const std::span<const uint8_t> value) noexcept
+    -> tl::expected<page::Page_num, Error>
+  {
+    /* The pages are allocated first, every page must know the next one, and
+     * every page is allocated near the previous one. */
+    auto pages = std::vector<page::Page_num>(this->overflow_pages(value.size()));
+    for (size_t i = 0; i < pages.size(); i++)
+      pages[i] = this->freelist.get_next_page(0 == i ? 0 : pages[i - 1]);
+
+    const auto page_data_size = this->options.page_size - sizeof(page::Page_num);
+    for (size_t i = 0; i < pages.size(); i++)
+      {
+        auto       page = this->allocate_empty_page(pages[i]);
+        const auto data = value.subspan(
+          i * page_data_size, std::min<size_t>(page_data_size, value.size() - i * page_data_size));
+
+        endian::little_endian::put(
+          i + 1 < pages.size() ? pages[i + 1] : page::Page_num{0}, page.data.data());
+        std::copy(data.begin(), data.end(), page.data.begin() + sizeof(page::Page_num));
+
+        if (auto result = this->write_page(page); !result.has_value())
+          return tl::make_unexpected(result.error());
+      }
+
+    return pages.empty() ? page::Page_num{0} : pages.front();
+  }
+
+  [[nodiscard]] auto Data_access_layer::read_overflow(page::Page_num page_num, const uint32_t size) noexcept
+    -> tl::expected<std::vector<uint8_t>, Error>
+  {
+    auto value = std::vector<uint8_t>{};
+    value.reserve(size);
+
+    while (value.size() < size)
+      {
+        if (0 == page_num)
+          return Err(fmt::format("the overflow chain of {} bytes ends after {}", size, value.size()));
+
+        auto page = this->read_page_uncached(page_num);
+        if (!page.has_value())
+          return tl::make_unexpected(page.error());
+
+        const auto data_size =
+          std::min<size_t>(this->options.page_size - sizeof(page::Page_num), size - value.size());
+        const auto data = page->data.begin() + sizeof(page::Page_num);
+
+        value.insert(value.end(), data, data + data_size);
+        page_num = endian::little_endian::get<page::Page_num>(page->data.data());
+      }
+
+    return value;
+  }
+
+  [[nodiscard]] auto Data_access_layer::delete_overflow(page::Page_num page_num, const uint32_t size) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    for (auto count = this->overflow_pages(size); count > 0; count--)
+      {
+        auto page = this->read_page_uncached(page_num);
+        if (!page.has_value())
+          return tl::make_unexpected(page.error());
+
+        this->release_page(page_num);
+        page_num = endian::little_endian::get<page::Page_num>(page->data.data());
+      }
+
+    return nullptr;
+  }
+
+  [[nodiscard]] auto Data_access_layer::store_value(node::Item &item) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (item.is_overflow() || item.key.size() + item.value.size() <= this->max_item_size())
+      return nullptr;
+
+    return this->write_overflow(item.value).map([&](const auto page_num) {
+      item.overflow = page_num;
+      item.overflow_size = item.value.size();
+      item.value = {};
+      return nullptr;
+    });
+  }
+
+  [[nodiscard]] auto Data_access_layer::load_value(node::Item &item) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (!item.is_overflow())
+      return nullptr;
+
+    return this->read_overflow(item.overflow, item.overflow_size).map([&](auto &&value) {
+      item.value = std::move(value);
+      item.overflow = 0;
+      item.overflow_size = 0;
+      return nullptr;
+    });
   }
 
   [[nodiscard]] auto Data_access_layer::new_node(
-    std::deque<node::Item> items, std::deque<page::Page_num> children) noexcept -> Node
+    std::deque<node::Item> items, std::deque<page::Page_num> children, const page::Page_num hint) noexcept
+    -> Node
   {
-    return Node{this, this->freelist.get_next_page(), std::move(items), std::move(children)};
+    return Node{this, this->freelist.get_next_page(hint), std::move(items), std::move(children)};
   }
 
 } // namespace toocal::core::data_access_layer
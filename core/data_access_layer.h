@@ -1,19 +1,37 @@
 #ifndef TOOCAL_CORE_DATA_ACCESS_LAYER_H
 #define TOOCAL_CORE_DATA_ACCESS_LAYER_H
 
+#include "arena.h"
+#include "collection.h"
 #include "errors.hpp"
 #include "freelist.h"
 #include "meta.h"
 #include "node.h"
 #include "page.h"
+#include "page_cache.h"
+#include "storage.h"
+#include "write_ahead_log.h"
 #include "tl/expected.hpp"
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
-#include <fstream>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <span>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 
+namespace toocal::core::transaction
+{
+  class Transaction;
+}
+
 namespace toocal::core::data_access_layer
 {
   using errors::Error;
@@ -21,13 +39,55 @@ namespace toocal::core::data_access_layer
   using meta::Meta;
   using node::Node;
   using page::Page;
+  using page_cache::Page_cache;
 
   class Options
   {
   public:
+    /** 1024 pages, i.e. 4 MiB with 4 KiB pages, keeps the upper levels of
+     ** the trees resident for most workloads. */
+    static constexpr uint32_t DEFAULT_PAGE_CACHE_CAPACITY = 1024;
+
+    static constexpr uint32_t DEFAULT_CHECKPOINT_PAGES = 1024;
+
     const uint32_t page_size;
     const float    min_fill_percent;
     const float    max_fill_percent;
+
+    /** The maximum number of pages kept in the page cache, 0 disables it. */
+    const uint32_t page_cache_capacity = DEFAULT_PAGE_CACHE_CAPACITY;
+
+    /** With storage::Backend::MMAP the file is memory mapped and the page
+     ** cache is bypassed, since the mapping is already served from the
+     ** operating system page cache. */
+    const storage::Backend storage_backend = storage::Backend::FILE;
+
+    /** Log written pages to a write-ahead log (path + "-wal") and make every
+     ** commit durable with an fsync of the log. Without it, and without
+     ** copy_on_write, commits are not durable and a crash can leave a torn
+     ** tree: the nodes and the freelist are overwritten in place, the two
+     ** copies of the meta only survive a torn write of the meta itself. */
+    const bool write_ahead_log = false;
+
+    /** The write-ahead log is checkpointed into the database file once it
+     ** holds this many distinct pages. */
+    const uint32_t checkpoint_pages = DEFAULT_CHECKPOINT_PAGES;
+
+    /** How long the first of concurrent commits waits for others to join its
+     ** fsync of the write-ahead log. The commits of a single writer thread
+     ** are never concurrent, the delay only adds to their latency. */
+    const std::chrono::microseconds commit_delay{0};
+
+    /** Never overwrite the nodes of a committed tree: a transaction writes
+     ** the nodes it modified, and the nodes on their path from the root, to
+     ** new pages when it commits, and the pages it releases are only reused
+     ** once no snapshot::Snapshot can read them anymore. Snapshots can then
+     ** be read from other threads while a writer modifies the collections.
+     ** Without the write-ahead log, the pages are synced before the meta is
+     ** written and the meta after it, so a crash leaves the last committed
+     ** tree, at the cost of two fsyncs per commit. The pages allocated by an
+     ** interrupted commit are then leaked, the freelist is written in place. */
+    const bool copy_on_write = false;
   };
 
   namespace builtin_options
@@ -55,22 +115,79 @@ namespace toocal::core::data_access_layer
     inline static const auto BEST_PERFORMANCE = Options{Page::DEFAULT_PAGE_SIZE, 0.125f, 0.125f};
   } // namespace builtin_options
 
+  class Statistics
+  {
+  public:
+    /** Pages read from the write-ahead log or the storage. */
+    uint64_t pages_read{};
+
+    /** Pages passed to write_page outside of a transaction, or by the commit
+     ** of a transaction. */
+    uint64_t pages_written{};
+
+    /** Pages handed to Storage::prefetch by prefetch_pages. */
+    uint64_t pages_prefetched{};
+  };
+
   class Data_access_layer
   {
   public:
     const std::string path;
     const Options     options;
 
-    std::fstream file;
-    Meta         meta;
-    Freelist     freelist;
+    std::unique_ptr<storage::Storage> storage;
+    Meta                              meta;
+    Freelist                          freelist;
+    Page_cache                        page_cache;
+
+    /** nullptr unless Options::write_ahead_log is set. */
+    std::unique_ptr<write_ahead_log::Write_ahead_log> wal;
+
+    /** The pages written to the write-ahead log since the last commit, they
+     ** are appended to the log by commit. */
+    write_ahead_log::Batch wal_batch;
+
+    /** The active transaction, pages written while it is set are staged in
+     ** it. Managed by transaction::Transaction. */
+    transaction::Transaction* transaction = nullptr;
+
+    /** Held by the thread of the active transaction, so writers on several
+     ** threads take turns, and by checkpoint. A transaction releases it
+     ** before waiting for the fsync of its commit, so the commits of the
+     ** next writers can join that fsync. */
+    std::recursive_mutex writer;
+
+    /** The thread of the active transaction, see active_transaction. */
+    std::atomic<std::thread::id> writer_thread;
+
+    Statistics statistics;
+
+    /** Holds what an operation on a collection decodes, it is freed at the
+     ** end of the operation with an arena::Arena::Scope. */
+    arena::Arena arena;
+
+    /** The collections of the catalog opened so far, by name, see
+     ** get_collection. */
+    std::unordered_map<std::string, std::unique_ptr<collection::Collection>> collections;
+
+    /** Guards the page cache, the statistics and the snapshots, and the
+     ** storage unless Storage::is_thread_safe, so the pages of a
+     ** snapshot::Snapshot can be read from other threads while the writer
+     ** uses the data access layer. */
+    std::recursive_mutex mutex;
 
     explicit Data_access_layer(std::string path)
       : Data_access_layer(std::move(path), builtin_options::BALANCE)
     {}
 
     explicit Data_access_layer(std::string path, const Options options)
-      : path(std::move(path)), options(options), meta({})
+      : path(std::move(path))
+      , options(options)
+      , meta({})
+      , page_cache(
+          options.storage_backend == storage::Backend::MMAP ? 0 : options.page_cache_capacity,
+          [this](const Page& page) { return this->write_page_to_file(page); },
+          [this](std::span<const Page* const> pages) { return this->write_pages_to_file(pages); })
     {
       if (std::filesystem::exists(this->path))
         this->load_database().map_error([&](const auto&& error) { error.panic(); });
@@ -78,13 +195,96 @@ namespace toocal::core::data_access_layer
         this->initialize_database().map_error([&](const auto&& error) { error.panic(); });
     }
 
+    /* Nodes and the page cache keep a pointer to the data access layer. */
+    Data_access_layer(const Data_access_layer&) = delete;
+    Data_access_layer(Data_access_layer&&) = delete;
+
     ~Data_access_layer() { this->close(); }
 
-    /** Manually close the Data access layer. Note: This function will be
-     ** automatically called after the scope of the Data access layer ends, and
-     ** there is usually no need to call it manually. */
+    /** Manually close the Data access layer. An active transaction is rolled
+     ** back. Note: This function will be automatically called after the scope
+     ** of the Data access layer ends, and there is usually no need to call it
+     ** manually. */
     auto close() noexcept -> void;
 
+    /** Add an empty collection called name to the catalog, the collection
+     ** whose root is Meta::root, and return it. Fails if the collection
+     ** exists. Must not be called during a transaction. */
+    [[nodiscard]] auto create_collection(std::vector<uint8_t> name) noexcept
+      -> tl::expected<collection::Collection*, Error>;
+
+    /** The collection called name in the catalog, nullptr if there is none.
+     ** Its root is only searched in the catalog the first time, the
+     ** collection is then kept in collections and the same one is returned
+     ** until it is dropped. The roots of the collections of the catalog a
+     ** transaction modified are written to the catalog when it commits, see
+     ** write_root. */
+    [[nodiscard]] auto get_collection(const std::vector<uint8_t>& name) noexcept
+      -> tl::expected<collection::Collection*, Error>;
+
+    /** Remove the collection called name from the catalog and release its
+     ** pages. The collection returned by get_collection must not be used
+     ** anymore. Fails if the collection does not exist. Must not be called
+     ** during a transaction. */
+    [[nodiscard]] auto drop_collection(const std::vector<uint8_t>& name) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Write the root of collection to the catalog, in the active
+     ** transaction, if it is a collection of the catalog. */
+    [[nodiscard]] auto write_root(const collection::Collection& collection) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Whether collection is the catalog, whose root is Meta::root. */
+    [[nodiscard]] auto is_catalog(const collection::Collection& collection) const noexcept -> bool;
+
+    /** Write every dirty page held by the page cache back to the file. */
+    [[nodiscard]] auto flush() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** flush, and wait until the file holds the pages. */
+    [[nodiscard]] auto sync() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** The active transaction if it was begun by the calling thread, or
+     ** nullptr. */
+    [[nodiscard]] auto active_transaction() const noexcept -> transaction::Transaction*;
+
+    /** Make everything written so far durable and atomic, log_commit then
+     ** sync_commit. Does nothing without the write-ahead log. */
+    [[nodiscard]] auto commit() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Flush the page cache and append wal_batch and a commit record to the
+     ** write-ahead log, returns the LSN to pass to sync_commit. The mutex is
+     ** only held while the pages are handed to the log, not during the fsync. */
+    [[nodiscard]] auto log_commit() noexcept -> tl::expected<write_ahead_log::Lsn, Error>;
+
+    /** Wait for the group fsync of the commit lsn, then checkpoint the log if
+     ** it grew past Options::checkpoint_pages. */
+    [[nodiscard]] auto sync_commit(write_ahead_log::Lsn lsn) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Unpin the pages the commit of the active transaction wrote to the
+     ** page cache, once the commit is logged. */
+    auto keep_written_pages() noexcept -> void;
+
+    /** Drop what the commit of the active transaction wrote before it
+     ** failed: the pages it wrote to the page cache are invalidated and the
+     ** dirty images they replaced put back, the staged pages it moved there
+     ** are staged again, wal_batch is emptied, and the
+     ** next write_freelist writes every freelist page. Without the page
+     ** cache and the write-ahead log the pages are in the file already. */
+    auto discard_written_pages() noexcept -> void;
+
+    /** Copy the pages of the write-ahead log into the database file and
+     ** empty the log, once the active transaction of another thread ended. */
+    [[nodiscard]] auto checkpoint() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    [[nodiscard]] auto wal_path() const noexcept -> std::string;
+
+    /** Give the pages released at the end of the file back to the file
+     ** system. The freelist is written and committed, and the write-ahead log
+     ** checkpointed, before the file is shrunk, so no page past its new end
+     ** is written back later. Must not be called during a transaction. */
+    [[nodiscard]] auto truncate() noexcept -> tl::expected<std::nullptr_t, Error>;
+
     /** get_split_index should be called when performing rebalance after an item
      ** is removed. It checks if a node can spare an element, and if it does
      ** then it returns the index when there the split should happen. Otherwise
@@ -94,34 +294,117 @@ namespace toocal::core::data_access_layer
     [[nodiscard]] auto max_threshold() const noexcept -> float;
     [[nodiscard]] auto min_threshold() const noexcept -> float;
     [[nodiscard]] auto is_under_populated(const Node& node) const noexcept -> bool;
+    /** A node is only over populated with at least three items, so that it
+     ** can be split in two around one of them. It is also over populated when
+     ** it does not fit in a page anymore, it must then be split before it is
+     ** written. */
     [[nodiscard]] auto is_over_populated(const Node& node) const noexcept -> bool;
 
+    /** Same as is_over_populated, for a leaf holding items. */
+    [[nodiscard]] auto is_over_populated(std::span<const node::Item_view> items) const noexcept -> bool;
+
+    /** Same as is_under_populated, for a leaf holding items. */
+    [[nodiscard]] auto is_under_populated(std::span<const node::Item_view> items) const noexcept -> bool;
+
+    /** The largest key plus inline value stored in a node, an eighth of a
+     ** page. A larger value is moved to an overflow chain by store_value, so
+     ** the nodes hold many keys and a search never reads large values. */
+    [[nodiscard]] auto max_item_size() const noexcept -> uint32_t;
+
+    /** The largest key, which always stays in the node. */
+    [[nodiscard]] auto max_key_size() const noexcept -> uint32_t;
+
     /** Allocate an empty page. Different from directly constructing Page,
      ** this function will fill in a Page.data of option.page_size size. */
     [[nodiscard]] auto allocate_empty_page(page::Page_num page_num) const noexcept -> Page;
 
-    /** Write a page. This function will check the operation results of all
-     ** fstream functions during the writing process. If it fails, it will use
-     ** std::strerror(errno) to construct an Error and return it. */
+    /** Write a page. During a transaction the page is staged in the
+     ** transaction until it commits. If the page cache is enabled the page is
+     ** only marked dirty in the cache and reaches the file when it is evicted
+     ** or flushed, otherwise it is written with write_page_to_file. */
     [[nodiscard]] auto write_page(const Page& page) noexcept -> tl::expected<std::nullptr_t, Error>;
 
-    /** Read a page. The error handling method is the same as write_page. */
+    /** Same as write_page, without building a Page when the page is staged
+     ** in the active transaction already. */
+    [[nodiscard]] auto write_page(page::Page_num page_num, std::span<const uint8_t> data) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Write pages like write_page, moving them. Without the page cache they
+     ** reach the storage as one Storage::write_batch. */
+    [[nodiscard]] auto write_pages(std::span<Page* const> pages) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Read a page, from the active transaction or the page cache if it is
+     ** resident there. */
     [[nodiscard]] auto read_page(page::Page_num page_num) noexcept -> tl::expected<Page, Error>;
 
-    /** Use read_page to read freelist and return it. */
+    /** Returns the bytes of a page without copying them into a new Page: a
+     ** view into the mapping with the mmap backend, into the page cache
+     ** otherwise. The view is only valid until the next call to the data
+     ** access layer. */
+    [[nodiscard]] auto view_page(page::Page_num page_num) noexcept
+      -> tl::expected<std::span<const uint8_t>, Error>;
+
+    /** Hint that the pages from page_num to page_num + count will be read
+     ** soon. The pages already held by the transaction, the page cache or the
+     ** write-ahead log are skipped, the storage is asked to read the others
+     ** ahead in the background. When the storage is batched and the page
+     ** cache is enabled, the others are read into the page cache with a
+     ** single Storage::read_batch instead. */
+    auto prefetch_pages(page::Page_num page_num, uint32_t count) noexcept -> void;
+
+    /** Load a page into the page cache and pin it, so it stays resident until
+     ** unpin_page is called. Does nothing if the page cache is disabled. */
+    [[nodiscard]] auto pin_page(page::Page_num page_num) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    auto unpin_page(page::Page_num page_num) noexcept -> void;
+
+    /** Read a committed page from any thread, for a snapshot::Snapshot: from
+     ** the page cache if it is resident there, without adding it, or from the
+     ** write-ahead log or the storage. The pages staged by the active
+     ** transaction are not seen. */
+    [[nodiscard]] auto read_committed_page(page::Page_num page_num) noexcept
+      -> tl::expected<Page, Error>;
+
+    /** Register a snapshot of the last commit and return its epoch, the
+     ** number of commits made with Options::copy_on_write so far. The pages
+     ** released after this commit are kept until release_epoch is called. */
+    [[nodiscard]] auto acquire_epoch() noexcept -> uint64_t;
+    auto               release_epoch(uint64_t epoch) noexcept -> void;
+
+    /** With Options::copy_on_write, release the pages retired by the commits
+     ** that no registered snapshot can see anymore, and return their number.
+     ** Called when a transaction begins. */
+    auto reclaim() noexcept -> uint64_t;
+
+    /** End the epoch of a commit with Options::copy_on_write, after its pages
+     ** are written: the pages it retired are no longer part of the trees of
+     ** the snapshots taken from now on. */
+    auto publish(std::vector<page::Page_num> retired) noexcept -> void;
+
+    /** Use read_page to read the chain of freelist pages starting at
+     ** Meta::freelist_page and return the freelist. */
     [[nodiscard]] auto read_freelist() noexcept -> tl::expected<Freelist, Error>;
 
-    /** Use write_page to read freelist and return it. */
+    /** Use write_page to write the freelist, allocating the pages it needs.
+     ** Only the pages of the chain that changed since they were last written
+     ** are written again. */
     [[nodiscard]] auto write_freelist() noexcept -> tl::expected<std::nullptr_t, Error>;
 
     /** Use read_page to read meta and return it. */
     [[nodiscard]] auto read_meta() noexcept -> tl::expected<Meta, Error>;
 
-    /** Use read_page to write meta and return it. */
+    /** Use read_page to write meta and return it. Without the write-ahead
+     ** log and with Options::copy_on_write, the pages written before are
+     ** synced first and the meta is synced after them. */
     [[nodiscard]] auto write_meta(const Meta& meta) noexcept -> tl::expected<std::nullptr_t, Error>;
 
-    [[nodiscard]] auto
-      new_node(std::deque<node::Item> items, std::deque<page::Page_num> children) noexcept -> Node;
+    /** Create a node on a new page, allocated near hint, see
+     ** Freelist::get_next_page. */
+    [[nodiscard]] auto new_node(
+      std::deque<node::Item> items, std::deque<page::Page_num> children, page::Page_num hint = 0) noexcept
+      -> Node;
 
     [[nodiscard]] auto write_node(Node& node) noexcept -> tl::expected<std::nullptr_t, Error>;
 
@@ -129,13 +412,116 @@ namespace toocal::core::data_access_layer
 
     auto delete_node(page::Page_num page_num) noexcept -> void;
 
+    /** Write value to a chain of overflow pages and return its first page.
+     ** Every overflow page starts with the next page of the chain, 0 for the
+     ** last one, followed by the data. */
+    [[nodiscard]] auto write_overflow(std::span<const uint8_t> value) noexcept
+      -> tl::expected<page::Page_num, Error>;
+
+    /** Read the size bytes of the overflow chain starting at page_num. The
+     ** pages are not kept in the page cache. */
+    [[nodiscard]] auto read_overflow(page::Page_num page_num, uint32_t size) noexcept
+      -> tl::expected<std::vector<uint8_t>, Error>;
+
+    /** Release the pages of the overflow chain of size bytes starting at page_num. */
+    [[nodiscard]] auto delete_overflow(page::Page_num page_num, uint32_t size) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Move the value of item to an overflow chain if the item is larger
+     ** than max_item_size. */
+    [[nodiscard]] auto store_value(node::Item& item) noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Read the value of item from its overflow chain, if it has one. */
+    [[nodiscard]] auto load_value(node::Item& item) noexcept -> tl::expected<std::nullptr_t, Error>;
+
   private:
+    /** The collection holding the roots of the other ones, keyed by their
+     ** names, see Meta::root. */
+    collection::Collection catalog{this, {}, 0};
+
+    /** The catalog, with the root of the meta. */
+    [[nodiscard]] auto open_catalog() noexcept -> collection::Collection&;
+
+    /** Used by view_page when neither the storage nor the page cache can
+     ** provide the page in place. */
+    Page scratch_page;
+
+    /** Used by write_node to serialize the nodes before they are written. */
+    std::vector<uint8_t> node_buffer;
+
+    /** The freelist pages as they were last read or written, so write_freelist
+     ** skips the pages that did not change. */
+    std::vector<std::vector<uint8_t>> freelist_images;
+
+    /** A page the commit of the active transaction wrote to the page cache,
+     ** with the dirty image it replaced. */
+    struct Written_page
+    {
+      page::Page_num     page_num;
+      tl::optional<Page> replaced;
+
+      /** Whether the page was moved out of the staged pages. */
+      bool staged;
+    };
+
+    /** The pages written by the commit of the active transaction, pinned
+     ** until it is logged, see discard_written_pages. */
+    std::vector<Written_page> written_pages;
+
+    /** The number of commits made with Options::copy_on_write. */
+    uint64_t epoch{};
+
+    /** The epochs of the registered snapshots. */
+    std::multiset<uint64_t> snapshots;
+
+    /** The pages retired by the commits, with the epoch following each
+     ** commit. A snapshot of an earlier epoch may still read them. */
+    std::deque<std::pair<uint64_t, std::vector<page::Page_num>>> retired;
+
+    /** Release a page of a node or of an overflow chain. With
+     ** Options::copy_on_write it is retired by the active transaction, or by
+     ** the last commit outside of a transaction. */
+    auto release_page(page::Page_num page_num) noexcept -> void;
+
+    /** Put a page written by write_page or write_pages in the page cache,
+     ** dirty. During a commit the page is pinned and added to
+     ** written_pages. */
+    [[nodiscard]] auto cache_page(Page page, bool staged) noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Append a page to wal_batch if the write-ahead log is enabled, write it
+     ** to the storage otherwise, bypassing the page cache. */
+    [[nodiscard]] auto write_page_to_file(const Page& page) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Write pages like write_page_to_file, with a single
+     ** Storage::write_batch when there is no write-ahead log. */
+    [[nodiscard]] auto write_pages_to_file(std::span<const Page* const> pages) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** The image of page_num in wal_batch or in the write-ahead log, or
+     ** tl::nullopt. */
+    [[nodiscard]] auto find_logged_page(page::Page_num page_num) const noexcept
+      -> tl::optional<std::span<const uint8_t>>;
+
+    /** Read a page from the write-ahead log or the storage, bypassing the
+     ** page cache. */
+    [[nodiscard]] auto read_page_from_file(page::Page_num page_num) noexcept
+      -> tl::expected<Page, Error>;
+
+    /** Read a page like read_page, without adding it to the page cache. */
+    [[nodiscard]] auto read_page_uncached(page::Page_num page_num) noexcept
+      -> tl::expected<Page, Error>;
+
+    /** The number of overflow pages holding size bytes. */
+    [[nodiscard]] auto overflow_pages(uint32_t size) const noexcept -> uint32_t;
+
     /** During the process of creating the Data access layer, if the database
      ** file does not exist in the target path, it is initialized. */
     auto initialize_database() noexcept -> tl::expected<std::nullptr_t, Error>;
 
     /** During the process of creating the Data access layer, If the database
-     ** file exists at the target path, load it. */
+     ** file exists at the target path, load it. Committed pages left in the
+     ** write-ahead log by a crash are recovered first. */
     auto load_database() noexcept -> tl::expected<std::nullptr_t, Error>;
   }; // namespace toocal::core::data_access_layer
 } // namespace toocal::core::data_access_layer
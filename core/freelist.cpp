@@ -1,22 +1,216 @@
 #include "./freelist.h"
+#include <iterator>
 
 namespace toocal::core::freelist
 {
-  [[nodiscard]] auto Freelist::get_next_page() noexcept -> page::Page_num
+  [[nodiscard]] auto Freelist::get_next_page(const page::Page_num hint) noexcept -> page::Page_num
   {
-    // Take the last element and remove it from the list.
+    if (0 == hint)
+      return this->released_pages.empty() ? ++this->max_page
+                                           : this->take(this->released_pages.begin()->first);
+
     if (!this->released_pages.empty())
       {
-        const auto back = released_pages.back();
-        released_pages.pop_back();
-        return back;
+        /* The closest released pages after and before the hint, the first
+         * page of the next extent or the hint itself, and the last page of the
+         * previous extent. */
+        const auto next = this->released_pages.lower_bound(hint);
+        auto after = next == this->released_pages.end() ? page::Page_num{0} : next->first;
+        auto before = page::Page_num{0};
+
+        if (next != this->released_pages.begin())
+          {
+            const auto &[first, count] = *std::prev(next);
+            if (first + count > hint)
+              after = hint;
+            else
+              before = first + count - 1;
+          }
+
+        if (0 != after && after / EXTENT_SIZE == hint / EXTENT_SIZE)
+          return this->take(after);
+        if (0 != before && before / EXTENT_SIZE == hint / EXTENT_SIZE)
+          return this->take(before);
+
+        if (!this->whole_extents.empty())
+          return this->take(align(*this->whole_extents.begin()));
+
+        if (this->released_pages_count * 8 >= this->max_page)
+          return this->take(this->released_pages.begin()->first);
       }
 
-    return ++this->max_page;
+    /* The pages skipped to align the block are released too. */
+    const auto first = this->max_page + 1, page = align(first);
+    this->max_page = page + EXTENT_SIZE - 1;
+    if (first < page)
+      this->release_extent(first, page - first);
+    this->release_extent(page + 1, EXTENT_SIZE - 1);
+    return page;
   }
 
   auto Freelist::release_page(const page::Page_num page) noexcept -> void
   {
-    this->released_pages.push_back(page);
+    if (!this->is_released(page))
+      this->release_extent(page, 1);
+  }
+
+  auto Freelist::release_extent(page::Page_num first, page::Page_num count) noexcept -> void
+  {
+    if (this->recording)
+      this->changes.push_back(Change{first, count, true});
+
+    /* Merge with the extent right after, then with the one right before. */
+    if (const auto next = this->released_pages.find(first + count); next != this->released_pages.end())
+      {
+        count += next->second;
+        this->erase_extent(next);
+      }
+
+    if (const auto next = this->released_pages.lower_bound(first); next != this->released_pages.begin())
+      if (const auto previous = std::prev(next); previous->first + previous->second == first)
+        {
+          first = previous->first;
+          count += previous->second;
+          this->erase_extent(previous);
+        }
+
+    this->insert_extent(first, count);
+  }
+
+  auto Freelist::trim() noexcept -> page::Page_num
+  {
+    if (this->released_pages.empty())
+      return 0;
+
+    const auto [first, count] = *std::prev(this->released_pages.end());
+    if (first + count != this->max_page + 1)
+      return 0;
+
+    this->take(first, count);
+    this->max_page = first - 1;
+    return count;
+  }
+
+  [[nodiscard]] auto Freelist::is_released(const page::Page_num page) const noexcept -> bool
+  {
+    const auto next = this->released_pages.upper_bound(page);
+    if (next == this->released_pages.begin())
+      return false;
+
+    const auto &[first, count] = *std::prev(next);
+    return page < first + count;
+  }
+
+  [[nodiscard]] auto Freelist::released_count() const noexcept -> uint64_t
+  {
+    return this->released_pages_count;
+  }
+
+  auto Freelist::begin() noexcept -> void
+  {
+    this->recording = true;
+    this->changes.clear();
+    this->taken.clear();
+    this->begin_max_page = this->max_page;
+    this->begin_pages = this->pages.size();
+  }
+
+  auto Freelist::commit() noexcept -> void
+  {
+    this->recording = false;
+    this->changes.clear();
+    this->taken.clear();
+  }
+
+  auto Freelist::rollback() noexcept -> void
+  {
+    this->recording = false;
+
+    /* Undo in reverse order, so every extent released is whole again when
+     * it is taken back. */
+    for (auto change = this->changes.rbegin(); change != this->changes.rend(); change++)
+      if (change->released)
+        this->take(change->first, change->count);
+      else
+        this->release_extent(change->first, change->count);
+
+    this->changes.clear();
+    this->taken.clear();
+    this->max_page = this->begin_max_page;
+    this->pages.resize(this->begin_pages);
+  }
+
+  [[nodiscard]] auto Freelist::is_modified() const noexcept -> bool
+  {
+    return !this->changes.empty() || this->max_page != this->begin_max_page
+           || this->pages.size() != this->begin_pages;
+  }
+
+  [[nodiscard]] auto Freelist::is_allocated_since_begin(const page::Page_num page) const noexcept
+    -> bool
+  {
+    return page > this->begin_max_page || this->taken.contains(page);
+  }
+
+  [[nodiscard]] auto Freelist::operator==(const Freelist &other) const noexcept -> bool
+  {
+    return this->max_page == other.max_page && this->released_pages == other.released_pages
+           && this->pages == other.pages;
+  }
+
+  auto Freelist::take(const page::Page_num page, const page::Page_num count) noexcept
+    -> page::Page_num
+  {
+    if (this->recording)
+      {
+        this->changes.push_back(Change{page, count, false});
+        for (auto taken = page; taken < page + count; taken++)
+          this->taken.insert(taken);
+      }
+
+    const auto extent = std::prev(this->released_pages.upper_bound(page));
+    const auto [extent_first, extent_count] = *extent;
+    this->erase_extent(extent);
+
+    if (extent_first < page)
+      this->insert_extent(extent_first, page - extent_first);
+    if (page + count < extent_first + extent_count)
+      this->insert_extent(page + count, extent_first + extent_count - page - count);
+
+    return page;
+  }
+
+  [[nodiscard]] auto Freelist::align(const page::Page_num page) noexcept -> page::Page_num
+  {
+    return (page + EXTENT_SIZE - 1) / EXTENT_SIZE * EXTENT_SIZE;
+  }
+
+  auto Freelist::insert_extent(const page::Page_num first, const page::Page_num count) noexcept
+    -> void
+  {
+    this->released_pages.emplace(first, count);
+    this->released_pages_count += count;
+    if (align(first) + EXTENT_SIZE <= first + count)
+      this->whole_extents.insert(first);
+  }
+
+  auto Freelist::erase_extent(const std::map<page::Page_num, page::Page_num>::iterator extent) noexcept
+    -> void
+  {
+    this->released_pages_count -= extent->second;
+    this->whole_extents.erase(extent->first);
+    this->released_pages.erase(extent);
+  }
+
+  [[nodiscard]] auto Freelist::pages_needed(const uint32_t page_size) const noexcept -> size_t
+  {
+    /* The bitmap covers every page up to max_page. */
+    return types::Serializer<Freelist>::locate(this->max_page, page_size).first + 1;
+  }
+
+  auto Freelist::reserve_pages(const uint32_t page_size) noexcept -> void
+  {
+    while (this->pages.size() < this->pages_needed(page_size))
+      this->pages.push_back(++this->max_page);
   }
 } // namespace toocal::core::freelist
\ No newline at end of file
@@ -5,38 +5,138 @@
 #include "errors.hpp"
 #include "types.hpp"
 #include <algorithm>
+#include <bit>
 #include <cstdint>
-#include <deque>
+#include <map>
+#include <set>
+#include <span>
+#include <vector>
 #include <endian/stream_reader.hpp>
 #include <endian/stream_writer.hpp>
 #include <endian/little_endian.hpp>
 
 namespace toocal::core::freelist
 {
-  /** Freelist manages the manages free and used pages. */
+  /** Freelist manages the manages free and used pages. The released pages
+   ** are kept as extents, runs of consecutive pages, which are coalesced as
+   ** pages are released. The file is divided in aligned blocks of
+   ** EXTENT_SIZE pages: new pages are taken in the block of a hint, usually a
+   ** page of the same collection, and a new block is taken once it is full,
+   ** so every block is filled by a single collection and its pages stay
+   ** close to each other. */
   class Freelist
   {
   public:
     /** META_PAGE is the maximum page num that is used by the db for its own
-     ** purposes. For now, only page 0 is used as the header page.
-     ** It means all other page numbers can be used. */
-    static constexpr page::Page_num META_PAGE = 0;
+     ** purposes. The pages 0 and 1 hold the two copies of the meta, see
+     ** meta::Meta. It means all other page numbers can be used. */
+    static constexpr page::Page_num META_PAGE = 1;
+
+    /** The number of pages of a block. */
+    static constexpr page::Page_num EXTENT_SIZE = 16;
 
     /** max_page holds the latest page num allocated. */
-    page::Page_num max_page;
-
-    /** released_pages holds all the ids that were released during delete.
-     ** New page ids are first given from the releasedPageIDs to avoid growing
-     ** the file. If it's empty, then max_page is incremented and a new page is
-     ** created thus increasing the file size. */
-    std::deque<page::Page_num> released_pages;
-
-    /** get_next_page returns page ids for writing New page ids are first given
-     ** from the releasedPageIDs to avoid growing the file. If it's empty, then
-     ** maxPage is incremented and a new page is created thus increasing the
-     ** file size. */
-    [[nodiscard]] auto get_next_page() noexcept -> page::Page_num;
-    auto               release_page(page::Page_num page) noexcept -> void;
+    page::Page_num max_page{META_PAGE};
+
+    /** released_pages holds the pages that were released during delete, the
+     ** first page of every extent mapped to its number of pages. New pages
+     ** are first given from the released pages to avoid growing the file. It
+     ** is only modified through release_page and get_next_page. */
+    std::map<page::Page_num, page::Page_num> released_pages;
+
+    /** The pages holding the serialized freelist, chained from the first one,
+     ** Meta::freelist_page. */
+    std::vector<page::Page_num> pages;
+
+    /** get_next_page returns page ids for writing. Without a hint, the lowest
+     ** released page is given, or max_page is incremented. With a hint, the
+     ** first of these is given:
+     **   - the released page of the block of the hint closest to it, after it
+     **     if possible,
+     **   - the first page of a released block,
+     **   - the lowest released page, if an eighth of the file is released,
+     **     rather than growing a fragmented file,
+     **   - the first page of a new block at the end of the file, the pages up
+     **     to it and the rest of the block are released. */
+    [[nodiscard]] auto get_next_page(page::Page_num hint = 0) noexcept -> page::Page_num;
+
+    /** Release a page, merging it with the extents around it. */
+    auto release_page(page::Page_num page) noexcept -> void;
+
+    /** Release count pages from first, none of them may be released already. */
+    auto release_extent(page::Page_num first, page::Page_num count) noexcept -> void;
+
+    [[nodiscard]] auto is_released(page::Page_num page) const noexcept -> bool;
+
+    /** Forget the extent released at the end of the file, if any, lowering
+     ** max_page, and return its number of pages. */
+    auto trim() noexcept -> page::Page_num;
+
+    /** The number of released pages, in all the extents. */
+    [[nodiscard]] auto released_count() const noexcept -> uint64_t;
+
+    /** The number of pages of page_size bytes needed to serialize the freelist. */
+    [[nodiscard]] auto pages_needed(uint32_t page_size) const noexcept -> size_t;
+
+    /** Allocate the pages missing to serialize the freelist. They are taken
+     ** past max_page, so the released pages are left unchanged. The pages are
+     ** kept once the freelist shrinks, to be reused when it grows again. */
+    auto reserve_pages(uint32_t page_size) noexcept -> void;
+
+    /** Start recording the changes, so that rollback can undo them. */
+    auto begin() noexcept -> void;
+
+    /** Keep the changes made since begin and stop recording. */
+    auto commit() noexcept -> void;
+
+    /** Undo the changes made since begin and stop recording. */
+    auto rollback() noexcept -> void;
+
+    /** Whether the freelist changed since begin. */
+    [[nodiscard]] auto is_modified() const noexcept -> bool;
+
+    /** Whether page was allocated since begin, taken from the released pages
+     ** or past max_page, so it was not in use when begin was called. */
+    [[nodiscard]] auto is_allocated_since_begin(page::Page_num page) const noexcept -> bool;
+
+    [[nodiscard]] auto operator==(const Freelist &other) const noexcept -> bool;
+
+  private:
+    /** A change recorded since begin: an extent released, or a page taken
+     ** when released is false. */
+    class Change
+    {
+    public:
+      page::Page_num first;
+      page::Page_num count;
+      bool           released;
+    };
+
+    bool                recording = false;
+    std::vector<Change> changes;
+
+    /** The released pages taken since begin. */
+    std::set<page::Page_num> taken;
+
+    /** max_page and the number of pages when begin was called. */
+    page::Page_num begin_max_page{};
+    size_t         begin_pages{};
+
+    uint64_t released_pages_count{};
+
+    /** The first pages of the extents holding a whole block. */
+    std::set<page::Page_num> whole_extents;
+
+    /** The first page of the first block starting at or after page. */
+    [[nodiscard]] static auto align(page::Page_num page) noexcept -> page::Page_num;
+
+    /** Remove count pages from page from the extent holding them. */
+    auto take(page::Page_num page, page::Page_num count = 1) noexcept -> page::Page_num;
+
+    /** Add or remove an extent of released_pages, keeping the count and
+     ** whole_extents up to date. */
+    auto insert_extent(page::Page_num first, page::Page_num count) noexcept -> void;
+    auto erase_extent(std::map<page::Page_num, page::Page_num>::iterator extent) noexcept -> void;
   };
 }; // namespace toocal::core::freelist
 
@@ -45,49 +145,140 @@ namespace toocal::core::types
   using errors::Error;
   using freelist::Freelist;
 
+  /** The freelist is serialized as a bitmap of the released pages, in a
+   ** chain of pages. Every page starts with the next page of the chain (0 for
+   ** the last one), and the first page also holds max_page:
+   ** --------------------------------------------------------------------------
+   ** | max_page (first page only) | next page | bitmap ...                     |
+   ** --------------------------------------------------------------------------
+   ** Bit n of the bitmap is set when page n is released. Every page of the
+   ** chain covers a fixed range of pages, so releasing or reusing a page only
+   ** changes the page of the chain covering it, and a page of 4 KiB covers
+   ** 128 MiB of the file. */
   template <> class Serializer<Freelist>
   {
   public:
-    [[nodiscard]] static auto serialize(const Freelist &self) noexcept
+    /** The number of pages covered by the bitmap of a page of the chain. */
+    [[nodiscard]] static constexpr auto capacity(const uint32_t page_size, const bool first) noexcept
+      -> page::Page_num
+    {
+      return (page_size - sizeof(page::Page_num) - (first ? sizeof(page::Page_num) : 0)) * 8;
+    }
+
+    /** The page of the chain covering page, and the position of its bit in
+     ** the bitmap of that page. */
+    [[nodiscard]] static constexpr auto locate(const page::Page_num page, const uint32_t page_size) noexcept
+      -> std::pair<size_t, page::Page_num>
+    {
+      const auto first = capacity(page_size, true), other = capacity(page_size, false);
+      if (page < first)
+        return {0, page};
+      return {1 + (page - first) / other, (page - first) % other};
+    }
+
+    /** Serialize self into Freelist::pages, one page of page_size bytes after
+     ** the other. Freelist::reserve_pages must have been called. */
+    [[nodiscard]] static auto
+      serialize(const Freelist &self, const uint32_t page_size = page::Page::DEFAULT_PAGE_SIZE) noexcept
       -> tl::expected<std::vector<uint8_t>, Error>
     {
-      const uint16_t max_page = static_cast<uint16_t>(self.max_page);
-      const uint16_t released_pages_count = static_cast<uint16_t>(self.released_pages.size());
+      if (self.pages.size() < self.pages_needed(page_size))
+        return Err(fmt::format(
+          "the freelist needs {} pages but only {} are reserved",
+          self.pages_needed(page_size),
+          self.pages.size()));
+
+      auto buffer = std::vector<uint8_t>(self.pages.size() * page_size);
 
-      auto buffer = std::vector<uint8_t>(
-        /* max_page */
-        sizeof(max_page) +
-        /* released pages count */
-        sizeof(released_pages_count) +
-        /* released pages */
-        sizeof(page::Page_num) * self.released_pages.size());
+      for (size_t i = 0; i < self.pages.size(); i++)
+        {
+          auto serializer =
+            endian::stream_writer<endian::little_endian>(buffer.data() + i * page_size, page_size);
 
-      auto serializer = endian::stream_writer<endian::little_endian>(buffer.data(), buffer.size());
+          if (0 == i)
+            serializer << self.max_page;
 
-      serializer << max_page << released_pages_count;
+          serializer << (i + 1 < self.pages.size() ? self.pages[i + 1] : page::Page_num{0});
+        }
 
-      std::ranges::for_each(
-        self.released_pages, [&](const auto &released_page) { serializer << released_page; });
+      for (const auto &[first, count] : self.released_pages)
+        for (auto page = first; page < first + count; page++)
+          {
+            const auto [index, bit] = locate(page, page_size);
+            buffer[index * page_size + bitmap_offset(index) + bit / 8] |= 1 << bit % 8;
+          }
 
       return buffer;
     }
 
-    [[nodiscard]] static auto deserialize(const std::vector<uint8_t> &buffer) noexcept
-      -> tl::expected<Freelist, Error>
+    /** Deserialize the pages of the chain read one after the other. */
+    [[nodiscard]] static auto deserialize(
+      const std::span<const uint8_t> buffer,
+      const std::vector<page::Page_num> &pages,
+      const uint32_t page_size = page::Page::DEFAULT_PAGE_SIZE) noexcept -> tl::expected<Freelist, Error>
     {
-      auto deserializer =
-        endian::stream_reader<endian::little_endian>(buffer.data(), buffer.size());
+      auto freelist = Freelist{};
+      freelist.pages = pages;
+      endian::stream_reader<endian::little_endian>(buffer.data(), page_size) >> freelist.max_page;
+
+      const auto last_index = locate(freelist.max_page, page_size).first;
+      if (last_index >= pages.size())
+        return Err(fmt::format("the freelist does not cover page {}", freelist.max_page));
+
+      /* Rebuild the extents from the runs of set bits, a word of the bitmap
+       * at a time, so the pages in use cost nothing but reading their bits. */
+      auto       run = std::pair<page::Page_num, page::Page_num>{0, 0};
+      const auto extend = [&](const page::Page_num page, const page::Page_num count) {
+        if (run.second != 0 && run.first + run.second == page)
+          run.second += count;
+        else
+          {
+            if (run.second != 0)
+              freelist.release_extent(run.first, run.second);
+            run = {page, count};
+          }
+      };
 
-      uint16_t max_page = 0;
-      uint16_t released_pages_count = 0;
+      auto first_page = page::Page_num{0};
+      for (size_t index = 0; index <= last_index; first_page += capacity(page_size, 0 == index), index++)
+        {
+          const auto bitmap =
+            buffer.subspan(index * page_size + bitmap_offset(index), page_size - bitmap_offset(index));
 
-      deserializer >> max_page >> released_pages_count;
+          for (size_t offset = 0; offset < bitmap.size() && first_page + offset * 8 <= freelist.max_page;
+               offset += sizeof(uint64_t))
+            {
+              auto word = uint64_t{};
+              if (offset + sizeof(uint64_t) <= bitmap.size())
+                word = endian::little_endian::get<uint64_t>(bitmap.data() + offset);
+              else
+                for (size_t byte = 0; offset + byte < bitmap.size(); byte++)
+                  word |= uint64_t{bitmap[offset + byte]} << byte * 8;
 
-      std::deque<page::Page_num> released_pages(released_pages_count);
-      for (uint16_t i = 0; i < released_pages_count; i++)
-        deserializer >> released_pages[i];
+              while (word != 0)
+                {
+                  const auto bit = std::countr_zero(word);
+                  const auto ones = std::countr_one(word >> bit);
+                  const auto page = first_page + offset * 8 + bit;
+                  if (page > freelist.max_page)
+                    break;
 
-      return Freelist{static_cast<page::Page_num>(max_page), released_pages};
+                  extend(page, std::min<page::Page_num>(ones, freelist.max_page + 1 - page));
+                  word = bit + ones >= 64 ? 0 : word & ~((uint64_t{1} << (bit + ones)) - 1);
+                }
+            }
+        }
+
+      if (run.second != 0)
+        freelist.release_extent(run.first, run.second);
+
+      return freelist;
+    }
+
+  private:
+    [[nodiscard]] static constexpr auto bitmap_offset(const size_t index) noexcept -> size_t
+    {
+      return sizeof(page::Page_num) + (0 == index ? sizeof(page::Page_num) : 0);
     }
   };
 } // namespace toocal::core::types
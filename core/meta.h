@@ -7,25 +7,40 @@
 #include "errors.hpp"
 #include "page.h"
 #include "types.hpp"
+#include "utils.h"
 #include <cstdint>
 #include <sys/types.h>
 
 namespace toocal::core::meta
 {
-  /** meta is the meta page of the db. */
+  /** meta is the meta page of the db. It is written to the pages 0 and 1
+   ** in turn, with a generation incremented by every write and a checksum:
+   ** a write torn by a crash leaves the previous meta in the other page,
+   ** and the valid meta of the highest generation is the one loaded. */
   class Meta
   {
   public:
-    static constexpr page::Page_num PAGE_NUM = 0;
+    /** The pages holding the two copies of the meta. */
+    static constexpr page::Page_num PAGES = 2;
 
     /** The database has a root collection that holds all the collections in the
      ** database. It is called root and the root property of meta holds page
      ** number containing the root of collections collection. The keys are the
      ** collections names and the values are the page number of the root of each
-     ** collection. Then, once the collection and the root page are located, a
-     ** search inside a collection can be made. */
+     ** collection, 8 bytes in little endian. Then, once the collection and the
+     ** root page are located, a search inside a collection can be made. See
+     ** Data_access_layer::create_collection and get_collection. */
     page::Page_num root;
     page::Page_num freelist_page;
+
+    /** The number of times the meta was written, see
+     ** Data_access_layer::write_meta. */
+    uint64_t generation{};
+
+    /** The page this generation of the meta is written to. */
+    [[nodiscard]] auto page_num() const noexcept -> page::Page_num { return this->generation % PAGES; }
+
+    [[nodiscard]] auto operator==(const Meta &) const noexcept -> bool = default;
   };
 } // namespace toocal::core::meta
 
@@ -40,28 +55,38 @@ namespace toocal::core::types
     [[nodiscard]] static auto serialize(const Meta &self) noexcept
       -> tl::expected<std::vector<uint8_t>, Error>
     {
-      auto buffer = std::vector<uint8_t>(
-        /* root */
-        sizeof(self.root) +
-        /* freelist_page */
-        sizeof(self.freelist_page));
+      auto buffer = std::vector<uint8_t>(SIZE);
 
       auto serializer = endian::stream_writer<endian::little_endian>(buffer.data(), buffer.size());
 
-      serializer << self.root << self.freelist_page;
+      serializer << self.root << self.freelist_page << self.generation;
+      serializer << utils::Checksum::crc32(std::span{buffer}.first(SIZE - sizeof(uint32_t)));
       return buffer;
     }
 
+    /** Fails if the checksum does not match, the write of the meta was torn
+     ** or the page was never written. */
     [[nodiscard]] static auto deserialize(const std::vector<uint8_t> &buffer) noexcept
       -> tl::expected<Meta, Error>
     {
+      if (buffer.size() < SIZE)
+        return Err(fmt::format("a meta page of {} bytes is too short", buffer.size()));
+
       auto deserializer =
         endian::stream_reader<endian::little_endian>(buffer.data(), buffer.size());
       auto meta = Meta{};
+      auto checksum = uint32_t{};
+
+      deserializer >> meta.root >> meta.freelist_page >> meta.generation >> checksum;
+      if (checksum != utils::Checksum::crc32(std::span{buffer}.first(SIZE - sizeof(uint32_t))))
+        return Err(fmt::format("the checksum of the meta of generation {} does not match", meta.generation));
 
-      deserializer >> meta.root >> meta.freelist_page;
       return meta;
     }
+
+  private:
+    /* root, freelist_page, generation and the checksum of the others. */
+    static constexpr size_t SIZE = 3 * sizeof(uint64_t) + sizeof(uint32_t);
   };
 } // namespace toocal::core::types
 
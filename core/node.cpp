@@ -2,6 +2,8 @@
 #include "errors.hpp"
 #include "page.h"
 #include "data_access_layer.h"
+#include <algorithm>
+#include <array>
 #include <cstdarg>
 #include <cstddef>
 #include <numeric>
@@ -12,17 +14,67 @@ namespace toocal::core::node
 {
   [[nodiscard]] auto Node::is_leaf() const noexcept -> bool { return this->children.empty(); }
 
-  [[nodiscard]] auto Item::size() const noexcept -> uint32_t
+  [[nodiscard]] auto Item::is_overflow() const noexcept -> bool { return this->overflow != 0; }
+
+  [[nodiscard]] auto Item::size() const noexcept -> uint32_t { return Item_view{*this}.size(); }
+
+  [[nodiscard]] auto Item::cell_size(const uint32_t prefix_size) const noexcept -> uint32_t
+  {
+    return Item_view{*this}.cell_size(prefix_size);
+  }
+
+  [[nodiscard]] auto Item_view::is_overflow() const noexcept -> bool { return this->overflow != 0; }
+
+  [[nodiscard]] auto Item_view::size() const noexcept -> uint32_t
+  {
+    return this->key.size() + (this->is_overflow() ? sizeof(page::Page_num) : this->value.size());
+  }
+
+  [[nodiscard]] auto Item_view::cell_size(const uint32_t prefix_size) const noexcept -> uint32_t
+  {
+    const auto value_size = this->is_overflow() ? this->overflow_size : this->value.size();
+    return utils::Varint::size(this->key.size() - prefix_size) + utils::Varint::size(value_size << 1)
+           + this->size() - prefix_size;
+  }
+
+  /** The size of a node holding items, with their common prefix of
+   ** prefix_size bytes counted once, see Node::size. */
+  template <typename Tp_items>
+  static auto _size(const Tp_items& items, const uint32_t prefix_size) noexcept -> uint32_t
   {
-    return this->key.size() + this->value.size();
+    return std::accumulate(
+      items.begin(),
+      items.end(),
+      static_cast<uint32_t>(Node::HEADER_SIZE + prefix_size + sizeof(page::Page_num)),
+      [&](const uint32_t size, const auto& item) { return size + item.size() - prefix_size; });
+  }
+
+  /** The serialized size of a node holding items and children_count
+   ** children, see Node::serialized_size. */
+  template <typename Tp_items>
+  static auto _serialized_size(const Tp_items& items, const uint32_t prefix_size, const size_t children_count) noexcept
+    -> uint32_t
+  {
+    auto size = Node::HEADER_SIZE + prefix_size + children_count * sizeof(page::Page_num);
+    for (const auto& item : items)
+      size += sizeof(Node::Fingerprint) + sizeof(uint16_t) + item.cell_size(prefix_size);
+    return size;
+  }
+
+  template <typename Tp_items> static auto _prefix_size(const Tp_items& items) noexcept -> uint32_t
+  {
+    if (items.empty())
+      return 0;
+
+    /* The keys are sorted, the first and the last one share the least. */
+    return std::min(utils::Safecmp::mismatch(items.front().key, items.back().key), size_t{UINT16_MAX});
   }
 
   [[nodiscard]] auto Node::item_size(uint32_t index) const noexcept -> uint32_t
   {
     try
       {
-        const auto& [key, value] = this->items[index];
-        return key.size() + value.size() + sizeof(Page::page_num);
+        return this->items.at(index).size() + sizeof(Page::page_num);
       }
     catch (const std::out_of_range& e)
       {
@@ -32,78 +84,85 @@ namespace toocal::core::node
 
   [[nodiscard]] auto Node::size() const noexcept -> uint32_t
   {
-    return std::accumulate(
-      items.begin(),
-      items.end(),
-      static_cast<uint32_t>(Node::HEADER_SIZE + sizeof(page::Page_num)),
-      [&](const uint32_t size, const auto& item) { return size + item.size(); });
+    return _size(this->items, this->prefix_size());
   }
 
-  [[nodiscard]] auto Node::is_last(const uint32_t index, const Node& parent_node) const noexcept
-    -> bool
+  [[nodiscard]] auto Node::serialized_size() const noexcept -> uint32_t
   {
-    return index == parent_node.items.size();
+    return _serialized_size(this->items, this->prefix_size(), this->children.size());
   }
 
-  [[nodiscard]] auto Node::is_first(const uint32_t index) const noexcept -> bool
+  [[nodiscard]] auto Node::prefix_size() const noexcept -> uint32_t { return _prefix_size(this->items); }
+
+  [[nodiscard]] auto Node::size(const std::span<const Item_view> items) noexcept -> uint32_t
   {
-    return index == 0;
+    return _size(items, Node::prefix_size(items));
   }
 
-  [[nodiscard]] auto Node::find_key_helper(
-    const Node&                 node,
-    const std::vector<uint8_t>& key,
-    const bool                  exact,
-    std::deque<uint32_t>&       ancestors_indexes) noexcept
-    -> tl::expected<std::tuple<int, tl::optional<Node>>, Error>
+  [[nodiscard]] auto Node::serialized_size(const std::span<const Item_view> items) noexcept -> uint32_t
   {
-    const auto [was_found, index] = node.find_key_in_node(key);
-    if (was_found)
-      return std::make_tuple(index, node);
+    return _serialized_size(items, Node::prefix_size(items), 0);
+  }
 
-    if (node.is_leaf())
-      {
-        if (exact)
-          return std::make_tuple(-1, tl::nullopt);
-        return std::make_tuple(index, node);
-      }
+  [[nodiscard]] auto Node::prefix_size(const std::span<const Item_view> items) noexcept -> uint32_t
+  {
+    return _prefix_size(items);
+  }
 
-    ancestors_indexes.push_back(index);
-    return node.dal->get_node(node.children[index]).and_then([&](const auto& next_child) {
-      return find_key_helper(next_child, key, exact, ancestors_indexes);
-    });
+  [[nodiscard]] auto Node::is_last(const uint32_t index, const Node& parent_node) const noexcept
+    -> bool
+  {
+    return index == parent_node.items.size();
+  }
+
+  [[nodiscard]] auto Node::is_first(const uint32_t index) const noexcept -> bool
+  {
+    return index == 0;
   }
 
   [[nodiscard]] auto Node::find_key_in_node(const std::vector<uint8_t>& key) const noexcept
     -> std::tuple<bool, uint32_t>
   {
-    for (uint32_t index = 0; const auto& [existing_item_key, _] : this->items)
+    /* Find the first item whose key is not smaller than the key. */
+    uint32_t low = 0, high = this->items.size();
+    while (low < high)
       {
-        const auto compare_result = utils::Safecmp::bytescmp(existing_item_key, key);
-        if (compare_result == 0)
-          return {true, index};
-
-        /* The key is bigger than the previous item, so it doesn't exist in the
-         * node, but may exist in child nodes. */
-        if (compare_result == 1)
-          return {false, index};
-        ++index;
+        const auto middle = low + (high - low) / 2;
+        if (utils::Safecmp::bytescmp(this->items[middle].key, key) < 0)
+          low = middle + 1;
+        else
+          high = middle;
       }
 
+    if (low < this->items.size() && 0 == utils::Safecmp::bytescmp(this->items[low].key, key))
+      return {true, low};
+
     /* The key is bigger than the previous item, so it doesn't exist in the
      * node, but may exist in child nodes. */
-    return {false, this->items.size()};
+    return {false, low};
   }
 
-  [[nodiscard]] auto Node::find_key(const std::vector<uint8_t>& key, const bool exact) const noexcept
-    -> tl::expected<std::tuple<int, tl::optional<Node>, std::deque<uint32_t>>, Error>
+  [[nodiscard]] auto Node::child_index(const bool was_found, const uint32_t index) noexcept
+    -> uint32_t
   {
-    auto ancestors_indexes = std::deque<uint32_t>{/* index of root */ 0};
+    return was_found ? index + 1 : index;
+  }
 
-    return find_key_helper(*this, key, exact, ancestors_indexes).map([&](const auto& result) {
-      const auto& [index, node] = result;
-      return std::make_tuple(index, node, ancestors_indexes);
-    });
+  [[nodiscard]] auto
+    Node::separator(const std::span<const uint8_t> left, const std::span<const uint8_t> right) noexcept
+    -> std::vector<uint8_t>
+  {
+    /* right is greater than left, they differ at the byte after their
+     * common prefix, or left ends there. */
+    const auto common = utils::Safecmp::mismatch(left, right);
+    return std::vector<uint8_t>(right.begin(), right.begin() + std::min(common + 1, right.size()));
+  }
+
+  [[nodiscard]] auto Node::fingerprint(const std::span<const uint8_t> suffix) noexcept -> Fingerprint
+  {
+    auto bytes = std::array<uint8_t, sizeof(Fingerprint)>{};
+    std::copy_n(suffix.begin(), std::min(suffix.size(), bytes.size()), bytes.begin());
+    return endian::big_endian::get<Fingerprint>(bytes.data());
   }
 
   auto Node::add_item(const Item& item, const uint32_t insertion_index) noexcept -> uint32_t
@@ -131,15 +190,33 @@ namespace toocal::core::node
     Data_access_layer* dal, Node& node_to_split, const uint32_t split_index, Node& new_node) noexcept
     -> void
   {
+    /* The new leaf keeps the item at split_index, it is linked between the
+     * leaf and its next one. */
     auto node = dal->new_node(
-      std::deque<Item>{node_to_split.items.begin() + split_index + 1, node_to_split.items.end()},
-      std::deque<page::Page_num>{});
+      std::deque<Item>{node_to_split.items.begin() + split_index, node_to_split.items.end()},
+      std::deque<page::Page_num>{},
+      node_to_split.page_num);
+
+    node.prev = node_to_split.page_num;
+    node.next = node_to_split.next;
+
+    /* With copy on write the links are not kept, the next leaf is committed. */
+    const auto link_next = [&]() -> tl::expected<std::nullptr_t, Error> {
+      if (0 == node.next || dal->options.copy_on_write)
+        return nullptr;
+      return dal->get_node(node.next).and_then([&](auto&& next) {
+        next.prev = node.page_num;
+        return dal->write_node(next);
+      });
+    };
 
     dal->write_node(node)
+      .and_then([&](const auto&& _) { return link_next(); })
       .map([&](const auto&& _) {
-        new_node = std::move(node);
+        node_to_split.next = node.page_num;
         node_to_split.items.erase(
           node_to_split.items.begin() + split_index, node_to_split.items.end());
+        new_node = std::move(node);
 
         return nullptr;
       })
@@ -156,7 +233,8 @@ namespace toocal::core::node
     auto node = dal->new_node(
       std::deque<Item>{node_to_split.items.begin() + split_index + 1, node_to_split.items.end()},
       std::deque<page::Page_num>{
-        node_to_split.children.begin() + split_index + 1, node_to_split.children.end()});
+        node_to_split.children.begin() + split_index + 1, node_to_split.children.end()},
+      node_to_split.page_num);
 
     dal->write_node(node)
       .map([&](const auto&& _) {
@@ -179,11 +257,23 @@ namespace toocal::core::node
   {
     /* the first index where min amount of bytes to populate a page is archived.
      * then add 1 so it will be split one index after. */
-    const auto split_index = node_to_split.dal->get_split_index(node_to_split);
-    const auto middle_item = node_to_split.items[split_index];
+    auto split_index = node_to_split.dal->get_split_index(node_to_split);
+
+    /* With large items the minimum may only be reached at the last item, keep
+     * at least one item in the new node, and in the split one for a leaf. An
+     * internal node moves its middle item up, a leaf only copies its key. */
+    const auto is_leaf = node_to_split.is_leaf();
+    if (split_index > node_to_split.items.size() - (is_leaf ? 1 : 2))
+      split_index = node_to_split.items.size() - (is_leaf ? 1 : 2);
+
+    const auto middle_item =
+      is_leaf ? Item{
+                  Node::separator(node_to_split.items[split_index - 1].key, node_to_split.items[split_index].key),
+                  {}}
+              : node_to_split.items[split_index];
 
     Node new_node;
-    if (node_to_split.is_leaf())
+    if (is_leaf)
       _split_when_node_is_leaf(this->dal, node_to_split, split_index, new_node);
     else
       _split_when_node_is_not_leaf(this->dal, node_to_split, split_index, new_node);
@@ -196,7 +286,8 @@ namespace toocal::core::node
     else
       this->children.insert(this->children.begin() + node_to_split_index + 1, new_node.page_num);
 
-    this->dal->write_node(*this)
+    /* An over populated parent is split in turn, and only written then. */
+    (this->is_over_populated() ? tl::expected<std::nullptr_t, Error>{nullptr} : this->dal->write_node(*this))
       .and_then([&](const auto&& _) { return this->dal->write_node(node_to_split); })
       .map_error([](auto&& error) {
         error.append("write_node error in Node::split");
@@ -213,40 +304,6 @@ namespace toocal::core::node
     });
   }
 
-  [[nodiscard]] auto Node::remove_item_from_internal(int32_t index) noexcept
-    -> tl::expected<std::deque<int32_t>, Error>
-  {
-    auto affected_nodes = std::deque<int32_t>{index};
-
-    return this->dal->get_node(this->children[index])
-      .and_then([&](auto&& node) {
-        /* starting from its left child, descend to the rightmost descendant. */
-        while (!node.is_leaf())
-          {
-            const auto traversing_index = node.children.size() - 1;
-            node.dal->get_node(node.children[traversing_index])
-              .map([&](const auto&& anode) {
-                node = anode;
-                affected_nodes.push_back(traversing_index);
-                return nullptr;
-              })
-              .map_error([&](auto&& error) {
-                error.append("get_node error in Node::remove_item_from_internal");
-                return error.panic();
-              });
-          }
-
-        /* replace the item that should be removed with
-         * the item before inorder which we just found. */
-        this->items[index] = node.items.back();
-        node.items.pop_back();
-
-        return this->dal->write_node(node).map(
-          [&](const auto&& _) { return this->dal->write_node(*this); });
-      })
-      .map([&](const auto&& _) { return affected_nodes; });
-  }
-
   auto Node::rotate_right(Node& anode, Node& pnode, Node& bnode, int32_t bnode_index) noexcept
     -> void
   {
@@ -254,8 +311,18 @@ namespace toocal::core::node
     const auto anode_item = anode.items.back();
     anode.items.pop_back();
 
-    /* get item from parent node and assign the aNodeItem item instead. */
     const auto pnode_item_index = (this->is_first(bnode_index)) ? 0 : bnode_index - 1;
+
+    /* Between leaves the item moves over and the separator becomes its key,
+     * shortened as long as it stays greater than the new last key of a. */
+    if (anode.is_leaf())
+      {
+        pnode.items[pnode_item_index] = Item{Node::separator(anode.items.back().key, anode_item.key), {}};
+        bnode.items.push_front(anode_item);
+        return;
+      }
+
+    /* get item from parent node and assign the aNodeItem item instead. */
     const auto pnode_item = pnode.items[pnode_item_index];
 
     pnode.items[pnode_item_index] = anode_item;
@@ -263,15 +330,10 @@ namespace toocal::core::node
     /* assign parent item to b and make it first */
     bnode.items.push_front(pnode_item);
 
-    /* if it's an inner leaf then move children as well. */
-    if (!anode.is_leaf())
-      {
-        const auto child_to_shift = anode.children.back();
-        anode.children.pop_back();
-        bnode.children.push_front(child_to_shift);
-      }
-
-    return;
+    /* move the children as well. */
+    const auto child_to_shift = anode.children.back();
+    anode.children.pop_back();
+    bnode.children.push_front(child_to_shift);
   }
 
   auto Node::rotate_left(Node& anode, Node& pnode, Node& bnode, int32_t bnode_index) noexcept
@@ -281,88 +343,117 @@ namespace toocal::core::node
     const auto bnode_item = bnode.items[0];
     bnode.items.pop_front();
 
-    /* get item from parent node and assign the bNodeItem item instead */
     const auto pnode_item_index =
       (this->is_last(bnode_index, pnode)) ? (pnode.items.size() - 1) : bnode_index;
 
+    /* Between leaves the item moves over and the separator becomes the key
+     * of the new first item of b, shortened. */
+    if (bnode.is_leaf())
+      {
+        pnode.items[pnode_item_index] = Item{Node::separator(bnode_item.key, bnode.items[0].key), {}};
+        anode.items.push_back(bnode_item);
+        return;
+      }
+
+    /* get item from parent node and assign the bNodeItem item instead */
     const auto pnode_item = pnode.items[pnode_item_index];
     pnode.items[pnode_item_index] = bnode_item;
 
     /* assign parent item to a and make it last */
     anode.items.push_back(pnode_item);
 
-    /* if it's an inner leaf then move children as well. */
-    if (!bnode.is_leaf())
-      {
-        const auto child_to_shift = bnode.children[0];
-        bnode.children.pop_front();
-        anode.children.push_back(child_to_shift);
-      }
-
-    return;
+    /* move the children as well. */
+    const auto child_to_shift = bnode.children[0];
+    bnode.children.pop_front();
+    anode.children.push_back(child_to_shift);
   }
 
   [[nodiscard]] auto Node::merge(Node& bnode, int32_t bnode_index) noexcept
     -> tl::expected<std::nullptr_t, Error>
   {
-    return this->dal->get_node(this->children[bnode_index - 1]).and_then([&](auto&& node) {
-      /* take the item from the parent, remove it and add it to the unbalanced node */
-      const auto pnode_item = this->items[bnode_index - 1];
+    return this->dal->get_node(this->children[bnode_index - 1])
+      .and_then([&](auto&& node) -> tl::expected<std::nullptr_t, Error> {
+        /* take the item from the parent, remove it and add it to the unbalanced
+         * node, unless they are leaves: the separator is only a copy of a key. */
+        const auto is_leaf = node.is_leaf();
+        const auto pnode_item = this->items[bnode_index - 1];
+
+        /* When min_fill_percent is more than half of max_fill_percent the merged node
+         * may not fit in a page, the unbalanced node is then left under populated.
+         * The merged keys may also share a shorter prefix than the keys of either node. */
+        auto merged = Node{node.items, node.children};
+        if (!is_leaf)
+          merged.items.push_back(pnode_item);
+        merged.items.insert(merged.items.end(), bnode.items.begin(), bnode.items.end());
+        merged.children.insert(merged.children.end(), bnode.children.begin(), bnode.children.end());
+
+        if (merged.serialized_size() > this->dal->options.page_size)
+          return nullptr;
 
-      this->items.erase(this->items.begin() + bnode_index - 1);
-      node.items.push_back(pnode_item);
-      node.items.insert(node.items.end(), bnode.items.begin(), bnode.items.end());
-      this->children.erase(this->children.begin() + bnode_index);
+        this->items.erase(this->items.begin() + bnode_index - 1);
+        this->children.erase(this->children.begin() + bnode_index);
+        node.items = std::move(merged.items);
+        node.children = std::move(merged.children);
 
-      if (!node.is_leaf())
-        node.children.insert(node.children.end(), bnode.children.begin(), bnode.children.end());
+        /* Unlink b, the leaf after it now follows the merged one. */
+        const auto unlink = [&]() -> tl::expected<std::nullptr_t, Error> {
+          if (!is_leaf)
+            return nullptr;
 
-      return this->dal->write_node(node)
-        .and_then([&](const auto&& _) { return this->dal->write_node(*this); })
-        .map([&](const auto&& _) {
-          this->dal->delete_node(bnode.page_num);
-          return nullptr;
-        });
-    });
+          node.next = bnode.next;
+          if (0 == bnode.next || this->dal->options.copy_on_write)
+            return nullptr;
+
+          return this->dal->get_node(bnode.next).and_then([&](auto&& next) {
+            next.prev = node.page_num;
+            return this->dal->write_node(next);
+          });
+        };
+
+        return unlink()
+          .and_then([&](const auto&& _) { return this->dal->write_node(node); })
+          .and_then([&](const auto&& _) { return this->dal->write_node(*this); })
+          .map([&](const auto&& _) {
+            this->dal->delete_node(bnode.page_num);
+            return nullptr;
+          });
+      });
   }
 
   [[nodiscard]] auto
     Node::rebalance_remove(Node& unbalanced_node, int32_t unbalanced_node_index) noexcept
     -> tl::expected<std::nullptr_t, Error>
   {
-    auto pnode = *this;
     /* right rotate */
     if (unbalanced_node_index != 0)
       {
-        this->dal->get_node(pnode.children[unbalanced_node_index - 1])
-          .and_then([&](auto&& left_node) -> tl::expected<std::nullptr_t, Error> {
-            if (left_node.can_spare_an_element())
-              {
-                rotate_right(left_node, pnode, unbalanced_node, unbalanced_node_index);
-                return this->dal->write_node(left_node)
-                  .and_then([&](const auto&& _) { return this->dal->write_node(pnode); })
-                  .and_then([&](const auto&& _) { return this->dal->write_node(unbalanced_node); });
-              }
+        auto left_node = this->dal->get_node(this->children[unbalanced_node_index - 1]);
+        if (!left_node.has_value())
+          return tl::make_unexpected(left_node.error());
 
-            return nullptr;
-          });
+        if (left_node->can_spare_an_element())
+          {
+            rotate_right(left_node.value(), *this, unbalanced_node, unbalanced_node_index);
+            return this->dal->write_node(left_node.value())
+              .and_then([&](const auto&& _) { return this->dal->write_node(*this); })
+              .and_then([&](const auto&& _) { return this->dal->write_node(unbalanced_node); });
+          }
       }
 
-    /* left balance */
-    if (unbalanced_node_index != pnode.children.size() - 1)
+    /* left rotate */
+    if (unbalanced_node_index != this->children.size() - 1)
       {
-        this->dal->get_node(pnode.children[unbalanced_node_index + 1])
-          .and_then([&](auto&& right_node) -> tl::expected<std::nullptr_t, Error> {
-            if (right_node.can_spare_an_element())
-              {
-                rotate_left(unbalanced_node, pnode, right_node, unbalanced_node_index);
-                return this->dal->write_node(unbalanced_node)
-                  .and_then([&](const auto&& _) { return this->dal->write_node(pnode); })
-                  .and_then([&](const auto&& _) { return this->dal->write_node(right_node); });
-              }
+        auto right_node = this->dal->get_node(this->children[unbalanced_node_index + 1]);
+        if (!right_node.has_value())
+          return tl::make_unexpected(right_node.error());
 
-            return nullptr;
-          });
+        if (right_node->can_spare_an_element())
+          {
+            rotate_left(unbalanced_node, *this, right_node.value(), unbalanced_node_index);
+            return this->dal->write_node(unbalanced_node)
+              .and_then([&](const auto&& _) { return this->dal->write_node(*this); })
+              .and_then([&](const auto&& _) { return this->dal->write_node(right_node.value()); });
+          }
       }
 
     /* The merge function merges a given node with its node to the right.
@@ -372,9 +463,9 @@ namespace toocal::core::node
      * will be merged into the unbalanced node. */
     if (unbalanced_node_index == 0)
       return this->dal->get_node(this->children[unbalanced_node_index + 1])
-        .and_then([&](auto&& node) { return pnode.merge(node, unbalanced_node_index + 1); });
+        .and_then([&](auto&& node) { return this->merge(node, unbalanced_node_index + 1); });
 
-    return pnode.merge(unbalanced_node, unbalanced_node_index);
+    return this->merge(unbalanced_node, unbalanced_node_index);
   }
 
   [[nodiscard]] auto Node::can_spare_an_element() const noexcept -> bool
@@ -383,4 +474,195 @@ namespace toocal::core::node
       return false;
     return true;
   }
+
+  [[nodiscard]] auto Node_view::is_leaf() const noexcept -> bool { return this->data[0] != 0; }
+
+  [[nodiscard]] auto Node_view::items_count() const noexcept -> uint16_t
+  {
+    return endian::little_endian::get<uint16_t>(this->data.data() + 1);
+  }
+
+  [[nodiscard]] auto Node_view::fingerprints_position() const noexcept -> uint32_t
+  {
+    return Node::HEADER_SIZE
+           + endian::little_endian::get<uint16_t>(this->data.data() + Node::HEADER_SIZE - sizeof(uint16_t));
+  }
+
+  [[nodiscard]] auto Node_view::slots_position() const noexcept -> uint32_t
+  {
+    return this->fingerprints_position() + this->items_count() * sizeof(Node::Fingerprint);
+  }
+
+  [[nodiscard]] auto Node_view::offset_position(const uint32_t index) const noexcept -> uint32_t
+  {
+    if (this->is_leaf())
+      return this->slots_position() + index * sizeof(uint16_t);
+
+    /* Every offset of an internal node is preceded by the page of its left child. */
+    return this->slots_position() + index * (sizeof(page::Page_num) + sizeof(uint16_t))
+           + sizeof(page::Page_num);
+  }
+
+  [[nodiscard]] auto Node_view::cell_position(const uint32_t index) const noexcept -> uint32_t
+  {
+    return endian::little_endian::get<uint16_t>(this->data.data() + this->offset_position(index));
+  }
+
+  [[nodiscard]] auto Node_view::value_position(const uint32_t index) const noexcept -> uint32_t
+  {
+    const auto position = this->cell_position(index);
+    uint64_t   key_size;
+    return position + utils::Varint::get(this->data.data() + position, key_size) + key_size;
+  }
+
+  [[nodiscard]] auto Node_view::prefix() const noexcept -> std::span<const uint8_t>
+  {
+    return this->data.subspan(Node::HEADER_SIZE, this->fingerprints_position() - Node::HEADER_SIZE);
+  }
+
+  [[nodiscard]] auto Node_view::suffix(const uint32_t index) const noexcept
+    -> std::span<const uint8_t>
+  {
+    const auto position = this->cell_position(index);
+    uint64_t   suffix_size;
+    const auto header_size = utils::Varint::get(this->data.data() + position, suffix_size);
+    return this->data.subspan(position + header_size, suffix_size);
+  }
+
+  [[nodiscard]] auto Node_view::key(const uint32_t index) const noexcept -> std::vector<uint8_t>
+  {
+    const auto prefix = this->prefix();
+    const auto suffix = this->suffix(index);
+
+    auto key = std::vector<uint8_t>{};
+    key.reserve(prefix.size() + suffix.size());
+    key.insert(key.end(), prefix.begin(), prefix.end());
+    key.insert(key.end(), suffix.begin(), suffix.end());
+    return key;
+  }
+
+  [[nodiscard]] auto Node_view::value(const uint32_t index) const noexcept
+    -> std::span<const uint8_t>
+  {
+    const auto position = this->value_position(index);
+    uint64_t   header;
+    const auto header_size = utils::Varint::get(this->data.data() + position, header);
+
+    if (header & 1)
+      return {};
+    return this->data.subspan(position + header_size, header >> 1);
+  }
+
+  [[nodiscard]] auto Node_view::is_overflow(const uint32_t index) const noexcept -> bool
+  {
+    return (this->data[this->value_position(index)] & 1) != 0;
+  }
+
+  [[nodiscard]] auto Node_view::prev() const noexcept -> page::Page_num
+  {
+    return endian::little_endian::get<page::Page_num>(this->data.data() + 3);
+  }
+
+  [[nodiscard]] auto Node_view::next() const noexcept -> page::Page_num
+  {
+    return endian::little_endian::get<page::Page_num>(
+      this->data.data() + 3 + sizeof(page::Page_num));
+  }
+
+  [[nodiscard]] auto Node_view::child(const uint32_t index) const noexcept -> page::Page_num
+  {
+    return endian::little_endian::get<page::Page_num>(
+      this->data.data() + this->slots_position()
+      + index * (sizeof(page::Page_num) + sizeof(uint16_t)));
+  }
+
+  [[nodiscard]] auto Node_view::fingerprint(const uint32_t index) const noexcept -> Node::Fingerprint
+  {
+    return endian::big_endian::get<Node::Fingerprint>(
+      this->data.data() + this->fingerprints_position() + index * sizeof(Node::Fingerprint));
+  }
+
+  [[nodiscard]] auto Node_view::item(const uint32_t index) const noexcept -> Item
+  {
+    auto       key = this->key(index);
+    const auto position = this->value_position(index);
+    uint64_t   header;
+    const auto header_size = utils::Varint::get(this->data.data() + position, header);
+
+    if (header & 1)
+      return Item{
+        std::move(key),
+        {},
+        endian::little_endian::get<page::Page_num>(this->data.data() + position + header_size),
+        static_cast<uint32_t>(header >> 1)};
+
+    const auto value = this->data.subspan(position + header_size, header >> 1);
+    return Item{std::move(key), {value.begin(), value.end()}};
+  }
+
+  [[nodiscard]] auto Node_view::item_view(const uint32_t index, arena::Arena& arena) const noexcept
+    -> Item_view
+  {
+    const auto prefix = this->prefix();
+    auto       key = this->suffix(index);
+    if (!prefix.empty())
+      {
+        const auto whole = arena.allocate<uint8_t>(prefix.size() + key.size());
+        std::copy(key.begin(), key.end(), std::copy(prefix.begin(), prefix.end(), whole.begin()));
+        key = whole;
+      }
+
+    const auto position = this->value_position(index);
+    uint64_t   header;
+    const auto header_size = utils::Varint::get(this->data.data() + position, header);
+
+    if (header & 1)
+      return Item_view{
+        key,
+        {},
+        endian::little_endian::get<page::Page_num>(this->data.data() + position + header_size),
+        static_cast<uint32_t>(header >> 1)};
+
+    return Item_view{key, this->data.subspan(position + header_size, header >> 1)};
+  }
+
+  [[nodiscard]] auto Node_view::find_key_in_node(const std::span<const uint8_t> key) const noexcept
+    -> std::tuple<bool, uint32_t>
+  {
+    const uint32_t items_count = this->items_count();
+
+    /* A key outside of the prefix is before or after every key of the page,
+     * otherwise only the rest of it is compared to the suffixes. */
+    const auto prefix = this->prefix();
+    if (const auto order = utils::Safecmp::bytescmp(key.first(std::min(key.size(), prefix.size())), prefix);
+        order != 0)
+      return {false, order > 0 ? items_count : 0};
+
+    const auto rest = key.subspan(prefix.size());
+    const auto fingerprint = Node::fingerprint(rest);
+    const auto fingerprints = this->data.data() + this->fingerprints_position();
+
+    /* The suffix is only read when the fingerprints are the same. */
+    const auto compare = [&](const uint32_t index) {
+      const auto other = endian::big_endian::get<Node::Fingerprint>(fingerprints + index * sizeof(Node::Fingerprint));
+      if (other != fingerprint)
+        return other < fingerprint ? -1 : 1;
+      return utils::Safecmp::bytescmp(this->suffix(index), rest);
+    };
+
+    uint32_t low = 0, high = items_count;
+    while (low < high)
+      {
+        const auto middle = low + (high - low) / 2;
+        if (compare(middle) < 0)
+          low = middle + 1;
+        else
+          high = middle;
+      }
+
+    if (low < items_count && 0 == compare(low))
+      return {true, low};
+
+    return {false, low};
+  }
 } // namespace toocal::core::node
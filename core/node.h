@@ -1,6 +1,7 @@
 #ifndef TOOCAL_CORE_NODE_H
 #define TOOCAL_CORE_NODE_H
 
+#include "arena.h"
 #include "errors.hpp"
 #include "page.h"
 #include <cstddef>
@@ -13,9 +14,11 @@
 #include "tl/expected.hpp"
 #include "tl/optional.hpp"
 #include "types.hpp"
+#include "utils.h"
 #include <endian/stream_reader.hpp>
 #include <endian/stream_writer.hpp>
 #include <endian/little_endian.hpp>
+#include <endian/big_endian.hpp>
 
 namespace toocal::core::data_access_layer
 {
@@ -35,9 +38,61 @@ namespace toocal::core::node
     std::vector<uint8_t> key;
     std::vector<uint8_t> value;
 
+    /** The first page of the overflow chain holding the value when it is too
+     ** large to be stored in a node (see Data_access_layer::store_value), 0
+     ** otherwise. value is empty until Data_access_layer::load_value reads
+     ** the chain. */
+    page::Page_num overflow{};
+    uint32_t       overflow_size{};
+
+    [[nodiscard]] auto is_overflow() const noexcept -> bool;
+
+    /** The size of the key and of the value, or of the first overflow page
+     ** when the value is in an overflow chain. */
     [[nodiscard]] auto size() const noexcept -> uint32_t;
+
+    /** The size of the cell of the item in a node page whose keys share
+     ** their first prefix_size bytes, see Serializer<Node>. */
+    [[nodiscard]] auto cell_size(uint32_t prefix_size = 0) const noexcept -> uint32_t;
   };
 
+  /** Item_view is an Item that does not own its key and value, they point
+   ** into a page or into an arena::Arena. A leaf is rewritten from its
+   ** Item_views without being decoded into a Node. */
+  class Item_view
+  {
+  public:
+    std::span<const uint8_t> key;
+    std::span<const uint8_t> value;
+    page::Page_num           overflow{};
+    uint32_t                 overflow_size{};
+
+    Item_view() = default;
+
+    Item_view(const Item& item)
+      : key(item.key), value(item.value), overflow(item.overflow), overflow_size(item.overflow_size)
+    {}
+
+    Item_view(
+      std::span<const uint8_t> key,
+      std::span<const uint8_t> value,
+      page::Page_num           overflow = 0,
+      uint32_t                 overflow_size = 0)
+      : key(key), value(value), overflow(overflow), overflow_size(overflow_size)
+    {}
+
+    /** Same as the ones of Item. */
+    [[nodiscard]] auto is_overflow() const noexcept -> bool;
+    [[nodiscard]] auto size() const noexcept -> uint32_t;
+    [[nodiscard]] auto cell_size(uint32_t prefix_size = 0) const noexcept -> uint32_t;
+  };
+
+  /** Node is a page of a B+tree. The leaves hold the items, and are linked
+   ** to the leaves before and after them in key order, so a scan walks the
+   ** leaves without going back up the tree. The internal nodes only hold
+   ** separator keys, items with an empty value, and the children between
+   ** them: the keys smaller than the separator at index are in the child at
+   ** index, the others in the children after it. */
   class Node
   {
   public:
@@ -46,6 +101,11 @@ namespace toocal::core::node
     std::deque<Item>           items;
     std::deque<page::Page_num> children;
 
+    /** The leaves before and after this one in key order, 0 at either end
+     ** and in the internal nodes. */
+    page::Page_num prev{};
+    page::Page_num next{};
+
     Node() = default;
     Node(const Node&) = default;
     Node(Node&&) = default;
@@ -72,24 +132,27 @@ namespace toocal::core::node
 
     [[nodiscard]] auto is_first(uint32_t index) const noexcept -> bool;
 
-    /** Returns the size of a key-value-childNode triplet at a given index. If
-     ** the node is a leaf, then the size of a key-value pair is returned. It's
+    /** Returns the size of a key-value-childNode triplet at a given index. It's
      ** assumed i <= len(n.items) */
     [[nodiscard]] auto item_size(uint32_t index) const noexcept -> uint32_t;
 
-    /** Returns the node's size in bytes */
+    /** Returns the node's size in bytes, with the common prefix of its keys
+     ** counted once. */
     [[nodiscard]] auto size() const noexcept -> uint32_t;
 
-    /** Searches for a key inside the tree. Once the key is found, the
-     ** parent node and the correct index are returned so the key itself can be
-     ** accessed in the following way parent[index]. A list of the node
-     ** ancestors (not including the node itself) is also returned. If the key
-     ** is not found, we have 2 options. If exact is true, it means we expect
-     ** find_key to find the key, so a falsey answer. If exact is false, then
-     ** find_key is used to locate where a new key should be inserted so the
-     ** position is returned. */
-    [[nodiscard]] auto find_key(const std::vector<uint8_t>& key, bool exact) const noexcept
-      -> tl::expected<std::tuple<int, tl::optional<Node>, std::deque<uint32_t>>, Error>;
+    /** The size of the node once serialized, including the offsets, the key
+     ** and value sizes and the children that size leaves out. */
+    [[nodiscard]] auto serialized_size() const noexcept -> uint32_t;
+
+    /** The number of first bytes shared by all the keys of the node. They
+     ** are stored once in the page, see Serializer<Node>. */
+    [[nodiscard]] auto prefix_size() const noexcept -> uint32_t;
+
+    /** Same as size, serialized_size and prefix_size, for a leaf holding
+     ** items. */
+    [[nodiscard]] static auto size(std::span<const Item_view> items) noexcept -> uint32_t;
+    [[nodiscard]] static auto serialized_size(std::span<const Item_view> items) noexcept -> uint32_t;
+    [[nodiscard]] static auto prefix_size(std::span<const Item_view> items) noexcept -> uint32_t;
 
     auto add_item(const Item& item, uint32_t insertion_index) noexcept -> uint32_t;
 
@@ -102,30 +165,19 @@ namespace toocal::core::node
     /** split rebalances the tree after adding. After insertion the modified
      ** node has to be checked to make sure it didn't exceed the maximum
      ** number of elements. If it did, then it has to be split and rebalanced.
-     ** The mapation is depicted in the graph below. If it's not a leaf node,
-     ** then the children has to be moved as well as shown. This may leave the
-     ** parent unbalanced by having too many items so rebalancing has to be
-     ** checked for all the ancestors. The split is performed in a for loop to
-     ** support splitting a node more than once. (Though in practice used only
-     ** once):
+     ** A leaf keeps its items on both sides and the key of the first item of
+     ** the new leaf is copied up as a separator, which is linked between the
+     ** leaf and its next one. An internal node moves its middle separator up,
+     ** along with the children after it. This may leave the parent unbalanced
+     ** by having too many items so rebalancing has to be checked for all the
+     ** ancestors:
      ** 	       n                                  n
      **          3                                 3,6
      **	       /   \       ------>         /        |           \
      **	      a    modifiedNode           a     modifiedNode  newNode
-     **      1,2    4,5,6,7,8            1,2       4,5          7,8   */
+     **      1,2    3,4,5,6,7,8          1,2      3,4,5        6,7,8   */
     auto split(Node& node_to_split, uint32_t node_to_split_index) noexcept -> void;
 
-    /** Take element before inorder (The biggest element from the left branch),
-     ** put it in the removed index and remove it from the original node.
-     ** Track in affectedNodes any nodes in the path leading to that node.
-     ** It will be used in case the tree needs to be rebalanced.
-     **          p
-     **        /
-     **      ..
-     **   /     \
-     ** ..       a     */
-    [[nodiscard]] auto remove_item_from_internal(int32_t index) noexcept
-      -> tl::expected<std::deque<int32_t>, Error>;
     auto remove_item_from_leaf(int32_t index) noexcept -> void;
 
     /** rebalances the tree after a remove operation.
@@ -143,21 +195,27 @@ namespace toocal::core::node
     /** checks if the node size is big enough to populate a page after giving away one item. */
     [[nodiscard]] auto can_spare_an_element() const noexcept -> bool;
 
-    /**      p                              p
+    /** Between leaves the item moves from a to b and the separator becomes
+     ** its key, between internal nodes it goes through the parent:
+     **      p                              p
      **      4                              3
      **    /   \           ------>        /   \
      **   a     b (unbalanced)           a     b (unbalanced)
      ** 1,2,3   5                       1,2   4,5 */
     auto rotate_right(Node& anode, Node& pnode, Node& bnode, int32_t bnode_index) noexcept -> void;
 
-    /** 	              p                                   p
+    /** Between leaves the item moves from b to a and the separator becomes
+     ** the key of the new first item of b:
+     ** 	              p                                   p
      **                 2                                   3
      **	              /   \     ------>                   /   \
      **  (unbalanced)a     b                 (unbalanced)a     b
      **  1               3,4,5                          1,2   4,5 */
     auto rotate_left(Node& anode, Node& pnode, Node& bnode, int32_t bnode_index) noexcept -> void;
 
-    /**       p                       p
+    /** Merging internal nodes pulls the separator down, merging leaves drops
+     ** it and unlinks b:
+     **       p                       p
      **      3,5                      5
      **	  /   |   \   ------>      /     \
      **  a    b    c              a       c
@@ -165,22 +223,93 @@ namespace toocal::core::node
     [[nodiscard]] auto merge(Node& bnode, int32_t bnode_index) noexcept
       -> tl::expected<std::nullptr_t, Error>;
 
-    [[nodiscard]] static auto find_key_helper(
-      const Node&                 node,
-      const std::vector<uint8_t>& key,
-      bool                        exact,
-      std::deque<uint32_t>&       ancestors_indexes) noexcept
-      -> tl::expected<std::tuple<int, tl::optional<Node>>, Error>;
-
-    /** find_key_in_node iterates all the items and finds the key. If the key is
-     ** found, then the item is returned. If the key isn't found then return the
-     ** index where it should have been (the first index that key is greater
-     ** than it's previous). */
+  public:
+    /** find_key_in_node binary searches the sorted items for the key. If the
+     ** key is found, then its index is returned. If the key isn't found then
+     ** return the index where it should have been (the first index that key is
+     ** greater than it's previous). */
     [[nodiscard]] auto find_key_in_node(const std::vector<uint8_t>& key) const noexcept
       -> std::tuple<bool, uint32_t>;
 
+    /** The child of an internal node to descend into for a key, from the
+     ** result of find_key_in_node: a key equal to a separator is in the
+     ** child after it. */
+    [[nodiscard]] static auto child_index(bool was_found, uint32_t index) noexcept -> uint32_t;
+
+    /** The separator between two leaves: the shortest prefix of right that
+     ** is still greater than left, the last key of the leaf before it. */
+    [[nodiscard]] static auto separator(std::span<const uint8_t> left, std::span<const uint8_t> right) noexcept
+      -> std::vector<uint8_t>;
+
+    /** The first bytes of a key after the prefix of its page, big endian and
+     ** padded with zeros. Two keys with different fingerprints compare like
+     ** them, only keys with the same one are compared byte by byte. */
+    using Fingerprint = uint32_t;
+    [[nodiscard]] static auto fingerprint(std::span<const uint8_t> suffix) noexcept -> Fingerprint;
+
+    /** is_leaf, items_count, prev, next and the size of the prefix. */
+    static constexpr uint32_t HEADER_SIZE = 3 + 2 * sizeof(page::Page_num) + sizeof(uint16_t);
+  };
+
+  /** Node_view is a read-only view of a node page. It interprets the slotted
+   ** page layout written by Serializer<Node> (header, prefix, fingerprints,
+   ** offsets and cells) in place, so searching a page neither copies nor
+   ** allocates: the key searched is compared to the prefix once, then to the
+   ** contiguous fingerprints, and only to the suffixes stored in the cells
+   ** when the fingerprints are equal. A Node_view must not outlive the page
+   ** bytes it was created from. */
+  class Node_view
+  {
   public:
-    static constexpr uint32_t HEADER_SIZE = 3;
+    std::span<const uint8_t> data;
+
+    explicit Node_view(const std::span<const uint8_t> data) : data(data) {}
+
+    [[nodiscard]] auto is_leaf() const noexcept -> bool;
+    [[nodiscard]] auto items_count() const noexcept -> uint16_t;
+    /** The bytes shared by all the keys of the page. */
+    [[nodiscard]] auto prefix() const noexcept -> std::span<const uint8_t>;
+    /** The key of the item at index without the prefix. */
+    [[nodiscard]] auto suffix(uint32_t index) const noexcept -> std::span<const uint8_t>;
+    /** Copies the whole key of the item at index. */
+    [[nodiscard]] auto key(uint32_t index) const noexcept -> std::vector<uint8_t>;
+    /** The inline value of the item at index, empty if it is in an overflow chain. */
+    [[nodiscard]] auto value(uint32_t index) const noexcept -> std::span<const uint8_t>;
+    [[nodiscard]] auto is_overflow(uint32_t index) const noexcept -> bool;
+    [[nodiscard]] auto child(uint32_t index) const noexcept -> page::Page_num;
+    [[nodiscard]] auto fingerprint(uint32_t index) const noexcept -> Node::Fingerprint;
+    [[nodiscard]] auto prev() const noexcept -> page::Page_num;
+    [[nodiscard]] auto next() const noexcept -> page::Page_num;
+
+    /** Copies the item at index out of the page, without reading its
+     ** overflow chain. */
+    [[nodiscard]] auto item(uint32_t index) const noexcept -> Item;
+
+    /** The item at index without copying it: the value points into the
+     ** page, and so does the key unless the page has a prefix, in which case
+     ** the key is put back together in arena. */
+    [[nodiscard]] auto item_view(uint32_t index, arena::Arena& arena) const noexcept -> Item_view;
+
+    /** Same as Node::find_key_in_node, binary searching the offset array
+     ** without decoding the items. */
+    [[nodiscard]] auto find_key_in_node(std::span<const uint8_t> key) const noexcept
+      -> std::tuple<bool, uint32_t>;
+
+  private:
+    /** The position of the fingerprints, after the prefix. */
+    [[nodiscard]] auto fingerprints_position() const noexcept -> uint32_t;
+
+    /** The position of the first offset, or of the first child, after the fingerprints. */
+    [[nodiscard]] auto slots_position() const noexcept -> uint32_t;
+
+    /** The position of the cell offset of the item at index. */
+    [[nodiscard]] auto offset_position(uint32_t index) const noexcept -> uint32_t;
+
+    /** The position of the cell (suffix size, suffix, value header, value) of the item at index. */
+    [[nodiscard]] auto cell_position(uint32_t index) const noexcept -> uint32_t;
+
+    /** The position of the value header of the item at index, after its key. */
+    [[nodiscard]] auto value_position(uint32_t index) const noexcept -> uint32_t;
   };
 } // namespace toocal::core::node
 
@@ -197,15 +326,58 @@ namespace toocal::core::types
       serialize(const Node& self, const uint32_t buffer_size = Page::DEFAULT_PAGE_SIZE) noexcept
       -> tl::expected<std::vector<uint8_t>, Error>
     {
-      const auto is_leaf = self.is_leaf();
-      const auto items_count = static_cast<uint16_t>(self.items.size());
-
       auto buffer = std::vector<uint8_t>(buffer_size);
+      return serialize(self, buffer).map([&](const auto&& _) { return std::move(buffer); });
+    }
 
-      /* serialize header (is_leaf, items_count) */
+    /** Serialize a node into buffer, which must be zeroed. */
+    [[nodiscard]] static auto serialize(const Node& self, const std::span<uint8_t> buffer) noexcept
+      -> tl::expected<std::nullptr_t, Error>
+    {
+      return serialize(self.items, self.prefix_size(), self.children, self.prev, self.next, self.page_num, buffer);
+    }
+
+    /** Serialize a leaf made of items into buffer, which must be zeroed. */
+    [[nodiscard]] static auto serialize(
+      std::span<const node::Item_view> items,
+      const page::Page_num             prev,
+      const page::Page_num             next,
+      const page::Page_num             page_num,
+      const std::span<uint8_t>         buffer) noexcept -> tl::expected<std::nullptr_t, Error>
+    {
+      return serialize(items, Node::prefix_size(items), std::span<const page::Page_num>{}, prev, next, page_num, buffer);
+    }
+
+  private:
+    /** The items are Items or Item_views, the children are empty for a
+     ** leaf. */
+    template <typename Tp_items, typename Tp_children>
+    [[nodiscard]] static auto serialize(
+      const Tp_items&          items,
+      const uint32_t           prefix_size,
+      const Tp_children&       children,
+      const page::Page_num     prev,
+      const page::Page_num     next,
+      const page::Page_num     page_num,
+      const std::span<uint8_t> buffer) noexcept -> tl::expected<std::nullptr_t, Error>
+    {
+      const auto is_leaf = children.empty();
+      const auto items_count = static_cast<uint16_t>(items.size());
+      const auto buffer_size = buffer.size();
+
+      const auto fingerprints_size = items_count * sizeof(Node::Fingerprint);
+      if (Node::HEADER_SIZE + prefix_size + fingerprints_size > buffer_size)
+        return Err(fmt::format("node {} does not fit in a page of {} bytes", page_num, buffer_size));
+
+      /* serialize header (is_leaf, items_count, prev, next, prefix size) and
+       * the prefix shared by all the keys, which the cells leave out. */
       {
         endian::stream_writer<endian::little_endian>(buffer.data(), buffer.size())
-          << static_cast<uint8_t>(is_leaf ? 1 : 0) << items_count;
+          << static_cast<uint8_t>(is_leaf ? 1 : 0) << items_count << prev << next
+          << static_cast<uint16_t>(prefix_size);
+
+        if (prefix_size > 0)
+          std::copy_n(items.front().key.begin(), prefix_size, buffer.begin() + Node::HEADER_SIZE);
       }
 
       /* We use slotted pages for storing data in the page. It means the actual
@@ -220,135 +392,95 @@ namespace toocal::core::types
        * |  Page  | key-value /  child node    key-value        | key-value |
        * | Header |   offset /	 pointer	      offset     ...  | data ...  |
        * --------------------------------------------------------------------
+       *
+       * The header is followed by the prefix, then by the fingerprint of
+       * every key, see Node::fingerprint, and the offsets start after them. A
+       * cell is the size of the key without the prefix as a varint, the rest
+       * of the key, the value header as a varint, then the value. The value
+       * header is the size of the value shifted left by one, with the low bit
+       * set when the value is in an overflow chain, in which case the cell
+       * holds the first page of the chain instead of the value.
        */
-      uint32_t left = 3, right = buffer.size() - 1;
+      uint32_t   left = Node::HEADER_SIZE + prefix_size + fingerprints_size, right = buffer.size();
+      const auto child_size = is_leaf ? 0 : sizeof(page::Page_num);
 
       for (int i = 0; i < items_count; i++)
         {
-          const auto [key, value] = self.items[i];
+          const auto& item = items[i];
+          const auto  cell_size = item.cell_size(prefix_size);
+
+          endian::big_endian::put(
+            Node::fingerprint(std::span{item.key}.subspan(prefix_size)),
+            buffer.data() + Node::HEADER_SIZE + prefix_size + i * sizeof(Node::Fingerprint));
+
+          /* Keep room for the last child. */
+          if (left + child_size + sizeof(uint16_t) + cell_size + child_size > right)
+            return Err(fmt::format("node {} does not fit in a page of {} bytes", page_num, buffer_size));
 
           /* Write the child page as a fixed size of 8 bytes */
           if (!is_leaf)
             {
-              const auto span = std::span(buffer.begin() + left, buffer.end());
-              endian::stream_writer<endian::little_endian>(span.data(), span.size())
-                << self.children[i];
-
+              endian::little_endian::put(children[i], buffer.data() + left);
               left += sizeof(page::Page_num);
             }
 
-          const auto key_size = static_cast<uint8_t>(key.size()),
-                     value_size = static_cast<uint8_t>(value.size());
+          right -= cell_size;
 
           /* write offset */
-          {
-            const uint16_t offset = right - key_size - value_size - sizeof(uint16_t);
-            const auto     span = std::span(buffer.begin() + left, buffer.end());
-            endian::stream_writer<endian::little_endian>(span.data(), span.size()) << offset;
-
-            left += sizeof(uint16_t);
-          }
-
-          {
-            right -= value_size;
-            const auto span = std::span(buffer.begin() + right, buffer.end());
-            endian::stream_writer<endian::little_endian>(span.data(), span.size())
-              .write(value.data(), value_size);
-
-            buffer[--right] = static_cast<uint8_t>(value_size);
-          }
-
-          {
-            right -= key_size;
-            const auto span = std::span(buffer.begin() + right, buffer.end());
-            endian::stream_writer<endian::little_endian>(span.data(), span.size())
-              .write(key.data(), key_size);
-
-            buffer[--right] = static_cast<uint8_t>(key_size);
-          }
+          endian::little_endian::put(static_cast<uint16_t>(right), buffer.data() + left);
+          left += sizeof(uint16_t);
+
+          auto position = right;
+          position += utils::Varint::put(item.key.size() - prefix_size, buffer.data() + position);
+          std::copy(item.key.begin() + prefix_size, item.key.end(), buffer.begin() + position);
+          position += item.key.size() - prefix_size;
+
+          if (item.is_overflow())
+            {
+              position += utils::Varint::put(
+                static_cast<uint64_t>(item.overflow_size) << 1 | 1, buffer.data() + position);
+              endian::little_endian::put(item.overflow, buffer.data() + position);
+            }
+          else
+            {
+              position += utils::Varint::put(
+                static_cast<uint64_t>(item.value.size()) << 1, buffer.data() + position);
+              std::copy(item.value.begin(), item.value.end(), buffer.begin() + position);
+            }
         }
 
       /* Write the last child node; */
       if (!is_leaf)
-        {
-          const auto span = std::span(buffer.begin() + left, buffer.end());
-          endian::stream_writer<endian::little_endian>(span.data(), span.size())
-            << self.children.back();
-        }
+        endian::little_endian::put(children.back(), buffer.data() + left);
 
-      return buffer;
+      return nullptr;
     }
 
-    [[nodiscard]] static auto deserialize(const std::vector<uint8_t>& buffer) noexcept
+  public:
+
+    [[nodiscard]] static auto deserialize(const std::span<const uint8_t> buffer) noexcept
       -> tl::expected<Node, Error>
     {
-      uint8_t  is_leaf;
-      uint16_t items_count;
-
-      {
-        endian::stream_reader<endian::little_endian>(buffer.data(), buffer.size()) >> is_leaf
-          >> items_count;
-      }
+      const auto view = node::Node_view{buffer};
+      const auto is_leaf = view.is_leaf();
+      const auto items_count = view.items_count();
 
-      auto     children = std::deque<page::Page_num>{};
-      auto     items = std::deque<node::Item>{items_count};
-      uint32_t left = 3;
+      /* The node is built in place, moving its deques allocates. */
+      auto node = tl::expected<Node, Error>{};
       for (uint32_t i = 0; i < items_count; i++)
         {
-          if (0 == is_leaf)
-            {
-              const auto     span = std::span(buffer.begin() + left, buffer.end());
-              page::Page_num page_num;
-
-              endian::stream_reader<endian::little_endian>(span.data(), span.size()) >> page_num;
-              children.push_back(page_num);
-              left += sizeof(page::Page_num);
-            }
+          if (!is_leaf)
+            node->children.push_back(view.child(i));
 
-          uint16_t offset;
-          {
-            const auto span = std::span(buffer.begin() + left, buffer.end());
-            endian::stream_reader<endian::little_endian>(span.data(), span.size()) >> offset;
-            left += sizeof(uint16_t);
-          }
-
-          const uint8_t key_size = buffer[offset];
-          offset += 1;
-
-          items[i].key = std::vector<uint8_t>(key_size);
-          {
-            const auto span =
-              std::span(buffer.begin() + offset, buffer.begin() + offset + key_size);
-            endian::stream_reader<endian::little_endian>(span.data(), span.size())
-              .read(items[i].key.data(), key_size);
-
-            offset += key_size;
-          }
-
-          const uint8_t value_size = buffer[offset];
-          offset += 1;
-
-          items[i].value = std::vector<uint8_t>(value_size);
-          {
-            const auto span =
-              std::span(buffer.begin() + offset, buffer.begin() + offset + value_size);
-            endian::stream_reader<endian::little_endian>(span.data(), span.size())
-              .read(items[i].value.data(), value_size);
-
-            offset += value_size;
-          }
+          node->items.push_back(view.item(i));
         }
 
-      if (0 == is_leaf)
-        {
-          const auto     span = std::span(buffer.begin() + left, buffer.end());
-          page::Page_num page_num;
-
-          endian::stream_reader<endian::little_endian>(span.data(), span.size()) >> page_num;
-          children.push_back(page_num);
-        }
+      if (!is_leaf)
+        node->children.push_back(view.child(items_count));
 
-      return Node{items, children};
+      node->prev = view.prev();
+      node->next = view.next();
+      return node;
     }
   };
 } // namespace toocal::core::types
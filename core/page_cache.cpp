@@ -0,0 +1,175 @@
+#include "page_cache.h"
+#include <algorithm>
+#include <vector>
+
+namespace toocal::core::page_cache
+{
+  [[nodiscard]] auto Statistics::hit_ratio() const noexcept -> double
+  {
+    const auto total = this->hits + this->misses;
+    return total == 0 ? 0.0 : static_cast<double>(this->hits) / static_cast<double>(total);
+  }
+
+  [[nodiscard]] auto Page_cache::enabled() const noexcept -> bool { return this->capacity != 0; }
+
+  [[nodiscard]] auto Page_cache::get(const page::Page_num page_num) noexcept -> Page *
+  {
+    const auto frame = this->frames.find(page_num);
+    if (frame == this->frames.end())
+      {
+        this->statistics.misses++;
+        return nullptr;
+      }
+
+    this->statistics.hits++;
+    if (0 == frame->second.pin_count)
+      this->lru.splice(this->lru.begin(), this->lru, frame->second.lru);
+    return &frame->second.page;
+  }
+
+  [[nodiscard]] auto Page_cache::contains(const page::Page_num page_num) const noexcept -> bool
+  {
+    return this->frames.contains(page_num);
+  }
+
+  [[nodiscard]] auto Page_cache::find(const page::Page_num page_num) noexcept -> Frame *
+  {
+    const auto frame = this->frames.find(page_num);
+    return frame == this->frames.end() ? nullptr : &frame->second;
+  }
+
+  [[nodiscard]] auto Page_cache::put(Page page, const bool dirty) noexcept
+    -> tl::expected<Page *, Error>
+  {
+    if (const auto frame = this->frames.find(page.page_num); frame != this->frames.end())
+      {
+        frame->second.page = std::move(page);
+        frame->second.dirty = frame->second.dirty || dirty;
+        if (0 == frame->second.pin_count)
+          this->lru.splice(this->lru.begin(), this->lru, frame->second.lru);
+        return &frame->second.page;
+      }
+
+    return this->make_room().map([&](const auto &&_) {
+      const auto page_num = page.page_num;
+      this->lru.push_front(page_num);
+
+      auto &frame = this->frames[page_num];
+      frame = Frame{std::move(page), 0, dirty, this->lru.begin()};
+      return &frame.page;
+    });
+  }
+
+  auto Page_cache::pin(const page::Page_num page_num) noexcept -> bool
+  {
+    const auto frame = this->frames.find(page_num);
+    if (frame == this->frames.end())
+      return false;
+
+    if (0 == frame->second.pin_count++)
+      this->pinned.splice(this->pinned.begin(), this->lru, frame->second.lru);
+    return true;
+  }
+
+  auto Page_cache::unpin(const page::Page_num page_num) noexcept -> void
+  {
+    if (const auto frame = this->frames.find(page_num);
+        frame != this->frames.end() && frame->second.pin_count > 0)
+      if (0 == --frame->second.pin_count)
+        this->lru.splice(this->lru.begin(), this->pinned, frame->second.lru);
+  }
+
+  auto Page_cache::mark_dirty(const page::Page_num page_num) noexcept -> void
+  {
+    if (const auto frame = this->frames.find(page_num); frame != this->frames.end())
+      frame->second.dirty = true;
+  }
+
+  auto Page_cache::invalidate(const page::Page_num page_num) noexcept -> void
+  {
+    if (const auto frame = this->frames.find(page_num); frame != this->frames.end())
+      {
+        (0 == frame->second.pin_count ? this->lru : this->pinned).erase(frame->second.lru);
+        this->frames.erase(frame);
+      }
+  }
+
+  [[nodiscard]] auto Page_cache::flush() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    auto dirty_frames = std::vector<Frame *>{};
+    for (auto &[_, frame] : this->frames)
+      if (frame.dirty)
+        dirty_frames.push_back(&frame);
+
+    /* Write back in page order so the file is written as sequentially as possible. */
+    std::ranges::sort(dirty_frames, [](const auto *a, const auto *b) {
+      return a->page.page_num < b->page.page_num;
+    });
+
+    if (this->write_back_batch != nullptr && !dirty_frames.empty())
+      {
+        auto pages = std::vector<const Page *>{};
+        pages.reserve(dirty_frames.size());
+        for (const auto *frame : dirty_frames)
+          pages.push_back(&frame->page);
+
+        if (auto result = this->write_back_batch(pages); !result.has_value())
+          return tl::make_unexpected(result.error());
+
+        for (auto *frame : dirty_frames)
+          frame->dirty = false;
+        this->statistics.write_backs += dirty_frames.size();
+        return nullptr;
+      }
+
+    for (auto *frame : dirty_frames)
+      {
+        if (auto result = this->write_back(frame->page); !result.has_value())
+          return tl::make_unexpected(result.error());
+
+        frame->dirty = false;
+        this->statistics.write_backs++;
+      }
+
+    return nullptr;
+  }
+
+  [[nodiscard]] auto Page_cache::size() const noexcept -> size_t { return this->frames.size(); }
+
+  [[nodiscard]] auto Page_cache::dirty_pages() const noexcept -> size_t
+  {
+    return std::ranges::count_if(this->frames, [](const auto &frame) {
+      return frame.second.dirty;
+    });
+  }
+
+  [[nodiscard]] auto Page_cache::get_statistics() const noexcept -> const Statistics &
+  {
+    return this->statistics;
+  }
+
+  auto Page_cache::reset_statistics() noexcept -> void { this->statistics = Statistics{}; }
+
+  [[nodiscard]] auto Page_cache::make_room() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    auto victim = this->lru.end();
+    while (this->frames.size() >= this->capacity && victim != this->lru.begin())
+      {
+        --victim;
+
+        auto &frame = this->frames.at(*victim);
+        if (frame.dirty)
+          {
+            if (auto result = this->write_back(frame.page); !result.has_value())
+              return tl::make_unexpected(result.error());
+            this->statistics.write_backs++;
+          }
+
+        this->frames.erase(*victim);
+        victim = this->lru.erase(victim);
+        this->statistics.evictions++;
+      }
+
+    return nullptr;
+  }
+} // namespace toocal::core::page_cache
@@ -0,0 +1,116 @@
+#ifndef TOOCAL_CORE_PAGE_CACHE_H
+#define TOOCAL_CORE_PAGE_CACHE_H
+
+#include "errors.hpp"
+#include "page.h"
+#include "tl/expected.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <span>
+#include <unordered_map>
+
+namespace toocal::core::page_cache
+{
+  using errors::Error;
+  using page::Page;
+
+  /** Counters used to size the page cache in production. */
+  class Statistics
+  {
+  public:
+    uint64_t hits{};
+    uint64_t misses{};
+    uint64_t evictions{};
+    uint64_t write_backs{};
+
+    [[nodiscard]] auto hit_ratio() const noexcept -> double;
+  };
+
+  /** Page_cache is a bounded buffer pool keyed by page number that sits in
+   ** front of the database file. Pages are evicted in LRU order, pinned pages
+   ** are never evicted, and dirty pages are written back through write_back
+   ** before they leave the cache. */
+  class Page_cache
+  {
+  public:
+    using Write_back = std::function<auto(const Page &)->tl::expected<std::nullptr_t, Error>>;
+
+    /** Writes back several pages at once, in page number order. */
+    using Write_back_batch =
+      std::function<auto(std::span<const Page *const>)->tl::expected<std::nullptr_t, Error>>;
+
+    class Frame
+    {
+    public:
+      Page                                 page;
+      uint32_t                             pin_count{};
+      bool                                 dirty{};
+      std::list<page::Page_num>::iterator lru;
+    };
+
+  private:
+    uint32_t                                    capacity;
+    Write_back                                  write_back;
+    Write_back_batch                            write_back_batch;
+    std::unordered_map<page::Page_num, Frame> frames;
+
+    /** The most recently used page is at the front. A pinned page is moved
+     ** to pinned until it is unpinned, so eviction never walks past it. */
+    std::list<page::Page_num> lru;
+    std::list<page::Page_num> pinned;
+    Statistics                statistics;
+
+  public:
+    /** flush hands all the dirty pages to write_back_batch if it is set,
+     ** instead of calling write_back for each of them. */
+    Page_cache(const uint32_t capacity, Write_back write_back, Write_back_batch write_back_batch = nullptr)
+      : capacity(capacity)
+      , write_back(std::move(write_back))
+      , write_back_batch(std::move(write_back_batch))
+    {}
+
+    /** A cache with zero capacity is disabled, all accesses go to the file. */
+    [[nodiscard]] auto enabled() const noexcept -> bool;
+
+    /** Returns the cached page and marks it as the most recently used one, or
+     ** nullptr if the page is not resident. Counts a hit or a miss. */
+    [[nodiscard]] auto get(page::Page_num page_num) noexcept -> Page *;
+
+    /** Whether the page is resident, without touching it or the statistics. */
+    [[nodiscard]] auto contains(page::Page_num page_num) const noexcept -> bool;
+
+    /** The frame of a resident page like contains, or nullptr. */
+    [[nodiscard]] auto find(page::Page_num page_num) noexcept -> Frame *;
+
+    /** Inserts or replaces a page. If the cache is full, the least recently
+     ** used unpinned page is evicted first, writing it back if it is dirty. */
+    [[nodiscard]] auto put(Page page, bool dirty) noexcept -> tl::expected<Page *, Error>;
+
+    /** Pinned pages stay resident until every pin is released with unpin.
+     ** Returns false if the page is not resident. */
+    auto pin(page::Page_num page_num) noexcept -> bool;
+    auto unpin(page::Page_num page_num) noexcept -> void;
+
+    auto mark_dirty(page::Page_num page_num) noexcept -> void;
+
+    /** Drops a page without writing it back, e.g. after it has been released. */
+    auto invalidate(page::Page_num page_num) noexcept -> void;
+
+    /** Writes back every dirty page in page number order. */
+    [[nodiscard]] auto flush() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    [[nodiscard]] auto size() const noexcept -> size_t;
+    [[nodiscard]] auto dirty_pages() const noexcept -> size_t;
+    [[nodiscard]] auto get_statistics() const noexcept -> const Statistics &;
+    auto               reset_statistics() noexcept -> void;
+
+  private:
+    /** Evicts unpinned pages until there is room for one more page. If every
+     ** page is pinned the cache temporarily grows beyond its capacity. */
+    [[nodiscard]] auto make_room() noexcept -> tl::expected<std::nullptr_t, Error>;
+  };
+} // namespace toocal::core::page_cache
+
+#endif /* TOOCAL_CORE_PAGE_CACHE_H */
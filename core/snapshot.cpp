@@ -0,0 +1,135 @@
+#include "snapshot.h"
+#include "collection.h"
+#include "data_access_layer.h"
+#include <algorithm>
+
+namespace toocal::core::snapshot
+{
+  Snapshot::Snapshot(const collection::Collection &collection)
+    : dal(collection.dal), root(collection.root), epoch(collection.dal->acquire_epoch())
+  {
+    if (!this->dal->options.copy_on_write)
+      fatal(fmt::format("snapshots of {} require Options::copy_on_write", this->dal->path));
+
+    if (this->dal->transaction != nullptr)
+      fatal(fmt::format("a snapshot cannot be taken during a transaction on {}", this->dal->path));
+  }
+
+  Snapshot::~Snapshot() { this->dal->release_epoch(this->epoch); }
+
+  [[nodiscard]] auto Snapshot::find(const std::span<const uint8_t> key) const noexcept
+    -> tl::expected<tl::optional<node::Item>, Error>
+  {
+    for (auto page_num = this->root; 0 != page_num;)
+      {
+        const auto page = this->dal->read_committed_page(page_num);
+        if (!page.has_value())
+          return tl::make_unexpected(page.error());
+
+        const auto node = node::Node_view{page->data};
+        const auto [was_found, index] = node.find_key_in_node(key);
+
+        if (!node.is_leaf())
+          {
+            page_num = node.child(node::Node::child_index(was_found, index));
+            continue;
+          }
+
+        if (!was_found)
+          return tl::nullopt;
+
+        auto item = node.item(index);
+        return this->load_value(item).map(
+          [&](const auto &&_) { return tl::optional<node::Item>{std::move(item)}; });
+      }
+
+    return tl::nullopt;
+  }
+
+  [[nodiscard]] auto Snapshot::scan(
+    const std::span<const uint8_t> from, const std::function<bool(const node::Item &)> &visit) const noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (0 == this->root)
+      return nullptr;
+
+    return this->scan(this->root, from, visit).map([](const auto &&_) { return nullptr; });
+  }
+
+  [[nodiscard]] auto Snapshot::scan(
+    const page::Page_num                           page_num,
+    const tl::optional<std::span<const uint8_t>>   from,
+    const std::function<bool(const node::Item &)> &visit) const noexcept -> tl::expected<bool, Error>
+  {
+    const auto page = this->dal->read_committed_page(page_num);
+    if (!page.has_value())
+      return tl::make_unexpected(page.error());
+
+    const auto node = node::Node_view{page->data};
+
+    /* The subtrees and items before the position of from are skipped. The
+     * leaf links are not followed, the tree of the snapshot is walked down
+     * from its own root. */
+    const auto [was_found, first] =
+      from.has_value() ? node.find_key_in_node(from.value()) : std::pair{false, uint32_t{0}};
+
+    if (!node.is_leaf())
+      {
+        for (auto index = from.has_value() ? node::Node::child_index(was_found, first) : 0;
+             index <= node.items_count();
+             index++)
+          {
+            const auto result = this->scan(node.child(index), index == first ? from : tl::nullopt, visit);
+            if (!result.has_value() || !result.value())
+              return result;
+          }
+
+        return true;
+      }
+
+    for (auto index = first; index < node.items_count(); index++)
+      {
+        auto item = node.item(index);
+        if (auto result = this->load_value(item); !result.has_value())
+          return tl::make_unexpected(result.error());
+
+        if (!visit(item))
+          return false;
+      }
+
+    return true;
+  }
+
+  [[nodiscard]] auto Snapshot::load_value(node::Item &item) const noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (!item.is_overflow())
+      return nullptr;
+
+    /* Like Data_access_layer::read_overflow, with read_committed_page. */
+    auto value = std::vector<uint8_t>{};
+    value.reserve(item.overflow_size);
+
+    for (auto page_num = item.overflow; value.size() < item.overflow_size;)
+      {
+        if (0 == page_num)
+          return Err(fmt::format(
+            "the overflow chain of {} bytes ends after {}", item.overflow_size, value.size()));
+
+        const auto page = this->dal->read_committed_page(page_num);
+        if (!page.has_value())
+          return tl::make_unexpected(page.error());
+
+        const auto data = std::span{page->data}.subspan(sizeof(page::Page_num));
+        const auto size = std::min<size_t>(data.size(), item.overflow_size - value.size());
+
+        value.insert(value.end(), data.begin(), data.begin() + size);
+        page_num = endian::little_endian::get<page::Page_num>(page->data.data());
+      }
+
+    item.value = std::move(value);
+    item.overflow = 0;
+    item.overflow_size = 0;
+    return nullptr;
+  }
+} // namespace toocal::core::snapshot
@@ -0,0 +1,79 @@
+#ifndef TOOCAL_CORE_SNAPSHOT_H
+#define TOOCAL_CORE_SNAPSHOT_H
+
+#include "errors.hpp"
+#include "node.h"
+#include "page.h"
+#include "tl/expected.hpp"
+#include "tl/optional.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+namespace toocal::core::data_access_layer
+{
+  class Data_access_layer;
+}
+
+namespace toocal::core::collection
+{
+  class Collection;
+}
+
+namespace toocal::core::snapshot
+{
+  using errors::Error;
+
+  /** Snapshot reads a collection as it was committed when the snapshot was
+   ** taken. It requires Options::copy_on_write: the nodes of the tree it
+   ** reads are never overwritten, and the pages released afterwards are only
+   ** reused once the snapshot is destroyed.
+   **
+   ** A snapshot is taken outside of a transaction, on the thread writing the
+   ** collection, and can then be read from any number of threads while the
+   ** writer goes on. Its pages are read with
+   ** Data_access_layer::read_committed_page, which does not touch the page
+   ** cache nor the active transaction. */
+  class Snapshot
+  {
+  public:
+    data_access_layer::Data_access_layer *dal;
+    const page::Page_num                  root;
+
+    /** The epoch registered with Data_access_layer::acquire_epoch. */
+    const uint64_t epoch;
+
+    explicit Snapshot(const collection::Collection &collection);
+    ~Snapshot();
+
+    /* The epoch is released once. */
+    Snapshot(const Snapshot &) = delete;
+    Snapshot(Snapshot &&) = delete;
+
+    /** Like Collection::find, in the tree of the snapshot. */
+    [[nodiscard]] auto find(std::span<const uint8_t> key) const noexcept
+      -> tl::expected<tl::optional<node::Item>, Error>;
+
+    /** Call visit with the items from the first key greater than or equal to
+     ** from, in key order, until visit returns false. The values are read
+     ** from their overflow chains. */
+    [[nodiscard]] auto scan(
+      std::span<const uint8_t> from, const std::function<bool(const node::Item &)> &visit) const noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+  private:
+    /** Scan the subtree of page_num, from from if it is set. Returns whether
+     ** visit asked to go on. */
+    [[nodiscard]] auto scan(
+      page::Page_num                                page_num,
+      tl::optional<std::span<const uint8_t>>        from,
+      const std::function<bool(const node::Item &)> &visit) const noexcept -> tl::expected<bool, Error>;
+
+    /** Read the value of item from its overflow chain, if it has one. */
+    [[nodiscard]] auto load_value(node::Item &item) const noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+  };
+} // namespace toocal::core::snapshot
+
+#endif /* TOOCAL_CORE_SNAPSHOT_H */
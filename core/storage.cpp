@@ -0,0 +1,577 @@
+#include "storage.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define TOOCAL_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+namespace toocal::core::storage
+{
+  [[nodiscard]] auto Storage::view(page::Page_num) noexcept
+    -> tl::expected<tl::optional<std::span<const uint8_t>>, Error>
+  {
+    return tl::nullopt;
+  }
+
+  [[nodiscard]] auto Storage::read_batch(std::span<const Read_request> requests) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    for (const auto &request : requests)
+      if (auto result = this->read(request.page_num, request.buffer); !result.has_value())
+        return result;
+    return nullptr;
+  }
+
+  [[nodiscard]] auto Storage::write_batch(std::span<const Write_request> requests) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    for (const auto &request : requests)
+      if (auto result = this->write(request.page_num, request.buffer); !result.has_value())
+        return result;
+    return nullptr;
+  }
+
+  auto Storage::prefetch(page::Page_num, uint32_t) noexcept -> void {}
+
+  [[nodiscard]] auto Storage::is_thread_safe() const noexcept -> bool { return false; }
+
+  [[nodiscard]] auto Storage::is_batched() const noexcept -> bool { return false; }
+
+  File_storage::File_storage(std::string path, const uint32_t page_size)
+    : Storage(std::move(path), page_size)
+  {
+#ifdef __unix__
+    this->fd = ::open(this->path.c_str(), O_RDWR | O_CLOEXEC);
+    if (this->fd < 0)
+      fatal(fmt::format("unable to open {}: {}", this->path, std::strerror(errno)));
+#else
+    unimplemented();
+#endif
+  }
+
+  [[nodiscard]] auto File_storage::read(page::Page_num page_num, std::span<uint8_t> buffer) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+#ifdef __unix__
+    const auto offset = static_cast<off_t>(page_num) * this->page_size;
+
+    for (size_t read = 0; read < buffer.size();)
+      {
+        const auto count = ::pread(
+          this->fd, buffer.data() + read, buffer.size() - read, offset + static_cast<off_t>(read));
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count < 0)
+          return Err(std::strerror(errno));
+        if (count == 0)
+          return Err(fmt::format("page {} is beyond the end of {}", page_num, this->path));
+        read += static_cast<size_t>(count);
+      }
+#endif
+    return nullptr;
+  }
+
+  [[nodiscard]] auto
+    File_storage::write(page::Page_num page_num, std::span<const uint8_t> buffer) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+#ifdef __unix__
+    const auto offset = static_cast<off_t>(page_num) * this->page_size;
+
+    for (size_t written = 0; written < buffer.size();)
+      {
+        const auto count = ::pwrite(
+          this->fd,
+          buffer.data() + written,
+          buffer.size() - written,
+          offset + static_cast<off_t>(written));
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count < 0)
+          return Err(std::strerror(errno));
+        written += static_cast<size_t>(count);
+      }
+#endif
+    return nullptr;
+  }
+
+  auto File_storage::prefetch(const page::Page_num page_num, const uint32_t count) noexcept -> void
+  {
+#ifdef __unix__
+    posix_fadvise(
+      this->fd,
+      static_cast<off_t>(page_num) * this->page_size,
+      static_cast<off_t>(count) * this->page_size,
+      POSIX_FADV_WILLNEED);
+#endif
+  }
+
+  [[nodiscard]] auto File_storage::flush() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    /* pwrite hands the pages over to the operating system right away. */
+    return nullptr;
+  }
+
+  [[nodiscard]] auto File_storage::sync() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+#ifdef __unix__
+    if (0 > fsync(this->fd))
+      return Err(std::strerror(errno));
+#endif
+    return nullptr;
+  }
+
+  [[nodiscard]] auto File_storage::truncate(const page::Page_num page_count) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+#ifdef __unix__
+    if (0 > ftruncate(this->fd, static_cast<off_t>(page_count) * this->page_size))
+      return Err(std::strerror(errno));
+#endif
+    return nullptr;
+  }
+
+  auto File_storage::close() noexcept -> void
+  {
+#ifdef __unix__
+    if (this->fd >= 0)
+      ::close(this->fd);
+    this->fd = -1;
+#endif
+  }
+
+  [[nodiscard]] auto File_storage::is_open() const noexcept -> bool { return this->fd >= 0; }
+
+  [[nodiscard]] auto File_storage::is_thread_safe() const noexcept -> bool { return true; }
+
+#ifdef TOOCAL_IO_URING
+  /* There is no liburing in the dependencies, the queues are set up and
+   * entered with the system calls directly. */
+  class Uring_storage::Ring
+  {
+  public:
+    int      fd = -1;
+    uint32_t entries = 0;
+
+    void  *sq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    void  *cq_ring = MAP_FAILED;
+    size_t cq_ring_size = 0;
+
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t        sqes_size = 0;
+
+    uint32_t     *sq_tail = nullptr, *sq_mask = nullptr, *sq_array = nullptr;
+    uint32_t     *cq_head = nullptr, *cq_tail = nullptr, *cq_mask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    explicit Ring(const uint32_t depth)
+    {
+      auto params = io_uring_params{};
+      this->fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+      if (this->fd < 0)
+        return;
+
+      this->entries = params.sq_entries;
+      this->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+      this->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      if (params.features & IORING_FEAT_SINGLE_MMAP)
+        this->sq_ring_size = this->cq_ring_size = std::max(this->sq_ring_size, this->cq_ring_size);
+
+      this->sq_ring = mmap(
+        nullptr,
+        this->sq_ring_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        this->fd,
+        IORING_OFF_SQ_RING);
+      if (this->sq_ring == MAP_FAILED)
+        return;
+
+      if (params.features & IORING_FEAT_SINGLE_MMAP)
+        this->cq_ring = this->sq_ring;
+      else
+        this->cq_ring = mmap(
+          nullptr,
+          this->cq_ring_size,
+          PROT_READ | PROT_WRITE,
+          MAP_SHARED | MAP_POPULATE,
+          this->fd,
+          IORING_OFF_CQ_RING);
+      if (this->cq_ring == MAP_FAILED)
+        return;
+
+      this->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+      this->sqes = static_cast<io_uring_sqe *>(mmap(
+        nullptr,
+        this->sqes_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        this->fd,
+        IORING_OFF_SQES));
+      if (this->sqes == MAP_FAILED)
+        return;
+
+      const auto field = [](void *ring, const uint32_t offset) {
+        return reinterpret_cast<uint32_t *>(static_cast<uint8_t *>(ring) + offset);
+      };
+
+      this->sq_tail = field(this->sq_ring, params.sq_off.tail);
+      this->sq_mask = field(this->sq_ring, params.sq_off.ring_mask);
+      this->sq_array = field(this->sq_ring, params.sq_off.array);
+      this->cq_head = field(this->cq_ring, params.cq_off.head);
+      this->cq_tail = field(this->cq_ring, params.cq_off.tail);
+      this->cq_mask = field(this->cq_ring, params.cq_off.ring_mask);
+      this->cqes = reinterpret_cast<io_uring_cqe *>(field(this->cq_ring, params.cq_off.cqes));
+    }
+
+    ~Ring()
+    {
+      if (this->sqes != MAP_FAILED)
+        munmap(this->sqes, this->sqes_size);
+      if (this->cq_ring != MAP_FAILED && this->cq_ring != this->sq_ring)
+        munmap(this->cq_ring, this->cq_ring_size);
+      if (this->sq_ring != MAP_FAILED)
+        munmap(this->sq_ring, this->sq_ring_size);
+      if (this->fd >= 0)
+        ::close(this->fd);
+    }
+
+    [[nodiscard]] auto is_ready() const noexcept -> bool { return this->cqes != nullptr; }
+
+    [[nodiscard]] auto enter(const uint32_t to_submit, const uint32_t min_complete) const noexcept
+      -> int
+    {
+      return static_cast<int>(syscall(
+        __NR_io_uring_enter, this->fd, to_submit, min_complete, IORING_ENTER_GETEVENTS, nullptr, 0));
+    }
+  };
+#else
+  class Uring_storage::Ring
+  {
+  public:
+    uint32_t entries = 0;
+
+    [[nodiscard]] auto is_ready() const noexcept -> bool { return false; }
+  };
+#endif
+
+  Uring_storage::Uring_storage(std::string path, const uint32_t page_size)
+    : File_storage(std::move(path), page_size)
+#ifdef TOOCAL_IO_URING
+    , ring(std::make_unique<Ring>(QUEUE_DEPTH))
+#else
+    , ring(std::make_unique<Ring>())
+#endif
+  {
+    if (!this->ring->is_ready())
+      {
+        spdlog::warn(
+          "io_uring is unavailable for {} ({}), falling back to pread and pwrite",
+          this->path,
+          std::strerror(errno));
+        this->ring.reset();
+      }
+  }
+
+  Uring_storage::~Uring_storage() { this->close(); }
+
+  [[nodiscard]] auto Uring_storage::read_batch(std::span<const Read_request> requests) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (this->ring == nullptr)
+      return File_storage::read_batch(requests);
+
+    const auto lock = std::lock_guard{this->ring_mutex};
+    for (size_t first = 0; first < requests.size(); first += this->ring->entries)
+      if (auto result = this->submit(
+            requests.subspan(first, std::min<size_t>(this->ring->entries, requests.size() - first)));
+          !result.has_value())
+        return result;
+    return nullptr;
+  }
+
+  [[nodiscard]] auto Uring_storage::write_batch(std::span<const Write_request> requests) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    if (this->ring == nullptr)
+      return File_storage::write_batch(requests);
+
+    const auto lock = std::lock_guard{this->ring_mutex};
+    for (size_t first = 0; first < requests.size(); first += this->ring->entries)
+      if (auto result = this->submit(
+            requests.subspan(first, std::min<size_t>(this->ring->entries, requests.size() - first)));
+          !result.has_value())
+        return result;
+    return nullptr;
+  }
+
+  template <typename Request>
+  [[nodiscard]] auto Uring_storage::submit(std::span<const Request> requests) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+#ifdef TOOCAL_IO_URING
+    constexpr auto is_write = std::is_same_v<Request, Write_request>;
+    auto &ring = *this->ring;
+
+    /* Only this thread moves the tail of the submission queue, the kernel
+     * reads it once it is released. */
+    auto tail = *ring.sq_tail;
+    for (size_t index = 0; index < requests.size(); index++, tail++)
+      {
+        const auto slot = tail & *ring.sq_mask;
+        auto      &sqe = ring.sqes[slot];
+
+        sqe = io_uring_sqe{};
+        sqe.opcode = is_write ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe.fd = this->fd;
+        sqe.addr = reinterpret_cast<uint64_t>(requests[index].buffer.data());
+        sqe.len = static_cast<uint32_t>(requests[index].buffer.size());
+        sqe.off = requests[index].page_num * this->page_size;
+        sqe.user_data = index;
+        ring.sq_array[slot] = slot;
+      }
+    __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+    /* Submit everything and reap the completions, a request that did not
+     * complete in full is retried synchronously afterwards. */
+    auto failed = std::vector<size_t>{};
+    auto submitted = uint32_t{0}, completed = uint32_t{0};
+    const auto count = static_cast<uint32_t>(requests.size());
+
+    while (completed < count)
+      {
+        const auto result = ring.enter(count - submitted, 1);
+        if (result < 0 && errno != EINTR)
+          return Err(fmt::format("io_uring_enter on {}: {}", this->path, std::strerror(errno)));
+        if (result > 0)
+          submitted += static_cast<uint32_t>(result);
+
+        auto head = *ring.cq_head;
+        for (; head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE); head++, completed++)
+          {
+            const auto &cqe = ring.cqes[head & *ring.cq_mask];
+            if (cqe.res < 0 || static_cast<size_t>(cqe.res) != requests[cqe.user_data].buffer.size())
+              failed.push_back(cqe.user_data);
+          }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+      }
+
+    for (const auto index : failed)
+      if constexpr (is_write)
+        {
+          if (auto result = File_storage::write(requests[index].page_num, requests[index].buffer);
+              !result.has_value())
+            return result;
+        }
+      else
+        {
+          if (auto result = File_storage::read(requests[index].page_num, requests[index].buffer);
+              !result.has_value())
+            return result;
+        }
+#endif
+    return nullptr;
+  }
+
+  auto Uring_storage::close() noexcept -> void
+  {
+    this->ring.reset();
+    File_storage::close();
+  }
+
+  [[nodiscard]] auto Uring_storage::is_batched() const noexcept -> bool
+  {
+    return this->ring != nullptr;
+  }
+
+  Mmap_storage::Mmap_storage(std::string path, const uint32_t page_size)
+    : Storage(std::move(path), page_size)
+  {
+#ifdef __unix__
+    this->fd = ::open(this->path.c_str(), O_RDWR);
+    if (this->fd < 0)
+      fatal(fmt::format("unable to open {}: {}", this->path, std::strerror(errno)));
+
+    struct stat file_stat;
+    if (0 > fstat(this->fd, &file_stat))
+      fatal(fmt::format("unable to stat {}: {}", this->path, std::strerror(errno)));
+
+    this->size = static_cast<size_t>(file_stat.st_size);
+    this->grow(std::max<size_t>(this->size, 1)).map_error([&](const auto &&error) {
+      error.panic();
+    });
+#else
+    unimplemented();
+#endif
+  }
+
+  [[nodiscard]] auto Mmap_storage::grow(const size_t required) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+#ifdef __unix__
+    if (required <= this->capacity)
+      return nullptr;
+
+    /* Round up to whole chunks, and the chunks to whole pages. */
+    const size_t chunk = (GROWTH_CHUNK + this->page_size - 1) / this->page_size * this->page_size;
+    const size_t new_capacity = (required + chunk - 1) / chunk * chunk;
+
+    if (0 > ftruncate(this->fd, static_cast<off_t>(new_capacity)))
+      return Err(std::strerror(errno));
+
+    void *new_mapping = MAP_FAILED;
+#ifdef __linux__
+    if (this->mapping != nullptr)
+      new_mapping = mremap(this->mapping, this->capacity, new_capacity, MREMAP_MAYMOVE);
+    else
+#endif
+      {
+        if (this->mapping != nullptr)
+          munmap(this->mapping, this->capacity);
+        new_mapping =
+          mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+      }
+
+    if (new_mapping == MAP_FAILED)
+      return Err(std::strerror(errno));
+
+    this->mapping = static_cast<uint8_t *>(new_mapping);
+    this->capacity = new_capacity;
+    return nullptr;
+#else
+    unimplemented();
+#endif
+  }
+
+  [[nodiscard]] auto Mmap_storage::read(page::Page_num page_num, std::span<uint8_t> buffer) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    return this->view(page_num).map([&](const auto &&view) {
+      std::copy(view->begin(), view->end(), buffer.begin());
+      return nullptr;
+    });
+  }
+
+  [[nodiscard]] auto
+    Mmap_storage::write(page::Page_num page_num, std::span<const uint8_t> buffer) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    const auto offset = static_cast<size_t>(page_num * this->page_size);
+
+    return this->grow(offset + buffer.size()).map([&](const auto &&_) {
+      std::copy(buffer.begin(), buffer.end(), this->mapping + offset);
+      this->size = std::max(this->size, offset + buffer.size());
+      return nullptr;
+    });
+  }
+
+  [[nodiscard]] auto Mmap_storage::view(page::Page_num page_num) noexcept
+    -> tl::expected<tl::optional<std::span<const uint8_t>>, Error>
+  {
+    const auto offset = static_cast<size_t>(page_num * this->page_size);
+
+    if (offset + this->page_size > this->size)
+      return Err(fmt::format("page {} is beyond the end of {}", page_num, this->path));
+
+    return std::span<const uint8_t>{this->mapping + offset, this->page_size};
+  }
+
+  auto Mmap_storage::prefetch(const page::Page_num page_num, const uint32_t count) noexcept -> void
+  {
+#ifdef __unix__
+    const auto offset = static_cast<size_t>(page_num * this->page_size);
+    if (offset >= this->size)
+      return;
+
+    /* madvise wants an address aligned on the system page. */
+    const auto aligned_offset = offset / page::Page::DEFAULT_PAGE_SIZE * page::Page::DEFAULT_PAGE_SIZE;
+    const auto end = std::min(this->size, offset + static_cast<size_t>(count) * this->page_size);
+    madvise(this->mapping + aligned_offset, end - aligned_offset, MADV_WILLNEED);
+#endif
+  }
+
+  [[nodiscard]] auto Mmap_storage::flush() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    /* Stores to a shared mapping are already visible to the operating system. */
+    return nullptr;
+  }
+
+  [[nodiscard]] auto Mmap_storage::sync() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+#ifdef __unix__
+    if (0 > msync(this->mapping, this->size, MS_SYNC) || 0 > fsync(this->fd))
+      return Err(std::strerror(errno));
+#endif
+    return nullptr;
+  }
+
+  [[nodiscard]] auto Mmap_storage::truncate(const page::Page_num page_count) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+#ifdef __unix__
+    /* The pages past the end of the file must not stay mapped, it is mapped
+     * again from scratch. */
+    munmap(this->mapping, this->capacity);
+    this->mapping = nullptr;
+    this->capacity = 0;
+    this->size = std::min<size_t>(this->size, page_count * this->page_size);
+
+    if (0 > ftruncate(this->fd, static_cast<off_t>(this->size)))
+      return Err(std::strerror(errno));
+
+    return this->grow(std::max<size_t>(this->size, 1));
+#else
+    unimplemented();
+#endif
+  }
+
+  auto Mmap_storage::close() noexcept -> void
+  {
+#ifdef __unix__
+    if (this->fd < 0)
+      return;
+
+    munmap(this->mapping, this->capacity);
+    this->mapping = nullptr;
+    this->capacity = 0;
+
+    /* Give the unused part of the last chunk back. */
+    if (0 > ftruncate(this->fd, static_cast<off_t>(this->size)))
+      spdlog::error("unable to truncate {}: {}", this->path, std::strerror(errno));
+
+    ::close(this->fd);
+    this->fd = -1;
+#endif
+  }
+
+  [[nodiscard]] auto Mmap_storage::is_open() const noexcept -> bool { return this->fd >= 0; }
+
+  [[nodiscard]] auto open(const Backend backend, const std::string &path, const uint32_t page_size) noexcept
+    -> std::unique_ptr<Storage>
+  {
+    switch (backend)
+      {
+      case Backend::MMAP:
+        return std::make_unique<Mmap_storage>(path, page_size);
+      case Backend::IO_URING:
+        return std::make_unique<Uring_storage>(path, page_size);
+      case Backend::FILE:
+      default:
+        return std::make_unique<File_storage>(path, page_size);
+      }
+  }
+} // namespace toocal::core::storage
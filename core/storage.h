@@ -0,0 +1,240 @@
+#ifndef TOOCAL_CORE_STORAGE_H
+#define TOOCAL_CORE_STORAGE_H
+
+#include "errors.hpp"
+#include "page.h"
+#include "tl/expected.hpp"
+#include "tl/optional.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+
+namespace toocal::core::storage
+{
+  using errors::Error;
+
+  enum class Backend
+  {
+    /** Pages are read and written with explicit I/O on the database file. */
+    FILE,
+
+    /** The database file is memory mapped and pages are accessed in place. */
+    MMAP,
+
+    /** Like FILE, and batches of pages are submitted together through
+     ** io_uring. Falls back to FILE when io_uring is unavailable. */
+    IO_URING,
+  };
+
+  /** A page read by Storage::read_batch, buffer.size() must be page_size. */
+  class Read_request
+  {
+  public:
+    page::Page_num     page_num;
+    std::span<uint8_t> buffer;
+  };
+
+  /** A page written by Storage::write_batch. */
+  class Write_request
+  {
+  public:
+    page::Page_num           page_num;
+    std::span<const uint8_t> buffer;
+  };
+
+  /** Storage is where the data access layer reads and writes whole pages. */
+  class Storage
+  {
+  public:
+    const std::string path;
+    const uint32_t    page_size;
+
+    Storage(std::string path, const uint32_t page_size)
+      : path(std::move(path)), page_size(page_size)
+    {}
+
+    Storage(const Storage &) = delete;
+    Storage &operator=(const Storage &) = delete;
+    virtual ~Storage() = default;
+
+    /** Read page_num into buffer, buffer.size() must be page_size. */
+    [[nodiscard]] virtual auto read(page::Page_num page_num, std::span<uint8_t> buffer) noexcept
+      -> tl::expected<std::nullptr_t, Error> = 0;
+
+    /** Write buffer to page_num, growing the file if needed. */
+    [[nodiscard]] virtual auto
+      write(page::Page_num page_num, std::span<const uint8_t> buffer) noexcept
+      -> tl::expected<std::nullptr_t, Error> = 0;
+
+    /** Read every request, by default one after the other with read. */
+    [[nodiscard]] virtual auto read_batch(std::span<const Read_request> requests) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Write every request, by default one after the other with write. */
+    [[nodiscard]] virtual auto write_batch(std::span<const Write_request> requests) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Returns the page bytes in place without copying them, or nullopt if
+     ** the backend cannot do it. The view is valid until the next write. */
+    [[nodiscard]] virtual auto view(page::Page_num page_num) noexcept
+      -> tl::expected<tl::optional<std::span<const uint8_t>>, Error>;
+
+    /** Hint that the pages from page_num to page_num + count will be read
+     ** soon, so the operating system can start reading them ahead. Does
+     ** nothing by default. */
+    virtual auto prefetch(page::Page_num page_num, uint32_t count) noexcept -> void;
+
+    /** Hand buffered writes over to the operating system. */
+    [[nodiscard]] virtual auto flush() noexcept -> tl::expected<std::nullptr_t, Error> = 0;
+
+    /** Shrink the file to its first page_count pages. */
+    [[nodiscard]] virtual auto truncate(page::Page_num page_count) noexcept
+      -> tl::expected<std::nullptr_t, Error> = 0;
+
+    /** Flush and wait until the written pages are on stable storage. */
+    [[nodiscard]] virtual auto sync() noexcept -> tl::expected<std::nullptr_t, Error> = 0;
+
+    virtual auto close() noexcept -> void = 0;
+    [[nodiscard]] virtual auto is_open() const noexcept -> bool = 0;
+
+    /** Whether read and write can be called from several threads at once,
+     ** as long as no two of them write the same page. False by default. */
+    [[nodiscard]] virtual auto is_thread_safe() const noexcept -> bool;
+
+    /** Whether read_batch and write_batch submit their requests together
+     ** instead of one after the other. False by default. */
+    [[nodiscard]] virtual auto is_batched() const noexcept -> bool;
+  };
+
+  /** File_storage reads and writes pages with pread and pwrite on a single
+   ** descriptor. There is no shared file position, so every page takes one
+   ** system call and any number of threads can read and write at once. */
+  class File_storage : public Storage
+  {
+  protected:
+    int fd = -1;
+
+  public:
+    File_storage(std::string path, uint32_t page_size);
+    ~File_storage() override { this->close(); }
+
+    [[nodiscard]] auto read(page::Page_num page_num, std::span<uint8_t> buffer) noexcept
+      -> tl::expected<std::nullptr_t, Error> override;
+
+    [[nodiscard]] auto write(page::Page_num page_num, std::span<const uint8_t> buffer) noexcept
+      -> tl::expected<std::nullptr_t, Error> override;
+
+    auto prefetch(page::Page_num page_num, uint32_t count) noexcept -> void override;
+
+    [[nodiscard]] auto flush() noexcept -> tl::expected<std::nullptr_t, Error> override;
+    [[nodiscard]] auto sync() noexcept -> tl::expected<std::nullptr_t, Error> override;
+
+    [[nodiscard]] auto truncate(page::Page_num page_count) noexcept
+      -> tl::expected<std::nullptr_t, Error> override;
+
+    auto               close() noexcept -> void override;
+    [[nodiscard]] auto is_open() const noexcept -> bool override;
+    [[nodiscard]] auto is_thread_safe() const noexcept -> bool override;
+  };
+
+  /** Uring_storage is a File_storage that submits the requests of
+   ** read_batch and write_batch to an io_uring queue of QUEUE_DEPTH entries
+   ** and waits for all of them at once, so the device works on a whole batch
+   ** instead of one page at a time. Single pages still go through pread and
+   ** pwrite. When the queue cannot be set up (an old kernel, or io_uring
+   ** denied by a seccomp policy), the batches are read and written like
+   ** File_storage does. */
+  class Uring_storage final : public File_storage
+  {
+  public:
+    static constexpr uint32_t QUEUE_DEPTH = 128;
+
+  private:
+    /** The mapped submission and completion queues, defined with io_uring. */
+    class Ring;
+
+    std::unique_ptr<Ring> ring;
+
+    /** The queues have a single submitter. */
+    std::mutex ring_mutex;
+
+  public:
+    Uring_storage(std::string path, uint32_t page_size);
+    ~Uring_storage() override;
+
+    [[nodiscard]] auto read_batch(std::span<const Read_request> requests) noexcept
+      -> tl::expected<std::nullptr_t, Error> override;
+
+    [[nodiscard]] auto write_batch(std::span<const Write_request> requests) noexcept
+      -> tl::expected<std::nullptr_t, Error> override;
+
+    auto               close() noexcept -> void override;
+    [[nodiscard]] auto is_batched() const noexcept -> bool override;
+
+  private:
+    /** Submit up to QUEUE_DEPTH requests and wait for their completions. A
+     ** request that fails or completes short is done again with
+     ** File_storage::read or write, which reports the error. */
+    template <typename Request>
+    [[nodiscard]] auto submit(std::span<const Request> requests) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+  };
+
+  /** Mmap_storage maps the whole database file. The mapping grows in chunks
+   ** of GROWTH_CHUNK bytes (rounded to whole pages) so that appending pages
+   ** does not remap on every write, and the file is truncated back to the
+   ** last written page when it is closed. A write that grows the file may
+   ** move the mapping, so it is not thread safe. */
+  class Mmap_storage final : public Storage
+  {
+  public:
+    static constexpr size_t GROWTH_CHUNK = 1024 * 1024;
+
+  private:
+    int      fd = -1;
+    uint8_t *mapping = nullptr;
+
+    /** The size of the mapping and of the file while it is open. */
+    size_t capacity = 0;
+
+    /** The size of the file up to the last written page. */
+    size_t size = 0;
+
+  public:
+    Mmap_storage(std::string path, uint32_t page_size);
+    ~Mmap_storage() override { this->close(); }
+
+    [[nodiscard]] auto read(page::Page_num page_num, std::span<uint8_t> buffer) noexcept
+      -> tl::expected<std::nullptr_t, Error> override;
+
+    [[nodiscard]] auto write(page::Page_num page_num, std::span<const uint8_t> buffer) noexcept
+      -> tl::expected<std::nullptr_t, Error> override;
+
+    [[nodiscard]] auto view(page::Page_num page_num) noexcept
+      -> tl::expected<tl::optional<std::span<const uint8_t>>, Error> override;
+
+    auto prefetch(page::Page_num page_num, uint32_t count) noexcept -> void override;
+
+    [[nodiscard]] auto flush() noexcept -> tl::expected<std::nullptr_t, Error> override;
+    [[nodiscard]] auto sync() noexcept -> tl::expected<std::nullptr_t, Error> override;
+
+    [[nodiscard]] auto truncate(page::Page_num page_count) noexcept
+      -> tl::expected<std::nullptr_t, Error> override;
+
+    auto               close() noexcept -> void override;
+    [[nodiscard]] auto is_open() const noexcept -> bool override;
+
+  private:
+    /** Grow the file and the mapping so that at least required bytes are mapped. */
+    [[nodiscard]] auto grow(size_t required) noexcept -> tl::expected<std::nullptr_t, Error>;
+  };
+
+  /** Open the storage of an existing database file with the given backend. */
+  [[nodiscard]] auto open(Backend backend, const std::string &path, uint32_t page_size) noexcept
+    -> std::unique_ptr<Storage>;
+} // namespace toocal::core::storage
+
+#endif /* TOOCAL_CORE_STORAGE_H */
@@ -0,0 +1,280 @@
+#include "transaction.h"
+#include "collection.h"
+#include "data_access_layer.h"
+#include "node.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <thread>
+
+namespace toocal::core::transaction
+{
+  Transaction::Transaction(data_access_layer::Data_access_layer *dal)
+    : dal(dal)
+  {
+    if (this->dal->active_transaction() != nullptr)
+      fatal(fmt::format("a transaction is already active on {}", this->dal->path));
+
+    /* The transaction of another thread is waited for. */
+    this->writer = std::unique_lock{this->dal->writer};
+    this->dal->writer_thread = std::this_thread::get_id();
+    this->meta = this->dal->meta;
+
+    /* Reclaimed pages are released for good, they must not be rolled back. */
+    this->dal->reclaim();
+    this->dal->transaction = this;
+    this->dal->freelist.begin();
+  }
+
+  Transaction::~Transaction()
+  {
+    if (this->active)
+      this->rollback();
+  }
+
+  [[nodiscard]] auto Transaction::is_active() const noexcept -> bool { return this->active; }
+
+  [[nodiscard]] auto Transaction::is_staging() const noexcept -> bool { return this->staging; }
+
+  [[nodiscard]] auto Transaction::commit() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    if (!this->active)
+      return Err("the transaction is no longer active");
+
+    if (auto result = this->write_roots(this->dal->options.copy_on_write); !result.has_value())
+      return result;
+
+    if (this->dal->options.copy_on_write)
+      if (auto result = this->copy_on_write().and_then([&](const auto &&_) { return this->write_roots(true); });
+          !result.has_value())
+        return result;
+
+    /* The pages below reach the data access layer instead of being staged
+     * again, the transaction is only ended once they are written, so a
+     * failed write still rolls it back. */
+    this->staging = false;
+    const auto freelist_modified = this->dal->freelist.is_modified();
+
+    /* The pages are sorted in page order, and reach a batched storage
+     * together. */
+    auto pages = std::vector<page::Page *>{};
+    pages.reserve(this->pages.size());
+    for (auto &[_, page] : this->pages)
+      pages.push_back(&page);
+    std::ranges::sort(pages, {}, &page::Page::page_num);
+
+    /* The freelist and the meta are written last, and only if they changed. */
+    return this->dal->write_pages(pages)
+      .and_then([&](const auto &&_) -> tl::expected<std::nullptr_t, Error> {
+        if (!freelist_modified)
+          return nullptr;
+        return this->dal->write_freelist();
+      })
+      .and_then([&](const auto &&_) -> tl::expected<std::nullptr_t, Error> {
+        if (this->dal->meta == this->meta)
+          return nullptr;
+        return this->dal->write_meta(this->dal->meta);
+      })
+      .and_then([&](const auto &&_) { return this->dal->log_commit(); })
+      .map_error([&](auto &&error) {
+        this->dal->discard_written_pages();
+        this->staging = true;
+        return error;
+      })
+      .and_then([&](const auto lsn) {
+        this->dal->keep_written_pages();
+
+        /* The log keeps the pages of a commit whose sync failed, they are made
+         * durable by the next one, so the commit is kept in memory too. The
+         * next writer begins while the fsync is waited for. */
+        this->end();
+        this->pages.clear();
+        this->dal->freelist.commit();
+        if (this->dal->options.copy_on_write)
+          this->dal->publish(std::move(this->retired));
+        this->writer.unlock();
+        return this->dal->sync_commit(lsn);
+      });
+  }
+
+  auto Transaction::rollback() noexcept -> void
+  {
+    if (!this->active)
+      return;
+
+    this->end();
+    this->pages.clear();
+    this->retired.clear();
+    this->recorded.clear();
+    this->dal->meta = this->meta;
+    this->dal->freelist.rollback();
+
+    for (const auto &[collection, root] : this->roots)
+      collection->root = root;
+    this->writer.unlock();
+  }
+
+  auto Transaction::stage(page::Page page) noexcept -> void
+  {
+    const auto page_num = page.page_num;
+    this->pages.insert_or_assign(page_num, std::move(page));
+  }
+
+  auto Transaction::stage(const page::Page_num page_num, const std::span<const uint8_t> data) noexcept -> void
+  {
+    if (const auto page = this->pages.find(page_num); page != this->pages.end())
+      page->second.data.assign(data.begin(), data.end());
+    else
+      this->pages.emplace(page_num, page::Page{page_num, {data.begin(), data.end()}});
+  }
+
+  [[nodiscard]] auto Transaction::find(const page::Page_num page_num) const noexcept
+    -> const page::Page *
+  {
+    /* The pages the commit moved to the page cache are found there. */
+    const auto page = this->pages.find(page_num);
+    return page == this->pages.end() || page->second.data.empty() ? nullptr : &page->second;
+  }
+
+  auto Transaction::track(collection::Collection *collection) noexcept -> void
+  {
+    if (std::ranges::none_of(this->roots, [&](const auto &root) { return root.first == collection; }))
+      this->roots.emplace_back(collection, collection->root);
+  }
+
+  [[nodiscard]] auto Transaction::size() const noexcept -> size_t { return this->pages.size(); }
+
+  auto Transaction::retire(const page::Page_num page_num) noexcept -> void
+  {
+    this->retired.push_back(page_num);
+  }
+
+  auto Transaction::record(const page::Page_num page_num) noexcept -> void
+  {
+    this->recorded.insert(page_num);
+  }
+
+  [[nodiscard]] auto Transaction::write_roots(const bool all) noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    /* Writing to the catalog adds it to the roots. */
+    for (size_t i = 0, count = this->roots.size(); i < count; i++)
+      if (const auto [collection, root] = this->roots[i]; all || collection->root != root)
+        if (auto result = this->dal->write_root(*collection); !result.has_value())
+          return result;
+
+    return nullptr;
+  }
+
+  [[nodiscard]] auto Transaction::copy_on_write() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+    auto &freelist = this->dal->freelist;
+
+    /* The staged pages of the nodes released by the transaction are dropped,
+     * a snapshot may still read them. */
+    const auto retired = std::set<page::Page_num>{this->retired.begin(), this->retired.end()};
+    for (const auto page_num : retired)
+      this->pages.erase(page_num);
+
+    /* Walk down from the roots through the nodes staged or recorded, the
+     * ancestors of every node modified are among them. */
+    const auto is_touched = [&](const page::Page_num page_num) {
+      return this->pages.contains(page_num) || this->recorded.contains(page_num);
+    };
+
+    auto reached = std::set<page::Page_num>{};
+    auto pending = std::vector<page::Page_num>{};
+    for (const auto &[collection, _] : this->roots)
+      if (0 != collection->root && is_touched(collection->root))
+        pending.push_back(collection->root);
+
+    while (!pending.empty())
+      {
+        const auto page_num = pending.back();
+        pending.pop_back();
+        if (!reached.insert(page_num).second)
+          continue;
+
+        const auto data = this->dal->view_page(page_num);
+        if (!data.has_value())
+          return tl::make_unexpected(data.error());
+
+        const auto node = node::Node_view{data.value()};
+        if (!node.is_leaf())
+          for (uint32_t i = 0; i <= node.items_count(); i++)
+            if (const auto child = node.child(i); is_touched(child))
+              pending.push_back(child);
+      }
+
+    /* A node in use before the transaction is only staged on the way to
+     * a modified node, it would be overwritten otherwise. */
+    for (const auto &[page_num, _] : this->pages)
+      if (!reached.contains(page_num) && !freelist.is_allocated_since_begin(page_num))
+        return Err(fmt::format("the page {} would be overwritten in place", page_num));
+
+    if (reached.empty())
+      return nullptr;
+
+    /* The nodes in use before the transaction move to new pages and are
+     * retired, the others keep their page. */
+    auto pages = std::map<page::Page_num, page::Page_num>{};
+    for (const auto page_num : reached)
+      if (freelist.is_allocated_since_begin(page_num))
+        pages.emplace(page_num, page_num);
+      else
+        {
+          pages.emplace(page_num, freelist.get_next_page(page_num));
+          this->retired.push_back(page_num);
+        }
+
+    const auto remap = [&](page::Page_num &page_num) {
+      if (const auto moved_page = pages.find(page_num); moved_page != pages.end())
+        page_num = moved_page->second;
+    };
+
+    auto copies = std::vector<page::Page>{};
+    for (const auto &[page_num, new_page_num] : pages)
+      {
+        auto node = this->dal->read_page(page_num).and_then(
+          [&](const auto &page) { return types::Serializer<node::Node>::deserialize(page.data); });
+        if (!node.has_value())
+          return tl::make_unexpected(node.error());
+
+        for (auto &child : node->children)
+          remap(child);
+
+        auto data = types::Serializer<node::Node>::serialize(node.value(), this->dal->options.page_size);
+        if (!data.has_value())
+          return tl::make_unexpected(data.error());
+
+        data->resize(this->dal->options.page_size);
+        copies.push_back(page::Page{new_page_num, std::move(data.value())});
+      }
+
+    /* The nodes in use before the transaction are never written in place. */
+    for (const auto &[page_num, new_page_num] : pages)
+      if (page_num != new_page_num)
+        this->pages.erase(page_num);
+    for (auto &page : copies)
+      this->stage(std::move(page));
+
+    /* The collections switch to their copied roots, the meta holds the root
+     * of the catalog before the other roots are written to it. */
+    for (const auto &[collection, root] : this->roots)
+      if (const auto new_root = pages.find(collection->root); new_root != pages.end())
+        {
+          collection->root = new_root->second;
+          if (this->dal->is_catalog(*collection))
+            this->dal->meta.root = collection->root;
+        }
+
+    return nullptr;
+  }
+
+  auto Transaction::end() noexcept -> void
+  {
+    this->active = false;
+    this->staging = true;
+    this->dal->transaction = nullptr;
+    this->dal->writer_thread = std::thread::id{};
+  }
+} // namespace toocal::core::transaction
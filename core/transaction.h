@@ -0,0 +1,158 @@
+#ifndef TOOCAL_CORE_TRANSACTION_H
+#define TOOCAL_CORE_TRANSACTION_H
+
+#include "errors.hpp"
+#include "freelist.h"
+#include "meta.h"
+#include "page.h"
+#include "tl/expected.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace toocal::core::data_access_layer
+{
+  class Data_access_layer;
+}
+
+namespace toocal::core::collection
+{
+  class Collection;
+}
+
+namespace toocal::core::transaction
+{
+  using errors::Error;
+
+  /** Transaction batches the pages written to a data access layer. While a
+   ** transaction is active, Data_access_layer::write_page stages the pages in
+   ** memory instead of writing them through, and reads are served from the
+   ** staged pages first, so the transaction sees its own writes. A page
+   ** written several times is only kept once.
+   **
+   ** On commit the staged pages are written in page order, moved to the page
+   ** cache when it is enabled, then the freelist
+   ** and the meta page if they changed, and Data_access_layer::commit makes
+   ** them durable. If one of these writes fails, the pages already written
+   ** to the page cache or to the write-ahead log are dropped, see
+   ** Data_access_layer::discard_written_pages, and the transaction stays
+   ** active, and is rolled back. On rollback the staged pages are dropped and the freelist,
+   ** the meta and the roots of the collections modified by the transaction
+   ** are restored.
+   **
+   ** With Options::copy_on_write the nodes of the committed trees are never
+   ** overwritten. The commit writes the staged nodes that were in use before
+   ** the transaction, and the nodes on their path from the root, to new pages
+   ** instead, and switches the roots of the collections, the catalog records
+   ** them. No committed node is written in place, so the links between the
+   ** leaves are not kept, see cursor::Cursor. The pages the transaction released
+   ** are retired until no snapshot::Snapshot can read them.
+   **
+   ** The roots of the collections of the catalog modified by the transaction
+   ** are written to the catalog before the commit writes the pages, so they
+   ** are durable with them. With Options::copy_on_write they are written
+   ** again once the nodes moved, to the catalog leaves moved with them.
+   **
+   ** Only one transaction can be active on a data access layer at a time, a
+   ** transaction begun on another thread waits for Data_access_layer::writer.
+   ** A transaction still active when it is destroyed is rolled back.
+   ** Collection put and remove run in an implicit transaction when none is
+   ** active on their thread. */
+  class Transaction
+  {
+  public:
+    data_access_layer::Data_access_layer *dal;
+
+  private:
+    /** Data_access_layer::writer, released once the commit is logged. */
+    std::unique_lock<std::recursive_mutex> writer;
+
+    bool active = true;
+
+    /** Whether the pages written are staged, false while commit writes them. */
+    bool staging = true;
+
+    /** The staged pages, sorted by commit. */
+    std::unordered_map<page::Page_num, page::Page> pages;
+
+    /** The meta when the transaction began, the changes of the freelist are
+     ** recorded by the freelist itself. */
+    meta::Meta meta;
+
+    /** The collections modified by the transaction and their roots when
+     ** they were first modified. */
+    std::vector<std::pair<collection::Collection *, page::Page_num>> roots;
+
+    /** The pages released with Options::copy_on_write. */
+    std::vector<page::Page_num> retired;
+
+    /** The nodes on the way from the roots to the nodes modified with
+     ** Options::copy_on_write, see record. */
+    std::unordered_set<page::Page_num> recorded;
+
+  public:
+    /** Begin a transaction on dal. */
+    explicit Transaction(data_access_layer::Data_access_layer *dal);
+    ~Transaction();
+
+    /* The data access layer keeps a pointer to its active transaction. */
+    Transaction(const Transaction &) = delete;
+    Transaction(Transaction &&) = delete;
+
+    [[nodiscard]] auto is_active() const noexcept -> bool;
+
+    /** Whether the pages written to the data access layer are staged in the
+     ** transaction, they are written through while it commits. */
+    [[nodiscard]] auto is_staging() const noexcept -> bool;
+
+    [[nodiscard]] auto commit() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    auto rollback() noexcept -> void;
+
+    /** Stage a page written during the transaction. */
+    auto stage(page::Page page) noexcept -> void;
+
+    /** Same as stage, a page staged already is overwritten in place. */
+    auto stage(page::Page_num page_num, std::span<const uint8_t> data) noexcept -> void;
+
+    /** The staged image of page_num, or nullptr, also once the commit moved
+     ** it to the page cache. */
+    [[nodiscard]] auto find(page::Page_num page_num) const noexcept -> const page::Page *;
+
+    /** Remember the root of collection so a rollback can restore it, must be
+     ** called before the collection is modified. */
+    auto track(collection::Collection *collection) noexcept -> void;
+
+    /** The number of distinct pages staged so far. */
+    [[nodiscard]] auto size() const noexcept -> size_t;
+
+    /** Release a page once the transaction commits and no snapshot can read
+     ** it anymore, see Options::copy_on_write. */
+    auto retire(page::Page_num page_num) noexcept -> void;
+
+    /** Record a node on the way from the root of a collection to a node the
+     ** transaction modifies, with Options::copy_on_write. The commit copies
+     ** it with the nodes below it, instead of searching the paths again. */
+    auto record(page::Page_num page_num) noexcept -> void;
+
+  private:
+    /** Write the roots of the collections of the catalog modified by the
+     ** transaction to the catalog, see Data_access_layer::write_root. With
+     ** all, the roots that did not change are written too. */
+    [[nodiscard]] auto write_roots(bool all) noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Move the staged nodes that were in use before the transaction, and
+     ** the nodes on their path from the roots, to new pages. The paths are
+     ** walked down from the roots through the staged and the recorded nodes. */
+    [[nodiscard]] auto copy_on_write() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Detach the transaction from the data access layer. */
+    auto end() noexcept -> void;
+  };
+} // namespace toocal::core::transaction
+
+#endif /* TOOCAL_CORE_TRANSACTION_H */
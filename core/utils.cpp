@@ -1,30 +1,242 @@
 #include "utils.h"
 #include "errors.hpp"
 
+#include <array>
+#include <atomic>
+#include <bit>
+
 #ifdef __unix__
 #include <sys/stat.h>
 #endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TOOCAL_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
 namespace toocal::core::utils
 {
+  /** Eight bytes at a time, the first differing byte is found from the
+   ** lowest differing bit of the words on a little endian CPU. */
+  __attribute__((always_inline)) static inline auto
+    _mismatch_scalar(const uint8_t* k1, const uint8_t* k2, const size_t size) noexcept -> size_t
+  {
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+      {
+        uint64_t word1, word2;
+        std::memcpy(&word1, k1 + i, sizeof(uint64_t));
+        std::memcpy(&word2, k2 + i, sizeof(uint64_t));
+
+        if (word1 != word2)
+          {
+            if constexpr (std::endian::native == std::endian::little)
+              return i + std::countr_zero(word1 ^ word2) / 8;
+            else
+              return i + std::countl_zero(word1 ^ word2) / 8;
+          }
+      }
+
+    while (i < size && k1[i] == k2[i])
+      i++;
+    return i;
+  }
+
+#ifdef TOOCAL_SIMD_X86
+  /* The narrower steps are inlined to finish the rest of the wider ones. */
+  __attribute__((target("sse2"), always_inline)) static inline auto
+    _mismatch_sse2(const uint8_t* k1, const uint8_t* k2, const size_t size) noexcept -> size_t
+  {
+    size_t i = 0;
+    for (; i + sizeof(__m128i) <= size; i += sizeof(__m128i))
+      {
+        const auto equal = _mm_cmpeq_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(k1 + i)),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(k2 + i)));
+
+        if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(equal)); mask != 0xFFFF)
+          return i + std::countr_zero(~mask);
+      }
+
+    return i + _mismatch_scalar(k1 + i, k2 + i, size - i);
+  }
+
+  __attribute__((target("avx2"))) static auto
+    _mismatch_avx2(const uint8_t* k1, const uint8_t* k2, const size_t size) noexcept -> size_t
+  {
+    size_t i = 0;
+    for (; i + sizeof(__m256i) <= size; i += sizeof(__m256i))
+      {
+        const auto equal = _mm256_cmpeq_epi8(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(k1 + i)),
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(k2 + i)));
+
+        if (const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(equal)); mask != 0xFFFFFFFF)
+          return i + std::countr_zero(~mask);
+      }
+
+    return i + _mismatch_sse2(k1 + i, k2 + i, size - i);
+  }
+#endif
+
+  using _Mismatch = size_t (*)(const uint8_t*, const uint8_t*, size_t) noexcept;
+
+  static auto _mismatch_of(const Safecmp::Simd simd) noexcept -> _Mismatch
+  {
+    switch (simd)
+      {
+#ifdef TOOCAL_SIMD_X86
+      case Safecmp::Simd::AVX2:
+        return _mismatch_avx2;
+      case Safecmp::Simd::SSE2:
+        return _mismatch_sse2;
+#endif
+      default:
+        return _mismatch_scalar;
+      }
+  }
+
+  static auto _mismatch_resolve(const uint8_t* k1, const uint8_t* k2, size_t size) noexcept -> size_t;
+
+  /** Resolved on the first comparison, which may come before main. */
+  static auto _mismatch = std::atomic<_Mismatch>{_mismatch_resolve};
+
+  static auto _mismatch_resolve(const uint8_t* k1, const uint8_t* k2, const size_t size) noexcept
+    -> size_t
+  {
+    const auto mismatch = _mismatch_of(Safecmp::simd());
+    _mismatch.store(mismatch, std::memory_order_relaxed);
+    return mismatch(k1, k2, size);
+  }
+
+  [[nodiscard]] auto Safecmp::simd() noexcept -> Simd
+  {
+    static const auto simd = [] {
+      for (const auto simd : {Simd::AVX2, Simd::SSE2})
+        if (Safecmp::supports(simd))
+          return simd;
+      return Simd::NONE;
+    }();
+
+    return simd;
+  }
+
+  [[nodiscard]] auto Safecmp::supports(const Simd simd) noexcept -> bool
+  {
+#ifdef TOOCAL_SIMD_X86
+    /* May run before the constructor initializing the CPU model. */
+    __builtin_cpu_init();
+    switch (simd)
+      {
+      case Simd::AVX2:
+        return __builtin_cpu_supports("avx2");
+      case Simd::SSE2:
+        return __builtin_cpu_supports("sse2");
+      default:
+        return true;
+      }
+#else
+    return simd == Simd::NONE;
+#endif
+  }
+
+  [[nodiscard]] auto Safecmp::mismatch(std::span<const uint8_t> k1, std::span<const uint8_t> k2) noexcept
+    -> size_t
+  {
+    /* Shorter than a vector, the words are compared without the indirect call. */
+    const auto size = std::min(k1.size(), k2.size());
+    if (size < 16)
+      return _mismatch_scalar(k1.data(), k2.data(), size);
+
+    return _mismatch.load(std::memory_order_relaxed)(k1.data(), k2.data(), size);
+  }
+
+  [[nodiscard]] auto Safecmp::mismatch(
+    std::span<const uint8_t> k1, std::span<const uint8_t> k2, const Simd simd) noexcept -> size_t
+  {
+    return _mismatch_of(simd)(k1.data(), k2.data(), std::min(k1.size(), k2.size()));
+  }
+
   [[nodiscard]] auto Safecmp::memcmp(const std::string& k1, const std::string& k2) noexcept -> int
   {
-    size_t minSize = std::min(k1.size(), k2.size());
-    for (size_t i = 0; i < minSize; ++i)
-      if (k1[i] != k2[i])
-        return k1[i] < k2[i] ? -1 : 1;
+    const auto i = mismatch(
+      {reinterpret_cast<const uint8_t*>(k1.data()), k1.size()},
+      {reinterpret_cast<const uint8_t*>(k2.data()), k2.size()});
+    if (i < std::min(k1.size(), k2.size()))
+      return k1[i] < k2[i] ? -1 : 1;
     return k1.size() < k2.size() ? -1 : (k1.size() > k2.size() ? 1 : 0);
   }
 
   [[nodiscard]] auto Safecmp::bytescmp(
     const std::vector<uint8_t>& k1, const std::vector<uint8_t>& k2) noexcept -> int
   {
-    size_t minSize = std::min(k1.size(), k2.size());
-    for (size_t i = 0; i < minSize; ++i)
-      if (k1[i] != k2[i])
-        return k1[i] < k2[i] ? -1 : 1;
+    return bytescmp(std::span<const uint8_t>{k1}, std::span<const uint8_t>{k2});
+  }
+
+  [[nodiscard]] auto
+    Safecmp::bytescmp(std::span<const uint8_t> k1, std::span<const uint8_t> k2) noexcept -> int
+  {
+    const auto i = mismatch(k1, k2);
+    if (i < std::min(k1.size(), k2.size()))
+      return k1[i] < k2[i] ? -1 : 1;
     return k1.size() < k2.size() ? -1 : (k1.size() > k2.size() ? 1 : 0);
   }
 
+  [[nodiscard]] auto Checksum::crc32(std::span<const uint8_t> data) noexcept -> uint32_t
+  {
+    static const auto table = [] {
+      auto table = std::array<uint32_t, 256>{};
+      for (uint32_t i = 0; i < table.size(); i++)
+        {
+          uint32_t crc = i;
+          for (uint32_t bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+          table[i] = crc;
+        }
+      return table;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (const auto byte : data)
+      crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+  }
+
+  [[nodiscard]] auto Varint::size(uint64_t value) noexcept -> uint32_t
+  {
+    uint32_t size = 1;
+    while (value >= 0x80)
+      {
+        value >>= 7;
+        size++;
+      }
+    return size;
+  }
+
+  auto Varint::put(uint64_t value, uint8_t* buffer) noexcept -> uint32_t
+  {
+    uint32_t size = 0;
+    while (value >= 0x80)
+      {
+        buffer[size++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+      }
+    buffer[size++] = static_cast<uint8_t>(value);
+    return size;
+  }
+
+  auto Varint::get(const uint8_t* buffer, uint64_t& value) noexcept -> uint32_t
+  {
+    value = 0;
+    for (uint32_t size = 0; size < MAX_SIZE; size++)
+      {
+        value |= static_cast<uint64_t>(buffer[size] & 0x7F) << (7 * size);
+        if (0 == (buffer[size] & 0x80))
+          return size + 1;
+      }
+    return MAX_SIZE;
+  }
+
   [[nodiscard]] auto Filesystem::sizeof_file(const std::string& path) noexcept -> size_t
   {
 #ifdef __unix__
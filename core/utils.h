@@ -4,16 +4,72 @@
 #include <cstring>
 #include <string>
 #include <cstdint>
+#include <span>
+#include <vector>
 #include <tl/expected.hpp>
 
 namespace toocal::core::utils
 {
+  /** Safecmp compares keys by their first differing byte, a key being
+   ** smaller than the keys it is a prefix of. The differing byte is found
+   ** 32 or 16 bytes at a time with AVX2 or SSE2, picked once for the CPU at
+   ** startup, or 8 bytes at a time elsewhere. */
   class Safecmp
   {
   public:
+    enum class Simd
+    {
+      NONE,
+      SSE2,
+      AVX2,
+    };
+
+    /** The instructions used by mismatch, bytescmp and memcmp. */
+    [[nodiscard]] static auto simd() noexcept -> Simd;
+
+    /** Whether the CPU can run simd. */
+    [[nodiscard]] static auto supports(Simd simd) noexcept -> bool;
+
+    /** The index of the first differing byte of k1 and k2, or the size of
+     ** the shortest one. */
+    [[nodiscard]] static auto
+      mismatch(std::span<const uint8_t> k1, std::span<const uint8_t> k2) noexcept -> size_t;
+
+    /** Same as mismatch with the given instructions, which the CPU must
+     ** support. */
+    [[nodiscard]] static auto
+      mismatch(std::span<const uint8_t> k1, std::span<const uint8_t> k2, Simd simd) noexcept -> size_t;
+
+    /** Compares the bytes as char, which may be signed. */
     [[nodiscard]] static auto memcmp(const std::string& k1, const std::string& k2) noexcept -> int;
     [[nodiscard]] static auto
       bytescmp(const std::vector<uint8_t>& k1, const std::vector<uint8_t>& k2) noexcept -> int;
+    [[nodiscard]] static auto
+      bytescmp(std::span<const uint8_t> k1, std::span<const uint8_t> k2) noexcept -> int;
+  };
+
+  class Checksum
+  {
+  public:
+    /** CRC-32 (IEEE 802.3) of data, used to detect torn writes. */
+    [[nodiscard]] static auto crc32(std::span<const uint8_t> data) noexcept -> uint32_t;
+  };
+
+  /** LEB128 variable length integers: 7 bits per byte, least significant
+   ** group first, the high bit of a byte is set when another byte follows. */
+  class Varint
+  {
+  public:
+    static constexpr uint32_t MAX_SIZE = 10;
+
+    /** The number of bytes needed to encode value. */
+    [[nodiscard]] static auto size(uint64_t value) noexcept -> uint32_t;
+
+    /** Encode value at buffer, returns the number of bytes written. */
+    static auto put(uint64_t value, uint8_t* buffer) noexcept -> uint32_t;
+
+    /** Decode a value at buffer, returns the number of bytes read. */
+    static auto get(const uint8_t* buffer, uint64_t& value) noexcept -> uint32_t;
   };
 
   class Filesystem
@@ -0,0 +1,351 @@
+#include "write_ahead_log.h"
+#include "utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <endian/little_endian.hpp>
+#include <map>
+#include <thread>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace toocal::core::write_ahead_log
+{
+  Write_ahead_log::Write_ahead_log(
+    std::string path, const uint32_t page_size, const std::chrono::microseconds commit_delay)
+    : path(std::move(path)), page_size(page_size), commit_delay(commit_delay)
+  {
+#ifdef __unix__
+    this->fd = ::open(this->path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (this->fd < 0)
+      fatal(fmt::format("unable to open write-ahead log {}: {}", this->path, std::strerror(errno)));
+
+    /* The records left in the file are kept until recover empties it. */
+    struct stat log_stat;
+    if (0 > fstat(this->fd, &log_stat))
+      fatal(fmt::format("unable to open write-ahead log {}: {}", this->path, std::strerror(errno)));
+    this->appended_lsn = this->durable_lsn = static_cast<Lsn>(log_stat.st_size);
+#else
+    unimplemented();
+#endif
+  }
+
+  Write_ahead_log::~Write_ahead_log()
+  {
+#ifdef __unix__
+    if (this->fd >= 0)
+      ::close(this->fd);
+#endif
+  }
+
+  [[nodiscard]] auto Batch::find(const page::Page_num page_num) const noexcept
+    -> tl::optional<std::span<const uint8_t>>
+  {
+    const auto offset = this->offsets.find(page_num);
+    if (offset == this->offsets.end())
+      return tl::nullopt;
+
+    const auto length = endian::little_endian::get<uint32_t>(
+      this->records.data() + offset->second - sizeof(uint32_t));
+    return std::span<const uint8_t>{this->records.data() + offset->second, length};
+  }
+
+  [[nodiscard]] auto Batch::empty() const noexcept -> bool { return this->records.empty(); }
+
+  auto Batch::clear() noexcept -> void
+  {
+    this->records.clear();
+    this->offsets.clear();
+  }
+
+  auto Write_ahead_log::append_record(
+    std::vector<uint8_t>          &records,
+    const Record_type              type,
+    const page::Page_num           page_num,
+    const std::span<const uint8_t> payload) noexcept -> size_t
+  {
+    const auto start = records.size();
+    records.resize(start + RECORD_HEADER_SIZE + payload.size() + sizeof(uint32_t));
+
+    auto *record = records.data() + start;
+    record[0] = static_cast<uint8_t>(type);
+    endian::little_endian::put<page::Page_num>(page_num, record + 1);
+    endian::little_endian::put<uint32_t>(
+      static_cast<uint32_t>(payload.size()), record + 1 + sizeof(page::Page_num));
+    std::ranges::copy(payload, record + RECORD_HEADER_SIZE);
+
+    const auto checksum = utils::Checksum::crc32({record, RECORD_HEADER_SIZE + payload.size()});
+    endian::little_endian::put<uint32_t>(checksum, record + RECORD_HEADER_SIZE + payload.size());
+
+    return start + RECORD_HEADER_SIZE;
+  }
+
+  auto Write_ahead_log::append(Batch &batch, const page::Page &page) const noexcept -> void
+  {
+    batch.offsets[page.page_num] =
+      append_record(batch.records, Record_type::PAGE, page.page_num, page.data);
+  }
+
+  [[nodiscard]] auto Write_ahead_log::commit(Batch &batch) noexcept -> Lsn
+  {
+    const auto lock = std::lock_guard{this->mutex};
+
+    /* The records of the batch stay together, the commits of other threads
+     * are appended before or after them. */
+    this->buffer.insert(this->buffer.end(), batch.records.begin(), batch.records.end());
+    for (const auto &[page_num, _] : batch.offsets)
+      {
+        const auto data = batch.find(page_num).value();
+        this->pages[page_num].assign(data.begin(), data.end());
+      }
+
+    append_record(this->buffer, Record_type::COMMIT, 0, {});
+    this->appended_lsn += batch.records.size() + RECORD_HEADER_SIZE + sizeof(uint32_t);
+    this->statistics.commits++;
+
+    batch.clear();
+    return this->appended_lsn;
+  }
+
+  [[nodiscard]] auto Write_ahead_log::sync(const Lsn lsn) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    auto lock = std::unique_lock{this->mutex};
+
+    while (this->durable_lsn < lsn)
+      {
+        if (!this->failure.empty())
+          return Err(fmt::format("the write-ahead log {} failed: {}", this->path, this->failure));
+
+        /* Another commit is the leader, its fsync may cover this commit too. */
+        if (this->syncing)
+          {
+            this->synced.wait(lock);
+            continue;
+          }
+
+        this->syncing = true;
+
+        /* Give concurrent committers the chance to join this fsync. */
+        if (this->commit_delay.count() > 0)
+          {
+            lock.unlock();
+            std::this_thread::sleep_for(this->commit_delay);
+            lock.lock();
+          }
+
+        const auto pending = std::move(this->buffer);
+        const auto target_lsn = this->appended_lsn;
+        this->buffer.clear();
+        lock.unlock();
+
+        const auto result = [&]() -> tl::expected<std::nullptr_t, Error> {
+#ifdef __unix__
+          for (size_t written = 0; written < pending.size();)
+            {
+              const auto count =
+                ::write(this->fd, pending.data() + written, pending.size() - written);
+              if (count < 0 && errno == EINTR)
+                continue;
+              if (count < 0)
+                return Err(std::strerror(errno));
+              written += static_cast<size_t>(count);
+            }
+
+          if (0 > fdatasync(this->fd))
+            return Err(std::strerror(errno));
+#endif
+          return nullptr;
+        }();
+
+        lock.lock();
+        this->syncing = false;
+        if (result.has_value())
+          {
+            this->durable_lsn = target_lsn;
+            this->statistics.syncs++;
+          }
+        else
+          this->restore(pending, result.error().message);
+        this->synced.notify_all();
+
+        if (!result.has_value())
+          return result;
+      }
+
+    return nullptr;
+  }
+
+  auto Write_ahead_log::restore(const std::span<const uint8_t> pending, const std::string &error) noexcept
+    -> void
+  {
+    /* The records after the durable end of the log may be torn, recovery
+     * would stop at them and drop every commit appended after. */
+#ifdef __unix__
+    if (0 > ftruncate(this->fd, static_cast<off_t>(this->durable_lsn)))
+      {
+        this->failure = fmt::format("{}, then unable to truncate it: {}", error, std::strerror(errno));
+        return;
+      }
+#endif
+
+    /* Appended before the records that joined while the leader wrote. */
+    this->buffer.insert(this->buffer.begin(), pending.begin(), pending.end());
+  }
+
+  [[nodiscard]] auto Write_ahead_log::read(
+    const page::Page_num page_num, const std::span<uint8_t> buffer) const noexcept -> bool
+  {
+    const auto lock = std::lock_guard{this->mutex};
+
+    const auto page = this->pages.find(page_num);
+    if (page == this->pages.end())
+      return false;
+
+    std::ranges::copy(page->second, buffer.begin());
+    return true;
+  }
+
+  [[nodiscard]] auto Write_ahead_log::find(const page::Page_num page_num) const noexcept
+    -> const std::vector<uint8_t> *
+  {
+    const auto lock = std::lock_guard{this->mutex};
+
+    const auto page = this->pages.find(page_num);
+    return page == this->pages.end() ? nullptr : &page->second;
+  }
+
+  [[nodiscard]] auto Write_ahead_log::size() const noexcept -> size_t
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    return this->pages.size();
+  }
+
+  [[nodiscard]] auto Write_ahead_log::checkpoint(storage::Storage &storage) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    /* The commits appended by other threads may not be synced yet. */
+    const auto lsn = [&] {
+      const auto lock = std::lock_guard{this->mutex};
+      return this->appended_lsn;
+    }();
+    if (auto result = this->sync(lsn); !result.has_value())
+      return result;
+
+    const auto lock = std::lock_guard{this->mutex};
+
+    /* Write the pages back in page order, so the database file is written
+     * as sequentially as possible. */
+    auto page_nums = std::vector<page::Page_num>{};
+    page_nums.reserve(this->pages.size());
+    for (const auto &[page_num, _] : this->pages)
+      page_nums.push_back(page_num);
+    std::ranges::sort(page_nums);
+
+    auto requests = std::vector<storage::Write_request>{};
+    requests.reserve(page_nums.size());
+    for (const auto page_num : page_nums)
+      requests.push_back({page_num, this->pages.at(page_num)});
+
+    if (auto result = storage.write_batch(requests); !result.has_value())
+      return result;
+
+    /* The log may only be emptied once the pages are durable in the database file. */
+    return storage.sync().and_then([&](const auto &&_) { return this->truncate(); }).map([&](const auto &&_) {
+      this->pages.clear();
+      this->statistics.checkpoints++;
+      return nullptr;
+    });
+  }
+
+  [[nodiscard]] auto Write_ahead_log::recover(storage::Storage &storage) noexcept
+    -> tl::expected<std::nullptr_t, Error>
+  {
+    auto log = std::vector<uint8_t>{};
+
+#ifdef __unix__
+    struct stat log_stat;
+    if (0 > fstat(this->fd, &log_stat))
+      return Err(std::strerror(errno));
+
+    log.resize(static_cast<size_t>(log_stat.st_size));
+    for (size_t read = 0; read < log.size();)
+      {
+        const auto count = ::pread(
+          this->fd, log.data() + read, log.size() - read, static_cast<off_t>(read));
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count <= 0)
+          return Err(fmt::format("unable to read write-ahead log {}: {}", this->path, std::strerror(errno)));
+        read += static_cast<size_t>(count);
+      }
+#endif
+
+    /* Stage the pages of every commit, only publish them when its commit
+     * record is found. */
+    auto committed = std::map<page::Page_num, std::span<const uint8_t>>{};
+    auto staged = std::map<page::Page_num, std::span<const uint8_t>>{};
+
+    for (size_t position = 0; position + RECORD_HEADER_SIZE + sizeof(uint32_t) <= log.size();)
+      {
+        const auto *record = log.data() + position;
+        const auto  type = static_cast<Record_type>(record[0]);
+        const auto  page_num = endian::little_endian::get<page::Page_num>(record + 1);
+        const auto  length =
+          endian::little_endian::get<uint32_t>(record + 1 + sizeof(page::Page_num));
+
+        if (position + RECORD_HEADER_SIZE + length + sizeof(uint32_t) > log.size())
+          break;
+
+        const auto checksum =
+          endian::little_endian::get<uint32_t>(record + RECORD_HEADER_SIZE + length);
+        if (checksum != utils::Checksum::crc32({record, RECORD_HEADER_SIZE + length}))
+          break;
+
+        if (type == Record_type::PAGE)
+          staged[page_num] = std::span<const uint8_t>{record + RECORD_HEADER_SIZE, length};
+        else if (type == Record_type::COMMIT)
+          {
+            for (const auto &[staged_page_num, data] : staged)
+              committed[staged_page_num] = data;
+            staged.clear();
+          }
+        else
+          break;
+
+        position += RECORD_HEADER_SIZE + length + sizeof(uint32_t);
+      }
+
+    if (!committed.empty())
+      spdlog::info("recovering {} pages from write-ahead log {}", committed.size(), this->path);
+
+    for (const auto &[page_num, data] : committed)
+      if (auto result = storage.write(page_num, data); !result.has_value())
+        return result;
+
+    return storage.sync().and_then([&](const auto &&_) { return this->truncate(); });
+  }
+
+  [[nodiscard]] auto Write_ahead_log::get_statistics() const noexcept -> Statistics
+  {
+    const auto lock = std::lock_guard{this->mutex};
+    return this->statistics;
+  }
+
+  [[nodiscard]] auto Write_ahead_log::truncate() noexcept -> tl::expected<std::nullptr_t, Error>
+  {
+#ifdef __unix__
+    if (0 > ftruncate(this->fd, 0) || 0 > fdatasync(this->fd))
+      return Err(std::strerror(errno));
+#endif
+
+    this->buffer.clear();
+    this->appended_lsn = 0;
+    this->durable_lsn = 0;
+    return nullptr;
+  }
+} // namespace toocal::core::write_ahead_log
@@ -0,0 +1,176 @@
+#ifndef TOOCAL_CORE_WRITE_AHEAD_LOG_H
+#define TOOCAL_CORE_WRITE_AHEAD_LOG_H
+
+#include "errors.hpp"
+#include "page.h"
+#include "storage.h"
+#include "tl/expected.hpp"
+#include "tl/optional.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace toocal::core::write_ahead_log
+{
+  using errors::Error;
+
+  /** Log sequence number, the offset just after a record in the log file. */
+  using Lsn = uint64_t;
+
+  class Statistics
+  {
+  public:
+    uint64_t commits{};
+    uint64_t syncs{};
+    uint64_t checkpoints{};
+  };
+
+  /** Batch holds the page records of one commit until it is appended to the
+   ** log, so the commits of several threads are never mixed. */
+  class Batch
+  {
+    friend class Write_ahead_log;
+
+    std::vector<uint8_t> records;
+
+    /** The offset in records of the latest image of every page. */
+    std::unordered_map<page::Page_num, size_t> offsets;
+
+  public:
+    /** The image of page_num appended to the batch, or tl::nullopt. */
+    [[nodiscard]] auto find(page::Page_num page_num) const noexcept
+      -> tl::optional<std::span<const uint8_t>>;
+
+    [[nodiscard]] auto empty() const noexcept -> bool;
+
+    /** Drop the records, the commit is abandoned. */
+    auto clear() noexcept -> void;
+  };
+
+  /** Write_ahead_log appends page images to a log file next to the database
+   ** file instead of writing them in place. The pages of a commit are
+   ** appended to a Batch, then commit appends the batch and a commit record
+   ** to the log at once, and the pages of a commit become durable with a
+   ** single sequential write and fdatasync of the log. The database file
+   ** itself is only written when the log is checkpointed.
+   **
+   ** Commits from concurrent threads are grouped: the first thread to reach
+   ** sync becomes the leader, optionally waits commit_delay for more commits
+   ** to join, then writes and syncs everything appended so far with one
+   ** fdatasync, while the other threads wait for it.
+   **
+   ** Record layout (little endian):
+   ** --------------------------------------------------------
+   ** | type (1) | page num (8) | length (4) | payload | crc32 |
+   ** --------------------------------------------------------
+   ** The checksum covers the header and the payload, so a torn tail is
+   ** detected and ignored by recovery. */
+  class Write_ahead_log
+  {
+  public:
+    enum class Record_type : uint8_t
+    {
+      PAGE = 1,
+      COMMIT = 2,
+    };
+
+    static constexpr uint32_t RECORD_HEADER_SIZE = 1 + sizeof(page::Page_num) + sizeof(uint32_t);
+
+    const std::string               path;
+    const uint32_t                  page_size;
+    const std::chrono::microseconds commit_delay;
+
+  private:
+    int fd = -1;
+
+    mutable std::mutex      mutex;
+    std::condition_variable synced;
+    bool                    syncing = false;
+
+    /** Records appended but not yet written to the log file. */
+    std::vector<uint8_t> buffer;
+
+    /** The LSN of the end of buffer, and of the end of the durable log. */
+    Lsn appended_lsn = 0;
+    Lsn durable_lsn = 0;
+
+    /** Why the log cannot be written anymore, see restore. Empty while it
+     ** can. */
+    std::string failure;
+
+    /** The latest image of every page logged since the last checkpoint. */
+    std::unordered_map<page::Page_num, std::vector<uint8_t>> pages;
+
+    Statistics statistics;
+
+  public:
+    /** Open the log at path, creating it if it does not exist. Existing
+     ** records are kept until recover is called. */
+    Write_ahead_log(std::string path, uint32_t page_size, std::chrono::microseconds commit_delay);
+    ~Write_ahead_log();
+
+    Write_ahead_log(const Write_ahead_log &) = delete;
+    Write_ahead_log &operator=(const Write_ahead_log &) = delete;
+
+    /** Append the image of a page to batch. */
+    auto append(Batch &batch, const page::Page &page) const noexcept -> void;
+
+    /** Append the records of batch and a commit record, empty batch and
+     ** return the LSN of the commit, pass it to sync to wait until the commit
+     ** is durable. */
+    [[nodiscard]] auto commit(Batch &batch) noexcept -> Lsn;
+
+    /** Wait until everything up to lsn is on stable storage. When the write
+     ** or the fdatasync fails, the log file is truncated back to its durable
+     ** end and the records are kept, so a later sync writes them again. If
+     ** the truncate fails too, every later sync fails. */
+    [[nodiscard]] auto sync(Lsn lsn) noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Copy the logged image of page_num into buffer, returns false if the
+     ** page has not been logged since the last checkpoint. */
+    [[nodiscard]] auto read(page::Page_num page_num, std::span<uint8_t> buffer) const noexcept
+      -> bool;
+
+    /** The logged image of page_num, or nullptr. The pointer is valid until
+     ** the page is logged again or the log is checkpointed. */
+    [[nodiscard]] auto find(page::Page_num page_num) const noexcept
+      -> const std::vector<uint8_t> *;
+
+    /** The number of distinct pages logged since the last checkpoint. */
+    [[nodiscard]] auto size() const noexcept -> size_t;
+
+    /** Sync the log, write the logged pages into storage in page order, sync
+     ** it and empty the log. No commit must be appended meanwhile. */
+    [[nodiscard]] auto checkpoint(storage::Storage &storage) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    /** Replay the committed records found in the log file into storage, and
+     ** empty the log. Records after the last valid commit record belong to an
+     ** unfinished commit and are discarded. */
+    [[nodiscard]] auto recover(storage::Storage &storage) noexcept
+      -> tl::expected<std::nullptr_t, Error>;
+
+    [[nodiscard]] auto get_statistics() const noexcept -> Statistics;
+
+  private:
+    /** Append a record to records, returns the offset of its payload. */
+    static auto append_record(
+      std::vector<uint8_t>    &records,
+      Record_type              type,
+      page::Page_num           page_num,
+      std::span<const uint8_t> payload) noexcept -> size_t;
+
+    [[nodiscard]] auto truncate() noexcept -> tl::expected<std::nullptr_t, Error>;
+
+    /** Undo a failed write of pending, called with the mutex held. */
+    auto restore(std::span<const uint8_t> pending, const std::string &error) noexcept -> void;
+  };
+} // namespace toocal::core::write_ahead_log
+
+#endif /* TOOCAL_CORE_WRITE_AHEAD_LOG_H */
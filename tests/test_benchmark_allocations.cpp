@@ -0,0 +1,156 @@
+#include "arena.h"
+#include "data_access_layer.h"
+#include "collection.h"
+#include "transaction.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <numeric>
+#include <random>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+
+/* GCC does not see that free matches the malloc of the replaced operator
+ * new once both are inlined. */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+/* Every allocation of the process goes through these, they are counted. */
+static auto allocations = std::atomic<uint64_t>{0};
+
+auto operator new(const size_t size) -> void *
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto * pointer = std::malloc(size == 0 ? 1 : size); pointer != nullptr)
+    return pointer;
+  throw std::bad_alloc{};
+}
+
+auto operator new[](const size_t size) -> void * { return operator new(size); }
+
+auto operator delete(void * pointer) noexcept -> void { std::free(pointer); }
+auto operator delete(void * pointer, size_t) noexcept -> void { std::free(pointer); }
+auto operator delete[](void * pointer) noexcept -> void { std::free(pointer); }
+auto operator delete[](void * pointer, size_t) noexcept -> void { std::free(pointer); }
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 20000, batch_size = 1000;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  const auto key = [](const uint32_t i) {
+    const auto key = fmt::format("Key{:07}", i);
+    return std::vector<uint8_t>{key.begin(), key.end()};
+  };
+
+  /* A scope frees what was allocated in it, the next scopes reuse the
+   * chunks without allocating. */
+  {
+    auto arena = arena::Arena{};
+    for (uint32_t round = 0; round < 3; round++)
+      {
+        const auto round_allocations = allocations.load();
+        const auto scope = arena::Arena::Scope{arena};
+        for (uint32_t i = 0; i < 100; i++)
+          if (!std::ranges::equal(arena.copy(key(i)), key(i)))
+            fatal("a copy in the arena differs from its bytes");
+
+        const auto large = arena.allocate<uint64_t>(arena::Arena::CHUNK_SIZE);
+        if (std::ranges::any_of(large, [](const auto value) { return value != 0; }))
+          fatal("the objects of the arena were not value initialized");
+
+        /* Only the chunks of the first round and the keys compared. */
+        if (round > 0 && allocations.load() - round_allocations != 200)
+          fatal(fmt::format("the round {} allocated chunks again", round));
+      }
+
+    if (arena.size() != 0)
+      fatal("the arena was not freed at the end of the scopes");
+  }
+
+  for (const auto & [name, options] :
+       {std::pair{"BEST_FILE_SIZE", builtin_options::BEST_FILE_SIZE},
+        std::pair{"BEST_PERFORMANCE", builtin_options::BEST_PERFORMANCE}})
+    {
+      std::filesystem::remove(path);
+      auto dal = Data_access_layer{path, options};
+      auto collection = Collection{&dal, {'c'}, 0};
+
+      auto order = std::vector<uint32_t>(data_size);
+      std::iota(order.begin(), order.end(), 0);
+      std::shuffle(order.begin(), order.end(), std::mt19937{42});
+
+      /* The keys and values are built before counting, put takes them. */
+      auto keys = std::vector<std::vector<uint8_t>>{}, values = std::vector<std::vector<uint8_t>>{};
+      for (const auto i : order)
+        {
+          keys.push_back(key(i));
+          values.push_back(key(i));
+        }
+
+      /* The keys are inserted in batches of one transaction each. */
+      const auto put_allocations = allocations.load();
+      const auto put_start_time = std::chrono::high_resolution_clock::now();
+      for (uint32_t first = 0; first < data_size; first += batch_size)
+        {
+          auto transaction = transaction::Transaction{&dal};
+          for (auto i = first; i < first + batch_size; i++)
+            collection.put(std::move(keys[i]), std::move(values[i])).map_error([&](const auto && error) {
+              return error.panic();
+            });
+
+          transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+        }
+      const auto put_end_time = std::chrono::high_resolution_clock::now();
+      const auto puts = allocations.load() - put_allocations;
+
+      /* The same keys are replaced, one transaction per put. */
+      const auto update_allocations = allocations.load();
+      for (uint32_t i = 0; i < batch_size; i++)
+        collection.put(key(order[i]), key(i)).map_error([&](const auto && error) { return error.panic(); });
+      const auto updates = allocations.load() - update_allocations - 2 * batch_size;
+
+      const auto find_keys = [&] {
+        auto keys = std::vector<std::vector<uint8_t>>{};
+        for (uint32_t i = 0; i < data_size; i++)
+          keys.push_back(key(i));
+        return keys;
+      }();
+
+      const auto find_allocations = allocations.load();
+      const auto find_start_time = std::chrono::high_resolution_clock::now();
+      for (const auto & key : find_keys)
+        collection.find(key)
+          .map([&](const auto && item) {
+            if (item == tl::nullopt)
+              fatal(fmt::format("{} was not found", std::string{key.begin(), key.end()}));
+          })
+          .map_error([&](const auto && error) { return error.panic(); });
+      const auto find_end_time = std::chrono::high_resolution_clock::now();
+      const auto finds = allocations.load() - find_allocations;
+
+      /* A put decodes no node unless it splits a leaf, and a find only
+       * allocates the item it returns. */
+      if (puts > 64 * data_size || finds != 2 * data_size)
+        fatal(fmt::format("{} allocations for {} puts, {} for as many finds", puts, data_size, finds));
+
+      spdlog::info(
+        "{}: {:.2f} allocations per put in {}ms, {:.2f} per put in its own transaction, {:.2f} per find in {}ms",
+        name,
+        static_cast<double>(puts) / data_size,
+        std::chrono::duration_cast<std::chrono::milliseconds>(put_end_time - put_start_time).count(),
+        static_cast<double>(updates) / batch_size,
+        static_cast<double>(finds) / data_size,
+        std::chrono::duration_cast<std::chrono::milliseconds>(find_end_time - find_start_time).count());
+
+      std::filesystem::remove(dal.path);
+      dal.close();
+    }
+
+  return 0;
+}
@@ -0,0 +1,149 @@
+#include "errors.hpp"
+#include "utils.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+using namespace toocal::core;
+using utils::Safecmp;
+
+/* The byte loop bytescmp used before the differing byte was searched in chunks. */
+static auto byte_loop_bytescmp(std::span<const uint8_t> k1, std::span<const uint8_t> k2) -> int
+{
+  size_t minSize = std::min(k1.size(), k2.size());
+  for (size_t i = 0; i < minSize; ++i)
+    if (k1[i] != k2[i])
+      return k1[i] < k2[i] ? -1 : 1;
+  return k1.size() < k2.size() ? -1 : (k1.size() > k2.size() ? 1 : 0);
+}
+
+static auto byte_loop_memcmp(const std::string & k1, const std::string & k2) -> int
+{
+  size_t minSize = std::min(k1.size(), k2.size());
+  for (size_t i = 0; i < minSize; ++i)
+    if (k1[i] != k2[i])
+      return k1[i] < k2[i] ? -1 : 1;
+  return k1.size() < k2.size() ? -1 : (k1.size() > k2.size() ? 1 : 0);
+}
+
+template <typename Tp_compare> static auto measure(const uint32_t compares, Tp_compare && compare) -> double
+{
+  const auto start_time = std::chrono::high_resolution_clock::now();
+  for (uint32_t i = 0; i < compares; i++)
+    compare(i);
+  const auto end_time = std::chrono::high_resolution_clock::now();
+
+  return static_cast<double>(
+           std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count())
+         / compares;
+}
+
+int main(int argc, char ** argv)
+{
+  const auto compares = 2000000, pairs_count = 1024;
+  auto       random = std::mt19937{42};
+
+  auto simds = std::vector<std::pair<const char *, Safecmp::Simd>>{{"scalar", Safecmp::Simd::NONE}};
+  if (Safecmp::supports(Safecmp::Simd::SSE2))
+    simds.emplace_back("sse2", Safecmp::Simd::SSE2);
+  if (Safecmp::supports(Safecmp::Simd::AVX2))
+    simds.emplace_back("avx2", Safecmp::Simd::AVX2);
+
+  /* Keys of size drawn from a distribution, the second key of every pair
+   * is a copy of the first with a byte changed past a common prefix, or
+   * truncated, or extended, all bytes over the whole range. */
+  const auto make_pairs = [&](std::uniform_int_distribution<size_t> sizes) {
+    auto pairs = std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>>{};
+    auto bytes = std::uniform_int_distribution<uint32_t>(0, 255);
+
+    for (uint32_t i = 0; i < pairs_count; i++)
+      {
+        auto k1 = std::vector<uint8_t>(sizes(random));
+        std::ranges::generate(k1, [&] { return static_cast<uint8_t>(bytes(random)); });
+
+        auto k2 = k1;
+        switch (random() % 4)
+          {
+          case 0:
+            if (!k2.empty())
+              k2[std::uniform_int_distribution<size_t>(k2.size() / 2, k2.size() - 1)(random)] ^=
+                static_cast<uint8_t>(1 + bytes(random) % 255);
+            break;
+          case 1:
+            k2.resize(std::uniform_int_distribution<size_t>(0, k2.size())(random));
+            break;
+          case 2:
+            k2.push_back(static_cast<uint8_t>(bytes(random)));
+            break;
+          default:
+            break;
+          }
+
+        if (random() % 2)
+          std::swap(k1, k2);
+        pairs.emplace_back(std::move(k1), std::move(k2));
+      }
+
+    return pairs;
+  };
+
+  const auto distributions = {
+    std::make_tuple("8 bytes", std::uniform_int_distribution<size_t>(8, 8)),
+    std::make_tuple("16 bytes", std::uniform_int_distribution<size_t>(16, 16)),
+    std::make_tuple("32 bytes", std::uniform_int_distribution<size_t>(32, 32)),
+    std::make_tuple("64 bytes", std::uniform_int_distribution<size_t>(64, 64)),
+    std::make_tuple("256 bytes", std::uniform_int_distribution<size_t>(256, 256)),
+    std::make_tuple("0 to 100 bytes", std::uniform_int_distribution<size_t>(0, 100))};
+
+  for (const auto & [name, sizes] : distributions)
+    {
+      const auto pairs = make_pairs(sizes);
+
+      /* Every implementation orders the keys like the byte loop, and so does
+       * memcmp with char, which may be signed. */
+      for (const auto & [k1, k2] : pairs)
+        {
+          const auto expected = byte_loop_bytescmp(k1, k2);
+          if (Safecmp::bytescmp(k1, k2) != expected)
+            fatal(fmt::format("{}: bytescmp disagrees with the byte loop", name));
+
+          for (const auto & [simd_name, simd] : simds)
+            {
+              const auto i = Safecmp::mismatch(k1, k2, simd);
+              const auto order = i < std::min(k1.size(), k2.size())
+                                   ? (k1[i] < k2[i] ? -1 : 1)
+                                   : (k1.size() < k2.size() ? -1 : (k1.size() > k2.size() ? 1 : 0));
+              if (order != expected)
+                fatal(fmt::format("{}: the {} mismatch disagrees with the byte loop", name, simd_name));
+            }
+
+          const auto s1 = std::string{k1.begin(), k1.end()}, s2 = std::string{k2.begin(), k2.end()};
+          if (Safecmp::memcmp(s1, s2) != byte_loop_memcmp(s1, s2))
+            fatal(fmt::format("{}: memcmp disagrees with the byte loop", name));
+        }
+
+      int64_t    sum = 0;
+      const auto byte_loop_time =
+        measure(compares, [&](const auto i) {
+          sum += byte_loop_bytescmp(pairs[i % pairs_count].first, pairs[i % pairs_count].second);
+        });
+
+      auto times = std::string{};
+      for (const auto & [simd_name, simd] : simds)
+        times += fmt::format(
+          ", {} {:.1f}ns",
+          simd_name,
+          measure(compares, [&](const auto i) {
+            sum += Safecmp::mismatch(pairs[i % pairs_count].first, pairs[i % pairs_count].second, simd);
+          }));
+
+      spdlog::info("{}: byte loop {:.1f}ns{} ({})", name, byte_loop_time, times, sum);
+    }
+
+  spdlog::info(
+    "bytescmp uses {}",
+    Safecmp::simd() == Safecmp::Simd::AVX2   ? "avx2"
+    : Safecmp::simd() == Safecmp::Simd::SSE2 ? "sse2"
+                                             : "the scalar fallback");
+  return 0;
+}
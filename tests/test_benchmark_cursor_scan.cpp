@@ -0,0 +1,74 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "cursor.h"
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::cursor;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 1000000;
+  const auto collection_name = std::string{"collection1"};
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  std::filesystem::remove(path);
+
+  auto items = std::vector<node::Item>{};
+  items.reserve(data_size);
+  for (uint32_t i = 0; i < data_size; i++)
+    {
+      const auto key = fmt::format("Key{:07}", i), value = fmt::format("Value{}", i);
+      items.push_back(node::Item{{key.begin(), key.end()}, {value.begin(), value.end()}});
+    }
+
+  /* Load, then reopen with a cold page cache. */
+  auto root = Page_num{};
+  {
+    auto dal = Data_access_layer{path, builtin_options::BEST_FILE_SIZE};
+    auto collection = Collection{
+      &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, dal.meta.root};
+
+    collection.bulk_load(items.begin(), items.end())
+      .map_error([&](const auto && error) { return error.panic(); });
+    root = collection.root;
+  }
+
+  auto dal = Data_access_layer{path, builtin_options::BEST_FILE_SIZE};
+  auto collection =
+    Collection{&dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, root};
+
+  auto       cursor = Cursor{&collection};
+  uint64_t   scanned = 0;
+  const auto scan_start_time = std::chrono::high_resolution_clock::now();
+  for (auto valid = cursor.first().value(); valid; valid = cursor.next().value())
+    {
+      if (!std::ranges::equal(cursor.key(), items[scanned].key))
+        fatal(fmt::format("the scan is out of order at {}", scanned));
+      scanned++;
+    }
+  const auto scan_end_time = std::chrono::high_resolution_clock::now();
+
+  if (scanned != data_size)
+    fatal(fmt::format("the scan visited {} of {} items", scanned, data_size));
+
+  const auto lookup_start_time = std::chrono::high_resolution_clock::now();
+  for (const auto & item : items)
+    collection.find(item.key).map_error([&](const auto && error) { return error.panic(); });
+  const auto lookup_end_time = std::chrono::high_resolution_clock::now();
+
+  spdlog::info(
+    "{} items: cursor scan {}ms ({} pages prefetched), point lookups {}ms",
+    data_size,
+    std::chrono::duration_cast<std::chrono::milliseconds>(scan_end_time - scan_start_time).count(),
+    dal.statistics.pages_prefetched,
+    std::chrono::duration_cast<std::chrono::milliseconds>(lookup_end_time - lookup_start_time)
+      .count());
+
+  std::filesystem::remove(dal.path);
+  dal.close();
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include "data_access_layer.h"
+#include "node.h"
+#include "utils.h"
+#include <random>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::node;
+using namespace toocal::core::page;
+
+/* The linear scan find_key_in_node used before it was switched to binary search. */
+static auto linear_find_key_in_node(const Node & node, const std::vector<uint8_t> & key)
+  -> std::tuple<bool, uint32_t>
+{
+  for (uint32_t index = 0; const auto & item : node.items)
+    {
+      const auto compare_result = utils::Safecmp::bytescmp(item.key, key);
+      if (compare_result == 0)
+        return {true, index};
+      if (compare_result == 1)
+        return {false, index};
+      ++index;
+    }
+  return {false, static_cast<uint32_t>(node.items.size())};
+}
+
+/* A leaf filled with sorted items up to the maximum fill of the options, or
+ * of the page. */
+static auto fill_node(const Options & options) -> Node
+{
+  auto       node = Node{std::deque<Item>{}, std::deque<Page_num>{}};
+  const auto max_threshold = options.max_fill_percent * static_cast<float>(options.page_size);
+
+  for (uint32_t i = 0; static_cast<float>(node.size()) <= max_threshold; i++)
+    {
+      const auto key = fmt::format("Key{:08}", i * 2);
+      const auto value = fmt::format("Value{}", i * 2);
+      node.items.push_back(
+        Item{std::vector<uint8_t>{key.begin(), key.end()}, {value.begin(), value.end()}});
+
+      if (node.serialized_size() > options.page_size)
+        {
+          node.items.pop_back();
+          break;
+        }
+    }
+
+  return node;
+}
+
+template <typename Tp_find> static auto measure(const uint32_t lookups, Tp_find && find) -> double
+{
+  const auto start_time = std::chrono::high_resolution_clock::now();
+  for (uint32_t i = 0; i < lookups; i++)
+    find(i);
+  const auto end_time = std::chrono::high_resolution_clock::now();
+
+  return static_cast<double>(
+           std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count())
+         / lookups;
+}
+
+int main(int argc, char ** argv)
+{
+  const auto lookups = 1000000;
+  const auto presets = {
+    std::make_tuple("BALANCE", builtin_options::BALANCE),
+    std::make_tuple("BEST_FILE_SIZE", builtin_options::BEST_FILE_SIZE),
+    std::make_tuple("BEST_PERFORMANCE", builtin_options::BEST_PERFORMANCE)};
+
+  for (const auto & [name, options] : presets)
+    {
+      const auto node = fill_node(options);
+      const auto page = types::Serializer<Node>::serialize(node, options.page_size)
+                          .map_error([&](const auto && error) { return error.panic(); })
+                          .value();
+      const auto view = Node_view{page};
+
+      /* Both present (even) and absent (odd) keys. */
+      auto keys = std::vector<std::vector<uint8_t>>{};
+      auto random = std::mt19937{42};
+      auto distribution = std::uniform_int_distribution<uint32_t>(0, node.items.size() * 2);
+      for (uint32_t i = 0; i < 1024; i++)
+        {
+          const auto key = fmt::format("Key{:08}", distribution(random));
+          keys.emplace_back(key.begin(), key.end());
+        }
+
+      for (const auto & key : keys)
+        if (
+          linear_find_key_in_node(node, key) != node.find_key_in_node(key)
+          || node.find_key_in_node(key) != view.find_key_in_node(key))
+          fatal(fmt::format("{}: searches disagree", name));
+
+      uint64_t   found = 0;
+      const auto linear_time =
+        measure(lookups, [&](const auto i) { found += std::get<0>(linear_find_key_in_node(node, keys[i % 1024])); });
+      const auto binary_time =
+        measure(lookups, [&](const auto i) { found += std::get<0>(node.find_key_in_node(keys[i % 1024])); });
+      const auto view_time =
+        measure(lookups, [&](const auto i) { found += std::get<0>(view.find_key_in_node(keys[i % 1024])); });
+
+      spdlog::info(
+        "{}: {} items per page, linear {:.1f}ns, binary {:.1f}ns, binary on Node_view {:.1f}ns ({} found)",
+        name,
+        node.items.size(),
+        linear_time,
+        binary_time,
+        view_time,
+        found);
+    }
+
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = uint32_t{20000}, rounds = uint32_t{20};
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  const auto key = [](const uint32_t i) {
+    const auto key = fmt::format("Key{:07}", i);
+    return std::vector<uint8_t>{key.begin(), key.end()};
+  };
+
+  /* Every 97th value is stored in an overflow chain. */
+  const auto value = [&](const uint32_t i) { return i % 97 == 0 ? std::vector<uint8_t>(5000, i % 256) : key(i); };
+
+  for (const auto & [name, fill_percent] : {std::pair{"BALANCE", 0.025f}, std::pair{"BEST_PERFORMANCE", 0.125f}})
+    {
+      /* Without page cache every page of a descent is read from the file. */
+      const auto options = Options{
+        .page_size = Page::DEFAULT_PAGE_SIZE,
+        .min_fill_percent = fill_percent / 2,
+        .max_fill_percent = fill_percent,
+        .page_cache_capacity = 0};
+
+      std::filesystem::remove(path);
+      auto dal = Data_access_layer{path, options};
+      auto collection = Collection{&dal, {'c'}, 0};
+
+      /* The even keys are stored, the odd ones are missing. */
+      uint32_t next = 0;
+      collection
+        .bulk_load([&]() -> tl::optional<node::Item> {
+          if (next >= data_size)
+            return tl::nullopt;
+          next += 2;
+          return node::Item{key(next - 2), value(next - 2)};
+        })
+        .map_error([&](const auto && error) { return error.panic(); });
+
+      auto random = std::mt19937{42};
+      for (const auto batch_size : {50u, 500u})
+        {
+          auto find_pages_read = uint64_t{}, find_many_pages_read = uint64_t{};
+          auto find_time = std::chrono::nanoseconds{}, find_many_time = std::chrono::nanoseconds{};
+
+          for (uint32_t round = 0; round < rounds; round++)
+            {
+              /* Unsorted keys, some missing and some repeated. */
+              auto keys = std::vector<std::vector<uint8_t>>{};
+              for (uint32_t i = 0; i < batch_size; i++)
+                keys.push_back(i % 10 == 9 ? keys[random() % i] : key(static_cast<uint32_t>(random() % data_size)));
+
+              auto expected = std::vector<tl::optional<node::Item>>{};
+              const auto find_start_pages_read = dal.statistics.pages_read;
+              const auto find_start_time = std::chrono::high_resolution_clock::now();
+              for (const auto & key : keys)
+                expected.push_back(collection.find(key).value());
+              find_time += std::chrono::high_resolution_clock::now() - find_start_time;
+              find_pages_read += dal.statistics.pages_read - find_start_pages_read;
+
+              const auto find_many_start_pages_read = dal.statistics.pages_read;
+              const auto find_many_start_time = std::chrono::high_resolution_clock::now();
+              const auto items = collection.find_many(keys).map_error([&](const auto && error) {
+                return error.panic();
+              });
+              find_many_time += std::chrono::high_resolution_clock::now() - find_many_start_time;
+              find_many_pages_read += dal.statistics.pages_read - find_many_start_pages_read;
+
+              for (uint32_t i = 0; i < batch_size; i++)
+                if (
+                  (items.value()[i] != tl::nullopt) != (expected[i] != tl::nullopt)
+                  || (expected[i] != tl::nullopt
+                      && (items.value()[i]->key != keys[i] || items.value()[i]->value != expected[i]->value)))
+                  fatal(fmt::format("find_many did not return the item of find for the key {}", i));
+            }
+
+          if (find_many_pages_read * 2 > find_pages_read)
+            fatal(fmt::format(
+              "find_many read {} pages for batches of {} keys, find {}", find_many_pages_read, batch_size, find_pages_read));
+
+          spdlog::info(
+            "{}: batches of {} keys, find reads {:.1f} pages in {}us, find_many {:.1f} pages in {}us",
+            name,
+            batch_size,
+            static_cast<double>(find_pages_read) / rounds,
+            std::chrono::duration_cast<std::chrono::microseconds>(find_time).count() / rounds,
+            static_cast<double>(find_many_pages_read) / rounds,
+            std::chrono::duration_cast<std::chrono::microseconds>(find_many_time).count() / rounds);
+        }
+
+      if (!collection.find_many({}).value().empty())
+        fatal("find_many returned items for no keys");
+
+      std::filesystem::remove(dal.path);
+      dal.close();
+    }
+
+  return 0;
+}
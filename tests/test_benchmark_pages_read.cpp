@@ -0,0 +1,81 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 20000;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  const auto key = [](const uint32_t i) {
+    const auto key = fmt::format("Key{:07}", i);
+    return std::vector<uint8_t>{key.begin(), key.end()};
+  };
+
+  for (const auto & [name, fill_percent] : {std::pair{"BALANCE", 0.025f}, std::pair{"BEST_PERFORMANCE", 0.125f}})
+    {
+      /* Without page cache every page of a descent is read from the file,
+       * the pages written by an operation are committed before the next. */
+      const auto options = Options{
+        .page_size = Page::DEFAULT_PAGE_SIZE,
+        .min_fill_percent = fill_percent / 2,
+        .max_fill_percent = fill_percent,
+        .page_cache_capacity = 0};
+
+      std::filesystem::remove(path);
+      auto dal = Data_access_layer{path, options};
+      auto collection = Collection{&dal, {'c'}, 0};
+
+      auto order = std::vector<uint32_t>(data_size);
+      std::iota(order.begin(), order.end(), 0);
+      std::shuffle(order.begin(), order.end(), std::mt19937{42});
+
+      const auto put_pages_read = dal.statistics.pages_read;
+      const auto put_start_time = std::chrono::high_resolution_clock::now();
+      for (const auto i : order)
+        collection.put(key(i), key(i)).map_error([&](const auto && error) { return error.panic(); });
+      const auto put_end_time = std::chrono::high_resolution_clock::now();
+      const auto puts = static_cast<double>(dal.statistics.pages_read - put_pages_read) / data_size;
+
+      const auto depth = collection.descend(key(0)).value().nodes.size();
+
+      const auto remove_pages_read = dal.statistics.pages_read;
+      const auto remove_start_time = std::chrono::high_resolution_clock::now();
+      for (uint32_t i = 0; i < data_size / 2; i++)
+        collection.remove(key(order[i])).map_error([&](const auto && error) { return error.panic(); });
+      const auto remove_end_time = std::chrono::high_resolution_clock::now();
+      const auto removes = static_cast<double>(dal.statistics.pages_read - remove_pages_read) / (data_size / 2);
+
+      /* A put reads its descent once, the trees grow to depth while the
+       * items are inserted. A remove also reads the siblings it rebalances
+       * with. */
+      if (puts > static_cast<double>(depth) || removes > static_cast<double>(depth) + 1.5)
+        fatal(fmt::format("{:.2f} pages read per put and {:.2f} per remove in a tree of depth {}", puts, removes, depth));
+
+      for (uint32_t i = 0; i < data_size; i++)
+        if ((collection.find(key(order[i])).value() != tl::nullopt) != (i >= data_size / 2))
+          fatal(fmt::format("the item {} was not read back", order[i]));
+
+      spdlog::info(
+        "{}: depth {}, {:.2f} pages read per put in {}ms, {:.2f} per remove in {}ms",
+        name,
+        depth,
+        puts,
+        std::chrono::duration_cast<std::chrono::milliseconds>(put_end_time - put_start_time).count(),
+        removes,
+        std::chrono::duration_cast<std::chrono::milliseconds>(remove_end_time - remove_start_time).count());
+
+      std::filesystem::remove(dal.path);
+      dal.close();
+    }
+
+  return 0;
+}
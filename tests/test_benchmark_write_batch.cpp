@@ -0,0 +1,212 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "cursor.h"
+#include <chrono>
+#include <map>
+#include <random>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+static auto bytes(const std::string & string) -> std::vector<uint8_t> { return {string.begin(), string.end()}; }
+
+/** The items of collection, scanned forward and backward, are those of model. */
+static auto check(Collection & collection, const std::map<std::vector<uint8_t>, std::vector<uint8_t>> & model)
+  -> void
+{
+  auto cursor = cursor::Cursor{&collection};
+  auto expected = model.begin();
+  for (auto valid = cursor.first().value(); valid; valid = cursor.next().value(), expected++)
+    if (
+      expected == model.end() || !std::ranges::equal(cursor.key(), expected->first)
+      || !std::ranges::equal(cursor.value().value(), expected->second))
+      fatal("a forward scan does not match the items put");
+  if (expected != model.end())
+    fatal(fmt::format("a forward scan missed {} items", std::distance(expected, model.end())));
+
+  auto reversed = model.rbegin();
+  for (auto valid = cursor.last().value(); valid; valid = cursor.prev().value(), reversed++)
+    if (reversed == model.rend() || !std::ranges::equal(cursor.key(), reversed->first))
+      fatal("a backward scan does not match the items put");
+  if (reversed != model.rend())
+    fatal("a backward scan missed items");
+}
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 100000;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  /* Random batches of puts, updates and removes, with some values in
+   * overflow chains, applied to the same collection as they would be to a
+   * map. */
+  for (const auto & [name, options] :
+       {std::pair{"BALANCE", builtin_options::BALANCE},
+        std::pair{"BEST_FILE_SIZE", builtin_options::BEST_FILE_SIZE},
+        std::pair{
+          "COPY_ON_WRITE",
+          Options{
+            .page_size = Page::DEFAULT_PAGE_SIZE,
+            .min_fill_percent = 0.125f,
+            .max_fill_percent = 0.25f,
+            .copy_on_write = true}}})
+    {
+      std::filesystem::remove(path);
+      auto dal = Data_access_layer{path, options};
+      auto collection = Collection{&dal, {'c'}, 0};
+      auto batch = Write_batch{&collection};
+      auto model = std::map<std::vector<uint8_t>, std::vector<uint8_t>>{};
+      auto random = std::mt19937{42};
+
+      for (uint32_t round = 0; round < 8; round++)
+        {
+          const auto mutations = round == 0 ? 2000u : 50u + random() % (round * 1000);
+          for (uint32_t i = 0; i < mutations; i++)
+            {
+              const auto key = bytes(fmt::format("Key{:06}", random() % 20000));
+              if (random() % 4 == 0)
+                {
+                  batch.remove(key);
+                  model.erase(key);
+                  continue;
+                }
+
+              const auto value = random() % 50 == 0 ? std::vector<uint8_t>(3000, round)
+                                                    : bytes(fmt::format("Value{}-{}", round, i));
+              batch.put(key, value);
+              model[key] = value;
+            }
+
+          batch.commit().map_error([&](const auto && error) { return error.panic(); });
+          if (batch.size() != 0)
+            fatal("the batch was not emptied by commit");
+
+          check(collection, model);
+        }
+
+      batch.put(std::vector<uint8_t>(dal.max_key_size() + 1, 'k'), {});
+      if (batch.commit().has_value())
+        fatal("a key larger than the maximum was put");
+
+      spdlog::info("{}: {} items after the batches, {} pages", name, model.size(), dal.freelist.max_page);
+
+      std::filesystem::remove(dal.path);
+      dal.close();
+    }
+
+  /* The keys and values of cli/main.cpp, put one at a time, then in a
+   * batch into a new collection. */
+  auto keys = std::vector<std::vector<uint8_t>>{}, values = std::vector<std::vector<uint8_t>>{};
+  for (uint32_t i = 0; i < 2 * data_size; i++)
+    {
+      keys.push_back(bytes(fmt::format("Key{}", i)));
+      values.push_back(bytes(fmt::format("Value{}", i)));
+    }
+
+  const auto elapsed = [](const auto & start_time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time)
+      .count();
+  };
+
+  auto loop_time = int64_t{};
+  {
+    std::filesystem::remove(path);
+    auto dal = Data_access_layer{path};
+    auto collection = Collection{&dal, {'c'}, 0};
+
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < data_size; i++)
+      collection.put(keys[i], values[i]).map_error([&](const auto && error) { return error.panic(); });
+    loop_time = elapsed(start_time);
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  auto batch_time = int64_t{};
+  {
+    std::filesystem::remove(path);
+    auto dal = Data_access_layer{path};
+    auto collection = Collection{&dal, {'c'}, 0};
+    auto batch = Write_batch{&collection};
+
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < data_size; i++)
+      batch.put(keys[i], values[i]);
+    batch.commit().map_error([&](const auto && error) { return error.panic(); });
+    batch_time = elapsed(start_time);
+
+    for (uint32_t i = 0; i < data_size; i += 97)
+      if (collection.find(keys[i]).value()->value != values[i])
+        fatal(fmt::format("the item {} was not read back", i));
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  /* Then data_size mutations on a collection holding every other key: half
+   * of them put keys between the ones of the collection, the other half
+   * remove half of its keys. They are applied one at a time, then in a
+   * batch merged into the tree. */
+  const auto merge = [&](const bool batched) {
+    std::filesystem::remove(path);
+    auto dal = Data_access_layer{path};
+    auto collection = Collection{&dal, {'c'}, 0};
+    auto batch = Write_batch{&collection};
+
+    for (uint32_t i = 0; i < 2 * data_size; i += 2)
+      batch.put(keys[i], values[i]);
+    batch.commit().map_error([&](const auto && error) { return error.panic(); });
+
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < 2 * data_size; i++)
+      if (i % 4 == 1 && batched)
+        batch.put(keys[i], values[i]);
+      else if (i % 4 == 1)
+        collection.put(keys[i], values[i]).map_error([&](const auto && error) { return error.panic(); });
+      else if (i % 4 == 2 && batched)
+        batch.remove(keys[i]);
+      else if (i % 4 == 2)
+        collection.remove(keys[i]).map_error([&](const auto && error) { return error.panic(); });
+    if (batched)
+      batch.commit().map_error([&](const auto && error) { return error.panic(); });
+    const auto time = elapsed(start_time);
+
+    for (uint32_t i = 0; i < 2 * data_size; i += 97)
+      if ((collection.find(keys[i]).value() != tl::nullopt) != (i % 4 < 2))
+        fatal(fmt::format("the item {} should {}exist after the mutations", i, i % 4 < 2 ? "" : "not "));
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+    return time;
+  };
+  const auto merge_loop_time = merge(false), merge_time = merge(true);
+
+  /* A batch into a new collection is bulk loaded. Merged into an existing
+   * tree, each leaf is rewritten once for all the mutations falling in it,
+   * but the leaves split still go through Node, and the pages staged are
+   * as many as the leaves: the merge is about 4 times as fast. */
+  if (5 * batch_time > loop_time || 3 * merge_time > merge_loop_time)
+    fatal(fmt::format(
+      "{} puts took {}ms one at a time, {}ms in a batch, {} mutations of a tree {}ms one at a time, {}ms in a batch",
+      data_size,
+      loop_time,
+      batch_time,
+      data_size,
+      merge_loop_time,
+      merge_time));
+
+  spdlog::info(
+    "{} puts: {}ms one at a time, {}ms in a batch into a new collection, {} mutations of a tree: {}ms one at a "
+    "time, {}ms in a batch",
+    data_size,
+    loop_time,
+    batch_time,
+    data_size,
+    merge_loop_time,
+    merge_time);
+
+  return 0;
+}
@@ -35,6 +35,8 @@ int main(int argc, char ** argv)
         .map_error([&](const auto && error) { return error.panic(); });
     }
 
+  /* The page cache holds the pages until they are written back. */
+  dal.flush().map_error([&](const auto && error) { return error.panic(); });
   spdlog::info("file size: {}KB", utils::Filesystem::sizeof_file(dal.path));
   std::filesystem::remove(dal.path);
 
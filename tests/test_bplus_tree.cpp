@@ -0,0 +1,117 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "cursor.h"
+#include "transaction.h"
+#include <map>
+#include <random>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 10000, batch_size = 1000;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  for (const auto copy_on_write : {false, true})
+    {
+      std::filesystem::remove(path);
+      auto dal = Data_access_layer{
+        path,
+        Options{
+          .page_size = Page::DEFAULT_PAGE_SIZE,
+          .min_fill_percent = 0.125f,
+          .max_fill_percent = 0.125f,
+          .copy_on_write = copy_on_write}};
+      auto collection = Collection{&dal, {'c'}, 0};
+
+      /* Random puts and removes, committed in batches so the copies of the
+       * leaves move away from their committed neighbors. */
+      auto keys = std::map<std::string, std::string>{};
+      auto random = std::mt19937{7};
+      for (uint32_t first = 0; first < data_size * 3; first += batch_size)
+        {
+          auto transaction = transaction::Transaction{&dal};
+          for (uint32_t i = first; i < first + batch_size; i++)
+            {
+              const auto key = fmt::format("Key{:05}", random() % data_size);
+              if (random() % 3 == 0 && keys.contains(key))
+                {
+                  collection.remove({key.begin(), key.end()}).map_error([&](const auto && error) {
+                    return error.panic();
+                  });
+                  keys.erase(key);
+                }
+              else
+                {
+                  const auto value = fmt::format("Value{}", i);
+                  collection.put({key.begin(), key.end()}, {value.begin(), value.end()})
+                    .map_error([&](const auto && error) { return error.panic(); });
+                  keys.insert_or_assign(key, value);
+                }
+            }
+
+          transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+        }
+
+      /* The leaves in tree order, the internal nodes only hold keys. */
+      auto leaves = std::vector<Page_num>{};
+      const auto walk = [&](const auto & walk, const Page_num page_num) -> void {
+        const auto node = dal.get_node(page_num).value();
+        if (node.is_leaf())
+          {
+            leaves.push_back(page_num);
+            return;
+          }
+
+        for (const auto & item : node.items)
+          if (!item.value.empty())
+            fatal(fmt::format("the internal node {} holds a value", page_num));
+
+        for (const auto child : node.children)
+          walk(walk, child);
+      };
+      walk(walk, collection.root);
+
+      /* The links go through the same leaves, in both directions, and the
+       * items are all in the leaves. Copy on write does not keep the links. */
+      auto expected = keys.begin();
+      for (size_t i = 0; i < leaves.size(); i++)
+        {
+          const auto node = dal.get_node(leaves[i]).value();
+          if (
+            !copy_on_write
+            && (node.prev != (i == 0 ? 0 : leaves[i - 1]) || node.next != (i + 1 == leaves.size() ? 0 : leaves[i + 1])))
+            fatal(fmt::format("the leaf {} is not linked to its neighbors", leaves[i]));
+
+          for (const auto & item : node.items)
+            if (
+              expected == keys.end() || !std::ranges::equal(item.key, expected->first)
+              || !std::ranges::equal(item.value, (expected++)->second))
+              fatal("the leaves do not hold the items in key order");
+        }
+
+      if (expected != keys.end())
+        fatal("the leaves miss items");
+
+      /* A cursor crosses the leaves through their links, or their parents
+       * with copy on write. */
+      auto cursor = cursor::Cursor{&collection};
+      auto count = size_t{0};
+      for (auto valid = cursor.last().value(); valid; valid = cursor.prev().value())
+        count++;
+
+      if (count != keys.size())
+        fatal(fmt::format("the cursor visited {} keys instead of {}", count, keys.size()));
+
+      spdlog::info(
+        "{} keys in {} leaves, copy on write {}", keys.size(), leaves.size(), copy_on_write);
+
+      std::filesystem::remove(dal.path);
+      dal.close();
+    }
+
+  return 0;
+}
@@ -0,0 +1,113 @@
+#include "data_access_layer.h"
+#include "collection.h"
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 100000;
+  const auto collection_name = std::string{"collection1"};
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  auto items = std::vector<node::Item>{};
+  items.reserve(data_size);
+  for (uint32_t i = 0; i < data_size; i++)
+    {
+      const auto key = fmt::format("Key{:06}", i), value = fmt::format("Value{}", i);
+      items.push_back(node::Item{{key.begin(), key.end()}, {value.begin(), value.end()}});
+    }
+
+  const auto check = [&](const Collection & collection) {
+    for (const auto & expected : items)
+      {
+        collection.find(expected.key)
+          .map([&](const auto && item) {
+            if (item == tl::nullopt || item.value().value != expected.value)
+              fatal(fmt::format(
+                "{} was not loaded", std::string{expected.key.begin(), expected.key.end()}));
+          })
+          .map_error([&](const auto && error) { return error.panic(); });
+      }
+  };
+
+  std::filesystem::remove(path);
+
+  /* Load through put, one key at a time. */
+  int64_t  put_time = 0;
+  uint64_t put_pages = 0;
+  {
+    auto dal = Data_access_layer{path};
+    auto collection = Collection{
+      &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, dal.meta.root};
+
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    for (const auto & item : items)
+      collection.put(item.key, item.value).map_error([&](const auto && error) { return error.panic(); });
+    put_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::high_resolution_clock::now() - start_time)
+                 .count();
+    put_pages = dal.freelist.max_page + 1;
+
+    std::filesystem::remove(dal.path);
+  }
+
+  {
+    auto dal = Data_access_layer{path};
+    auto collection = Collection{
+      &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, dal.meta.root};
+
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    collection.bulk_load(items.begin(), items.end())
+      .map_error([&](const auto && error) { return error.panic(); });
+    const auto bulk_load_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                  std::chrono::high_resolution_clock::now() - start_time)
+                                  .count();
+    const auto bulk_load_pages = dal.freelist.max_page + 1;
+
+    spdlog::info(
+      "{} items: put {}ms and {} pages, bulk_load {}ms and {} pages",
+      data_size,
+      put_time,
+      put_pages,
+      bulk_load_time,
+      bulk_load_pages);
+
+    if (bulk_load_pages >= put_pages)
+      fatal("bulk_load should pack the pages better than put");
+
+    check(collection);
+
+    /* The loaded tree is an ordinary tree. */
+    for (uint32_t i = 0; i < data_size; i += 2)
+      collection.remove(items[i].key).map_error([&](const auto && error) { return error.panic(); });
+    for (uint32_t i = 0; i < data_size; i += 2)
+      collection.put(items[i].key, items[i].value)
+        .map_error([&](const auto && error) { return error.panic(); });
+
+    check(collection);
+
+    if (collection.bulk_load(items.begin(), items.end()).has_value())
+      fatal("bulk_load into a non-empty collection should fail");
+
+    std::filesystem::remove(dal.path);
+  }
+
+  /* Unsorted input is rejected. */
+  {
+    auto dal = Data_access_layer{path};
+    auto collection = Collection{
+      &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, dal.meta.root};
+
+    std::swap(items[10], items[20]);
+    if (collection.bulk_load(items.begin(), items.end()).has_value())
+      fatal("bulk_load of unsorted items should fail");
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  return 0;
+}
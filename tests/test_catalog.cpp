@@ -0,0 +1,152 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "snapshot.h"
+#include "transaction.h"
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+static auto bytes(const std::string & string) -> std::vector<uint8_t> { return {string.begin(), string.end()}; }
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 2000;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+  const auto names = std::vector<std::string>{"users", "orders", "items"};
+
+  const auto key = [](const uint32_t i) { return bytes(fmt::format("Key{:05}", i)); };
+  const auto value = [](const std::string & name, const uint32_t i) { return bytes(fmt::format("{}{}", name, i)); };
+
+  const auto check = [&](Data_access_layer & dal, const std::string & name, const uint32_t count) {
+    const auto collection = dal.get_collection(bytes(name)).map_error([&](const auto && error) {
+      return error.panic();
+    });
+    if (collection.value() == nullptr)
+      fatal(fmt::format("the collection {} was not found", name));
+
+    for (uint32_t i = 0; i < data_size; i++)
+      collection.value()->find(key(i))
+        .map([&](const auto && item) {
+          if ((item != tl::nullopt) != (i < count) || (item != tl::nullopt && item->value != value(name, i)))
+            fatal(fmt::format("the item {} of {} was not read back", i, name));
+        })
+        .map_error([&](const auto && error) { return error.panic(); });
+  };
+
+  for (const auto copy_on_write : {false, true})
+    {
+      const auto options = Options{
+        .page_size = Page::DEFAULT_PAGE_SIZE,
+        .min_fill_percent = 0.125f,
+        .max_fill_percent = 0.125f,
+        .copy_on_write = copy_on_write};
+
+      std::filesystem::remove(path);
+
+      /* The collections are filled one put per transaction, and in one
+       * transaction for the last one. */
+      {
+        auto dal = Data_access_layer{path, options};
+        for (const auto & name : names)
+          dal.create_collection(bytes(name)).map_error([&](const auto && error) { return error.panic(); });
+
+        if (dal.create_collection(bytes(names[0])).has_value())
+          fatal("a collection was created twice");
+
+        for (uint32_t i = 0; i < data_size; i++)
+          for (const auto & name : {names[0], names[1]})
+            dal.get_collection(bytes(name))
+              .and_then([&](auto * collection) { return collection->put(key(i), value(name, i)); })
+              .map_error([&](const auto && error) { return error.panic(); });
+
+        {
+          auto transaction = transaction::Transaction{&dal};
+          auto * collection = dal.get_collection(bytes(names[2])).value();
+          for (uint32_t i = 0; i < data_size; i++)
+            collection->put(key(i), value(names[2], i)).map_error([&](const auto && error) { return error.panic(); });
+          transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+        }
+
+        /* The same collection is returned every time. */
+        if (dal.get_collection(bytes(names[0])).value() != dal.get_collection(bytes(names[0])).value())
+          fatal("a collection was opened twice");
+
+        if (dal.get_collection(bytes("missing")).value() != nullptr)
+          fatal("a missing collection was found");
+
+        /* A rolled back transaction leaves the root in the catalog. */
+        {
+          auto transaction = transaction::Transaction{&dal};
+          auto * collection = dal.get_collection(bytes(names[1])).value();
+          for (uint32_t i = data_size; i < 2 * data_size; i++)
+            collection->put(key(i), value(names[1], i)).map_error([&](const auto && error) { return error.panic(); });
+        }
+
+        if (copy_on_write)
+          {
+            auto snapshot = snapshot::Snapshot{*dal.get_collection(bytes(names[0])).value()};
+            dal.get_collection(bytes(names[0]))
+              .and_then([&](auto * collection) { return collection->remove(key(0)); })
+              .map_error([&](const auto && error) { return error.panic(); });
+
+            if (snapshot.find(key(0)).value() == tl::nullopt)
+              fatal("the snapshot lost the item removed after it was taken");
+
+            dal.get_collection(bytes(names[0]))
+              .and_then([&](auto * collection) { return collection->put(key(0), value(names[0], 0)); })
+              .map_error([&](const auto && error) { return error.panic(); });
+          }
+      }
+
+      /* The roots were written to the catalog with the pages. */
+      auto max_page = Page_num{};
+      {
+        auto dal = Data_access_layer{path, options};
+        for (const auto & name : names)
+          check(dal, name, data_size);
+
+        dal.drop_collection(bytes(names[1])).map_error([&](const auto && error) { return error.panic(); });
+        if (dal.get_collection(bytes(names[1])).value() != nullptr)
+          fatal("a dropped collection was found");
+        if (dal.drop_collection(bytes(names[1])).has_value())
+          fatal("a collection was dropped twice");
+
+        max_page = dal.freelist.max_page;
+      }
+
+      /* The pages of the dropped collection are reused by a new one. */
+      {
+        auto dal = Data_access_layer{path, options};
+        check(dal, names[0], data_size);
+        check(dal, names[2], data_size);
+        if (dal.get_collection(bytes(names[1])).value() != nullptr)
+          fatal("a dropped collection was found after reopening");
+
+        auto * collection = dal.create_collection(bytes(names[1])).value();
+        {
+          auto transaction = transaction::Transaction{&dal};
+          for (uint32_t i = 0; i < data_size / 2; i++)
+            collection->put(key(i), value(names[1], i)).map_error([&](const auto && error) { return error.panic(); });
+          transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+        }
+
+        check(dal, names[1], data_size / 2);
+        if (dal.freelist.max_page > max_page)
+          fatal("the pages of the dropped collection were not reused");
+
+        spdlog::info(
+          "{} collections of {} items in {} pages, copy on write {}",
+          names.size(),
+          data_size,
+          dal.freelist.max_page,
+          copy_on_write);
+
+        std::filesystem::remove(dal.path);
+        dal.close();
+      }
+    }
+
+  return 0;
+}
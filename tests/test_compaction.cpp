@@ -0,0 +1,111 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "utils.h"
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 10000;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  const auto key = [](const uint32_t i) {
+    const auto key = fmt::format("Key{:06}", i);
+    return std::vector<uint8_t>{key.begin(), key.end()};
+  };
+
+  const auto check = [&](const Collection & collection, const uint32_t extra) {
+    for (uint32_t i = 0; i < data_size + extra; i++)
+      collection.find(key(i))
+        .map([&](const auto && item) {
+          if ((i % 10 == 0 || i >= data_size) != (item != tl::nullopt))
+            fatal(fmt::format("Key{:06} was lost or brought back by the compaction", i));
+          if (item != tl::nullopt && item->value != key(i))
+            fatal(fmt::format("the value of Key{:06} changed", i));
+        })
+        .map_error([&](const auto && error) { return error.panic(); });
+  };
+
+  std::filesystem::remove(path);
+
+  auto root = page::Page_num{0};
+  {
+    auto  dal = Data_access_layer{path};
+    auto &collection = *dal.create_collection({'c'}).value();
+
+    for (uint32_t i = 0; i < data_size; i++)
+      collection.put(key(i), key(i)).map_error([&](const auto && error) { return error.panic(); });
+
+    /* Remove nine keys out of ten, the file keeps its size. */
+    for (uint32_t i = 0; i < data_size; i++)
+      if (i % 10 != 0)
+        collection.remove(key(i)).map_error([&](const auto && error) { return error.panic(); });
+
+    dal.flush().map_error([&](const auto && error) { return error.panic(); });
+
+    const auto size = utils::Filesystem::sizeof_file(dal.path);
+    const auto before = collection.locality().value();
+
+    /* The collection is read between the steps, and a put between two steps
+     * restarts the compaction. */
+    auto compaction = Compaction{&collection, 0.75f};
+    auto steps = uint32_t{0};
+    for (auto complete = false; !complete; steps++)
+      {
+        complete = compaction.step(1).value();
+        check(collection, steps > 2 ? 1 : 0);
+
+        if (steps == 2)
+          collection.put(key(data_size), key(data_size)).map_error([&](const auto && error) {
+            return error.panic();
+          });
+      }
+
+    const auto after = collection.locality().value();
+    spdlog::info(
+      "compacted in {} steps and {} restarts: {}KB to {}KB, {} leaves to {}, fragmentation {:.2f} "
+      "to {:.2f}",
+      steps,
+      compaction.restarts,
+      size,
+      utils::Filesystem::sizeof_file(dal.path),
+      before.leaves,
+      after.leaves,
+      before.fragmentation(),
+      after.fragmentation());
+
+    if (compaction.restarts != 1)
+      fatal("the put between two steps did not restart the compaction");
+
+    if (utils::Filesystem::sizeof_file(dal.path) * 4 > size)
+      fatal("the file was not truncated after the compaction");
+
+    if (after.leaves * 4 > before.leaves || after.fragmentation() > before.fragmentation())
+      fatal("the leaves were not rewritten densely and in order");
+
+    /* The compacted collection is still modified as usual. */
+    collection.put(key(data_size + 1), key(data_size + 1))
+      .map_error([&](const auto && error) { return error.panic(); });
+    check(collection, 2);
+    root = collection.root;
+  }
+
+  /* The compacted collection is read back from the catalog. */
+  {
+    auto       dal = Data_access_layer{path};
+    const auto collection = dal.get_collection({'c'}).value();
+
+    if (collection == nullptr || collection->root != root)
+      fatal("the catalog did not follow the compacted collection");
+
+    check(*collection, 2);
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "cursor.h"
+#include <random>
+#include <set>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::cursor;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 10000;
+  const auto collection_name = std::string{"collection1"};
+
+  auto dal = Data_access_layer{__FILE_NAME__ ".db"};
+  auto collection = Collection{
+    &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, dal.meta.root};
+
+  auto cursor = Cursor{&collection};
+  if (cursor.first().value() || cursor.seek({}).value())
+    fatal("the cursor of an empty collection should not find anything");
+
+  /* Insert in random order and remove a third of the keys, so the tree has
+   * several levels of leaves and rebalanced nodes. */
+  auto keys = std::set<std::string>{};
+  auto random = std::mt19937{42};
+  for (uint32_t i = 0; i < data_size; i++)
+    {
+      const auto key = fmt::format("Key{:05}", random() % (data_size * 2));
+      keys.insert(key);
+      collection.put({key.begin(), key.end()}, {key.begin(), key.end()})
+        .map_error([&](const auto && error) { return error.panic(); });
+    }
+
+  for (auto key = keys.begin(); key != keys.end();)
+    if (random() % 3 == 0)
+      {
+        collection.remove({key->begin(), key->end()})
+          .map_error([&](const auto && error) { return error.panic(); });
+        key = keys.erase(key);
+      }
+    else
+      ++key;
+
+  const auto to_string = [&] { return std::string{cursor.key().begin(), cursor.key().end()}; };
+
+  /* Forward and backward scans visit every key in order. */
+  auto expected = keys.begin();
+  for (auto valid = cursor.first().value(); valid; valid = cursor.next().value())
+    if (expected == keys.end() || to_string() != *expected++)
+      fatal("the forward scan is out of order");
+  if (expected != keys.end())
+    fatal("the forward scan missed keys");
+
+  auto expected_backward = keys.rbegin();
+  for (auto valid = cursor.last().value(); valid; valid = cursor.prev().value())
+    if (expected_backward == keys.rend() || to_string() != *expected_backward++)
+      fatal("the backward scan is out of order");
+  if (expected_backward != keys.rend())
+    fatal("the backward scan missed keys");
+
+  /* seek lands on the key or the next greater one, and the cursor can then
+   * move both ways. */
+  for (uint32_t i = 0; i < data_size * 2; i += 7)
+    {
+      const auto key = fmt::format("Key{:05}", i);
+      const auto greater_or_equal = keys.lower_bound(key);
+      const auto valid = cursor.seek(std::vector<uint8_t>{key.begin(), key.end()}).value();
+
+      if (greater_or_equal == keys.end())
+        {
+          if (valid)
+            fatal(fmt::format("nothing should be found after {}", key));
+          continue;
+        }
+
+      if (!valid || to_string() != *greater_or_equal)
+        fatal(fmt::format("seek {} should find {}", key, *greater_or_equal));
+
+      const auto previous = cursor.prev().value();
+      if (greater_or_equal == keys.begin() ? previous
+                                           : !previous || to_string() != *std::prev(greater_or_equal))
+        fatal(fmt::format("prev after seek {} is wrong", key));
+
+      if (previous && (!cursor.next().value() || to_string() != *greater_or_equal))
+        fatal(fmt::format("next after prev after seek {} is wrong", key));
+    }
+
+  std::filesystem::remove(dal.path);
+  dal.close();
+
+  return 0;
+}
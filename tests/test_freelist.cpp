@@ -0,0 +1,142 @@
+#include "data_access_layer.h"
+#include "collection.h"
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  /* Past the 65,535 pages the freelist used to be limited to, and more
+   * released pages than a single page holds. */
+  const auto pages_count = 100000;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  std::filesystem::remove(path);
+
+  /* Released pages are coalesced into extents, and allocations near a hint
+   * take the closest released page of its block or grow the file by a block. */
+  {
+    auto freelist = freelist::Freelist{};
+    for (uint32_t i = 0; i < 100; i++)
+      static_cast<void>(freelist.get_next_page());
+
+    for (const Page_num page : {14, 10, 12, 11, 13, 50, 52, 51})
+      freelist.release_page(page);
+
+    if (
+      freelist.released_pages != std::map<Page_num, Page_num>{{10, 5}, {50, 3}}
+      || freelist.released_count() != 8)
+      fatal("the released pages were not coalesced into extents");
+
+    if (freelist.get_next_page(48) != 50 || freelist.get_next_page(15) != 14)
+      fatal("the released pages closest to the hints were not taken");
+
+    /* The block after max_page starts at 112. */
+    if (freelist.get_next_page(90) != 112 || freelist.get_next_page(112) != 113)
+      fatal("the file did not grow by a block for a hint far from the released pages");
+
+    if (freelist.max_page != 127 || !freelist.is_released(102) || !freelist.is_released(127))
+      fatal("the file did not grow by a whole aligned block");
+
+    if (freelist.get_next_page() != 10)
+      fatal("an allocation without hint did not take the lowest released page");
+  }
+
+  /* The extents are rebuilt a word of the bitmap at a time: runs crossing
+   * the words and the pages of the chain, and a last run ending at max_page. */
+  {
+    const auto capacity = types::Serializer<freelist::Freelist>::capacity(Page::DEFAULT_PAGE_SIZE, true);
+
+    auto freelist = freelist::Freelist{};
+    freelist.max_page = capacity * 3 + 100;
+    freelist.reserve_pages(Page::DEFAULT_PAGE_SIZE);
+    for (const auto & [first, count] : std::vector<std::pair<Page_num, Page_num>>{
+           {2, 1}, {60, 10}, {127, 64}, {capacity - 5, 200}, {capacity * 2, 1}, {freelist.max_page - 70, 71}})
+      freelist.release_extent(first, count);
+
+    const auto data = types::Serializer<freelist::Freelist>::serialize(freelist).and_then([&](const auto & data) {
+      return types::Serializer<freelist::Freelist>::deserialize(data, freelist.pages);
+    });
+
+    if (!data.has_value() || !(data.value() == freelist) || data->released_count() != freelist.released_count())
+      fatal("the extents of the freelist were not rebuilt from its bitmap");
+  }
+
+  auto freelist = freelist::Freelist{};
+  {
+    auto dal = Data_access_layer{path};
+
+    auto pages = std::vector<Page_num>{};
+    for (uint32_t i = 0; i < pages_count; i++)
+      pages.push_back(dal.freelist.get_next_page());
+
+    for (uint32_t i = 0; i < pages_count; i += 2)
+      dal.freelist.release_page(pages[i]);
+
+    dal.write_freelist()
+      .and_then([&](const auto && _) { return dal.commit(); })
+      .map_error([&](const auto && error) { return error.panic(); });
+
+    spdlog::info(
+      "{} released pages written in {} freelist pages",
+      dal.freelist.released_count(),
+      dal.freelist.pages.size());
+
+    if (dal.freelist.pages.size() < 2)
+      fatal("the released pages should not fit in a single freelist page");
+
+    /* Releasing and reusing a few pages only writes the pages of the chain
+     * that changed. */
+    for (uint32_t i = 0; i < 10; i++)
+      {
+        const auto pages_written = dal.statistics.pages_written;
+
+        dal.freelist.release_page(pages[i * 2 + 1]);
+        if (i % 2 == 0)
+          static_cast<void>(dal.freelist.get_next_page());
+
+        dal.write_freelist().map_error([&](const auto && error) { return error.panic(); });
+
+        if (dal.statistics.pages_written - pages_written > 2)
+          fatal(fmt::format(
+            "{} freelist pages were written for a single released page",
+            dal.statistics.pages_written - pages_written));
+      }
+
+    freelist = dal.freelist;
+    dal.commit().map_error([&](const auto && error) { return error.panic(); });
+  }
+
+  /* The freelist is read back entirely, max_page included. */
+  {
+    auto dal = Data_access_layer{path};
+
+    if (!(dal.freelist == freelist))
+      fatal(fmt::format(
+        "the freelist was not read back: max_page {} instead of {}, {} released pages instead of {}",
+        dal.freelist.max_page,
+        freelist.max_page,
+        dal.freelist.released_count(),
+        freelist.released_count()));
+
+    /* The released pages are reused before the file grows. */
+    const auto max_page = dal.freelist.max_page;
+    auto       collection = Collection{&dal, {'c'}, dal.meta.root};
+    for (uint32_t i = 0; i < 1000; i++)
+      {
+        const auto key = fmt::format("Key{}", i);
+        collection.put({key.begin(), key.end()}, {key.begin(), key.end()})
+          .map_error([&](const auto && error) { return error.panic(); });
+      }
+
+    if (dal.freelist.max_page != max_page)
+      fatal(fmt::format("the collection grew the file from {} to {} instead of reusing the released pages", max_page, dal.freelist.max_page));
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  return 0;
+}
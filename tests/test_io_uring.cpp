@@ -0,0 +1,140 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "cursor.h"
+#include "storage.h"
+#include "transaction.h"
+#include <chrono>
+#include <fstream>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::storage;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto pages_count = 8192, data_size = 20000, batch_size = 500;
+  const auto page_size = Page::DEFAULT_PAGE_SIZE;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  const auto key = [](const uint32_t i) {
+    const auto key = fmt::format("Key{:06}", i);
+    return std::vector<uint8_t>{key.begin(), key.end()};
+  };
+
+  /* The same pages written and read back as batches, by File_storage one
+   * after the other and by Uring_storage through the queue. */
+  const auto batches = [&](Storage & storage) {
+    auto pages = std::vector<std::vector<uint8_t>>(pages_count, std::vector<uint8_t>(page_size));
+    auto writes = std::vector<Write_request>{};
+    for (Page_num page_num = 0; page_num < pages_count; page_num++)
+      {
+        std::fill(pages[page_num].begin(), pages[page_num].end(), static_cast<uint8_t>(page_num));
+        writes.push_back({page_num, pages[page_num]});
+      }
+
+    const auto start = std::chrono::steady_clock::now();
+    storage.write_batch(writes).map_error([&](const auto && error) { return error.panic(); });
+
+    auto reads = std::vector<Read_request>{};
+    for (Page_num page_num = 0; page_num < pages_count; page_num++)
+      {
+        std::fill(pages[page_num].begin(), pages[page_num].end(), 0);
+        reads.push_back({page_num, pages[page_num]});
+      }
+
+    storage.read_batch(reads).map_error([&](const auto && error) { return error.panic(); });
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    for (Page_num page_num = 0; page_num < pages_count; page_num++)
+      if (std::count(pages[page_num].begin(), pages[page_num].end(), static_cast<uint8_t>(page_num))
+          != page_size)
+        fatal(fmt::format("page {} was not read back from its batch", page_num));
+
+    /* A batch reaching past the end of the file fails like read does. */
+    auto page = std::vector<uint8_t>(page_size);
+    auto past_end = std::vector<Read_request>{{0, page}, {pages_count + 1, page}};
+    if (storage.read_batch(past_end).has_value())
+      fatal("a batch read a page past the end of the file");
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+  };
+
+  std::filesystem::remove(path);
+  std::ofstream{path}.close();
+  const auto file_time = [&] {
+    auto storage = File_storage{path, page_size};
+    return batches(storage);
+  }();
+
+  std::filesystem::remove(path);
+  std::ofstream{path}.close();
+  auto storage = Uring_storage{path, page_size};
+  const auto uring_time = batches(storage);
+  spdlog::info(
+    "{} pages written and read in {}ms with pread and pwrite, in {}ms with {}",
+    pages_count,
+    file_time,
+    uring_time,
+    storage.is_batched() ? "io_uring" : "the fallback");
+  storage.close();
+  std::filesystem::remove(path);
+
+  /* The commits without page cache, and the prefetching of a scan with it,
+   * go through the batches. */
+  for (const auto page_cache_capacity : {0u, Options::DEFAULT_PAGE_CACHE_CAPACITY})
+    {
+      const auto options = Options{
+        .page_size = page_size,
+        .min_fill_percent = 0.125f,
+        .max_fill_percent = 0.125f,
+        .page_cache_capacity = page_cache_capacity,
+        .storage_backend = Backend::IO_URING};
+
+      {
+        auto  dal = Data_access_layer{path, options};
+        auto &collection = *dal.create_collection({'c'}).value();
+
+        for (uint32_t first = 0; first < data_size; first += batch_size)
+          {
+            auto transaction = transaction::Transaction{&dal};
+            for (uint32_t i = first; i < first + batch_size; i++)
+              collection.put(key(i), key(i)).map_error([&](const auto && error) { return error.panic(); });
+
+            transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+          }
+      }
+
+      {
+        auto       dal = Data_access_layer{path, options};
+        const auto collection = dal.get_collection({'c'}).value();
+        if (collection == nullptr)
+          fatal("the collection was not read back from the catalog");
+
+        auto cursor = cursor::Cursor{collection};
+
+        auto count = uint32_t{0};
+        for (auto valid = cursor.first().value(); valid; valid = cursor.next().value(), count++)
+          {
+            const auto value = cursor.value().value();
+            if (!std::ranges::equal(cursor.key(), key(count)) || !std::ranges::equal(value, key(count)))
+              fatal(fmt::format("Key{:06} was not read back", count));
+          }
+
+        if (count != data_size)
+          fatal(fmt::format("{} keys were scanned instead of {}", count, data_size));
+
+        spdlog::info(
+          "{} keys scanned with a page cache of {} pages, {} pages prefetched",
+          count,
+          page_cache_capacity,
+          dal.statistics.pages_prefetched);
+
+        std::filesystem::remove(dal.path);
+        dal.close();
+      }
+    }
+
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include "data_access_layer.h"
+#include "collection.h"
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 20000;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  std::filesystem::remove(path);
+
+  auto dal = Data_access_layer{path, builtin_options::BEST_PERFORMANCE};
+  auto collections = std::vector<Collection>{};
+  collections.emplace_back(&dal, std::vector<uint8_t>{'a'}, 0);
+  collections.emplace_back(&dal, std::vector<uint8_t>{'b'}, 0);
+
+  /* The collections grow at the same time, with increasing keys, so their
+   * pages would alternate if they were allocated one after the other. */
+  for (uint32_t i = 0; i < data_size; i++)
+    for (auto & collection : collections)
+      {
+        const auto key = fmt::format("Key{:06}", i);
+        collection.put({key.begin(), key.end()}, {key.begin(), key.end()})
+          .map_error([&](const auto && error) { return error.panic(); });
+      }
+
+  for (const auto & collection : collections)
+    collection.locality()
+      .map([&](const auto && locality) {
+        spdlog::info(
+          "collection {}: {} leaves, {} sequential, fragmentation {:.2f}, average distance {:.2f} "
+          "pages",
+          static_cast<char>(collection.name.front()),
+          locality.leaves,
+          locality.sequential,
+          locality.fragmentation(),
+          locality.average_distance());
+
+        /* The leaves of a collection are allocated from its own extents. */
+        if (locality.fragmentation() > 0.25 || locality.average_distance() > 4)
+          fatal("the leaves of the collection are scattered");
+      })
+      .map_error([&](const auto && error) { return error.panic(); });
+
+  std::filesystem::remove(dal.path);
+  dal.close();
+
+  return 0;
+}
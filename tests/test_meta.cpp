@@ -0,0 +1,145 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "transaction.h"
+#include <fstream>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+static auto bytes(const std::string & string) -> std::vector<uint8_t> { return {string.begin(), string.end()}; }
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 2000;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+  const auto options = Options{
+    .page_size = Page::DEFAULT_PAGE_SIZE,
+    .min_fill_percent = 0.125f,
+    .max_fill_percent = 0.125f,
+    .write_ahead_log = false};
+
+  const auto key = [](const uint32_t i) { return bytes(fmt::format("Key{:05}", i)); };
+
+  const auto check = [&](Data_access_layer & dal, const uint32_t count) {
+    auto * collection = dal.get_collection(bytes("c")).map_error([&](const auto && error) {
+      return error.panic();
+    }).value();
+    if (collection == nullptr)
+      fatal("the collection was not found");
+
+    for (uint32_t i = 0; i < count; i++)
+      collection->find(key(i))
+        .map([&](const auto && item) {
+          if (item == tl::nullopt || item->value != key(i))
+            fatal(fmt::format("the item {} was not read back", i));
+        })
+        .map_error([&](const auto && error) { return error.panic(); });
+  };
+
+  std::filesystem::remove(path);
+
+  /* One put per transaction: the roots of the collection move as its leaves
+   * split, but the meta is only written when the catalog or the freelist
+   * moves with them. */
+  auto generation = uint64_t{};
+  {
+    auto dal = Data_access_layer{path, options};
+    dal.create_collection(bytes("c")).map_error([&](const auto && error) { return error.panic(); });
+
+    const auto first_generation = dal.meta.generation;
+    for (uint32_t i = 0; i < data_size; i++)
+      dal.get_collection(bytes("c"))
+        .and_then([&](auto * collection) { return collection->put(key(i), key(i)); })
+        .map_error([&](const auto && error) { return error.panic(); });
+
+    if (dal.meta.generation - first_generation > data_size / 10)
+      fatal(fmt::format("the meta was written {} times for {} puts", dal.meta.generation - first_generation, data_size));
+
+    spdlog::info("{} puts wrote the meta {} times", data_size, dal.meta.generation - first_generation);
+
+    /* The last generation overwrites the copy of the one before it. */
+    dal.write_meta(dal.meta).map_error([&](const auto && error) { return error.panic(); });
+    dal.write_meta(dal.meta).map_error([&](const auto && error) { return error.panic(); });
+    generation = dal.meta.generation;
+  }
+
+  {
+    auto dal = Data_access_layer{path, options};
+    if (dal.meta.generation != generation)
+      fatal("the meta of the highest generation was not loaded");
+    check(dal, data_size);
+  }
+
+  /* A write of the meta torn by a crash leaves the previous generation. */
+  {
+    auto file = std::fstream{path, std::ios::in | std::ios::out | std::ios::binary};
+    file.seekp(static_cast<std::streamoff>(generation % meta::Meta::PAGES * Page::DEFAULT_PAGE_SIZE + 8));
+    file.write("torn", 4);
+  }
+
+  {
+    auto dal = Data_access_layer{path, options};
+    if (dal.meta.generation != generation - 1)
+      fatal(fmt::format("the generation {} was loaded instead of {}", dal.meta.generation, generation - 1));
+    check(dal, data_size);
+
+    /* The next write goes to the page of the torn copy. */
+    dal.write_meta(dal.meta).map_error([&](const auto && error) { return error.panic(); });
+    if (dal.meta.generation != generation)
+      fatal("the torn copy of the meta was not overwritten");
+  }
+
+  {
+    auto dal = Data_access_layer{path, options};
+    if (dal.meta.generation != generation)
+      fatal("the rewritten meta was not loaded");
+    check(dal, data_size);
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  /* With copy on write and no write-ahead log, the file holds the last
+   * commit, pages and meta, as soon as it returns: a copy taken then, as a
+   * crash would leave it, opens on the committed tree. */
+  {
+    const auto copy_on_write_options = Options{
+      .page_size = Page::DEFAULT_PAGE_SIZE,
+      .min_fill_percent = 0.125f,
+      .max_fill_percent = 0.125f,
+      .write_ahead_log = false,
+      .copy_on_write = true};
+    const auto copy_path = path + ".copy";
+
+    auto dal = Data_access_layer{path, copy_on_write_options};
+    dal.create_collection(bytes("c")).map_error([&](const auto && error) { return error.panic(); });
+
+    {
+      auto transaction = transaction::Transaction{&dal};
+      for (uint32_t i = 0; i < data_size; i++)
+        dal.get_collection(bytes("c"))
+          .and_then([&](auto * collection) { return collection->put(key(i), key(i)); })
+          .map_error([&](const auto && error) { return error.panic(); });
+      transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+    }
+
+    std::filesystem::copy_file(path, copy_path, std::filesystem::copy_options::overwrite_existing);
+
+    {
+      auto copy = Data_access_layer{copy_path, copy_on_write_options};
+      if (copy.meta.generation != dal.meta.generation)
+        fatal("the meta of the last commit was not in the file");
+      check(copy, data_size);
+
+      std::filesystem::remove(copy.path);
+      copy.close();
+    }
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  return 0;
+}
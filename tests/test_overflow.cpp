@@ -0,0 +1,150 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "cursor.h"
+#include <algorithm>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::cursor;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 120;
+  const auto collection_name = std::string{"collection1"};
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  /* Values around the old 255 bytes limit, around the inline limit and
+   * spanning many pages, and some keys longer than 255 bytes. */
+  const uint32_t value_sizes[] = {0, 255, 256, 1000, 5000, 100000};
+
+  auto keys = std::vector<std::vector<uint8_t>>{};
+  auto values = std::vector<std::vector<uint8_t>>{};
+  for (uint32_t i = 0; i < data_size; i++)
+    {
+      auto key = fmt::format("Key{:03}", i);
+      if (i % 7 == 0)
+        key.append(300, 'k');
+
+      auto value = std::vector<uint8_t>(value_sizes[i % std::size(value_sizes)]);
+      for (size_t j = 0; j < value.size(); j++)
+        value[j] = static_cast<uint8_t>(i + j);
+
+      keys.emplace_back(key.begin(), key.end());
+      values.push_back(std::move(value));
+    }
+
+  const auto check = [&](const Collection & collection) {
+    for (uint32_t i = 0; i < data_size; i++)
+      {
+        collection.find(keys[i])
+          .map([&](const auto && item) {
+            if (item == tl::nullopt || item->value != values[i] || item->is_overflow())
+              fatal(fmt::format("the value of {} was not read back", i));
+          })
+          .map_error([&](const auto && error) { return error.panic(); });
+      }
+  };
+
+  std::filesystem::remove(path);
+
+  uint64_t overflow_pages = 0;
+  {
+    auto  dal = Data_access_layer{path};
+    auto &collection =
+      *dal.create_collection(std::vector<uint8_t>{collection_name.begin(), collection_name.end()}).value();
+
+    for (uint32_t i = 0; i < data_size; i++)
+      collection.put(keys[i], values[i]).map_error([&](const auto && error) {
+        return error.panic();
+      });
+
+    check(collection);
+
+    /* The cursor reads the values of the overflow chains too. */
+    auto cursor = Cursor{&collection};
+    auto count = uint32_t{0};
+    for (auto valid = cursor.first().value(); valid; valid = cursor.next().value(), count++)
+      {
+        const auto key = cursor.key();
+        const auto i = std::stoul(std::string{key.begin() + 3, key.begin() + 6});
+        const auto value = cursor.value().value();
+
+        if (!std::ranges::equal(value, values[i]) || cursor.item().value().value != values[i])
+          fatal(fmt::format("the cursor did not read the value of {}", i));
+      }
+
+    if (count != data_size)
+      fatal(fmt::format("the cursor visited {} items instead of {}", count, data_size));
+
+    /* A key must stay in its node. */
+    if (collection.put(std::vector<uint8_t>(dal.max_key_size() + 1, 'k'), {}).has_value())
+      fatal("a key larger than the maximum key size was put");
+
+    const auto page_data_size = dal.options.page_size - sizeof(Page_num);
+    for (uint32_t i = 0; i < data_size; i++)
+      if (keys[i].size() + values[i].size() > dal.max_item_size())
+        overflow_pages += (values[i].size() + page_data_size - 1) / page_data_size;
+
+    /* Replacing a large value by a small one and back releases and reuses
+     * the pages of the chains. */
+    const auto max_page = dal.freelist.max_page;
+    for (uint32_t i = 0; i < data_size; i++)
+      collection.put(keys[i], {}).map_error([&](const auto && error) { return error.panic(); });
+
+    if (dal.freelist.released_count() < overflow_pages)
+      fatal("the overflow chains of the replaced values were not released");
+
+    for (uint32_t i = 0; i < data_size; i++)
+      collection.put(keys[i], values[i]).map_error([&](const auto && error) {
+        return error.panic();
+      });
+
+    if (dal.freelist.max_page > max_page + max_page / 10)
+      fatal("the released overflow pages were not reused");
+
+    check(collection);
+  }
+
+  /* Scanning the keys and finding a small value do not read the overflow pages. */
+  {
+    auto       dal = Data_access_layer{path};
+    const auto opened =
+      dal.get_collection(std::vector<uint8_t>{collection_name.begin(), collection_name.end()}).value();
+    if (opened == nullptr)
+      fatal("the collection was not read back from the catalog");
+
+    auto &collection = *opened;
+    auto  cursor = Cursor{&collection};
+    auto count = uint32_t{0};
+    for (auto valid = cursor.first().value(); valid; valid = cursor.next().value())
+      count++;
+
+    collection.find(keys[1]).map_error([&](const auto && error) { return error.panic(); });
+
+    spdlog::info(
+      "{} keys scanned reading {} pages, the values take {} overflow pages",
+      count,
+      dal.statistics.pages_read,
+      overflow_pages);
+
+    /* Only the meta, the freelist and the nodes may have been read. */
+    if (count != data_size || dal.statistics.pages_read + overflow_pages > dal.freelist.max_page + 1)
+      fatal("the key scan read the overflow pages");
+
+    check(collection);
+
+    /* Removing the items releases their overflow chains. */
+    for (uint32_t i = 0; i < data_size; i++)
+      collection.remove(keys[i]).map_error([&](const auto && error) { return error.panic(); });
+
+    if (dal.freelist.released_count() < overflow_pages)
+      fatal("the overflow chains of the removed items were not released");
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include "data_access_layer.h"
+#include "collection.h"
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 10000;
+  const auto collection_name = std::string{"collection1"};
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  /* A deliberately small cache, so pages are evicted and written back while inserting. */
+  const auto options = Options{Page::DEFAULT_PAGE_SIZE, 0.125f, 0.125f, 16};
+
+  std::string keys[data_size], values[data_size];
+
+  for (uint32_t i = 0; i < data_size; i++)
+    {
+      keys[i] = fmt::format("Key{}", i);
+      values[i] = fmt::format("Value{}", i);
+    }
+
+  page::Page_num root = 0;
+  {
+    auto dal = Data_access_layer{path, options};
+    auto collection = Collection{
+      &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, dal.meta.root};
+
+    for (uint32_t i = 0; i < data_size; i++)
+      {
+        collection
+          .put(
+            std::vector<uint8_t>{keys[i].begin(), keys[i].end()},
+            std::vector<uint8_t>{values[i].begin(), values[i].end()})
+          .map_error([&](const auto && error) { return error.panic(); });
+      }
+
+    const auto & statistics = dal.page_cache.get_statistics();
+    spdlog::info(
+      "inserting: {} hits, {} misses, {} evictions, {} write backs",
+      statistics.hits,
+      statistics.misses,
+      statistics.evictions,
+      statistics.write_backs);
+
+    if (dal.page_cache.size() > 16)
+      fatal(fmt::format("page cache holds {} pages, capacity is 16", dal.page_cache.size()));
+
+    root = collection.root;
+  }
+
+  /* Everything must have reached the file when the first data access layer was closed. */
+  auto dal = Data_access_layer{path, options};
+  auto collection = Collection{
+    &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, root};
+
+  for (uint32_t i = 0; i < data_size; i++)
+    {
+      collection.find(std::vector<uint8_t>{keys[i].begin(), keys[i].end()})
+        .map([&](const auto && item) {
+          if (item == tl::nullopt)
+            fatal(fmt::format("{} is nullopt", keys[i]));
+
+          const auto finded_value =
+            std::string{item.value().value.begin(), item.value().value.end()};
+
+          if (values[i] != finded_value)
+            fatal(fmt::format("finded value is {}", finded_value));
+        })
+        .map_error([&](const auto && error) { return error.panic(); });
+    }
+
+  const auto & statistics = dal.page_cache.get_statistics();
+  spdlog::info(
+    "querying: {} hits, {} misses, hit ratio {:.2f}",
+    statistics.hits,
+    statistics.misses,
+    statistics.hit_ratio());
+
+  if (statistics.hits == 0)
+    fatal("the root page was never served from the page cache");
+
+  std::filesystem::remove(dal.path);
+  dal.close();
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "cursor.h"
+#include "node.h"
+#include <numeric>
+#include <random>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::node;
+using namespace toocal::core::page;
+
+static auto bytes(const std::string & string) -> std::vector<uint8_t> { return {string.begin(), string.end()}; }
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 10000;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+  const auto key = [](const uint32_t i) { return bytes(fmt::format("tenant42:eu-west:entity:{:08}", i)); };
+
+  /* The prefix is stored once, the keys are read back whole and searched
+   * on their suffixes, including keys outside of the prefix. */
+  {
+    auto node = Node{std::deque<Item>{}, std::deque<Page_num>{}};
+    for (uint32_t i = 0; i < 100; i++)
+      node.items.push_back(Item{key(i * 2), bytes("value")});
+
+    const auto page = types::Serializer<Node>::serialize(node).map_error([&](const auto && error) {
+      return error.panic();
+    });
+    const auto view = Node_view{page.value()};
+
+    if (!std::ranges::equal(view.prefix(), bytes("tenant42:eu-west:entity:00000")))
+      fatal("the common prefix of the keys was not stored");
+
+    for (uint32_t i = 0; i < 100; i++)
+      if (view.key(i) != key(i * 2) || !std::ranges::equal(view.value(i), bytes("value")))
+        fatal(fmt::format("the item {} was not read back", i));
+
+    for (const auto & searched :
+         {key(0), key(1), key(101), key(198), key(199), key(1000), bytes(""), bytes("tenant"), bytes("z")})
+      if (view.find_key_in_node(searched) != node.find_key_in_node(searched))
+        fatal(fmt::format("{} was not found on the suffixes", std::string{searched.begin(), searched.end()}));
+  }
+
+  /* The fingerprints order the keys like their bytes, and the keys sharing
+   * one, shorter than it or padded with zeros, are told apart on the cells. */
+  {
+    auto node = Node{std::deque<Item>{}, std::deque<Page_num>{}};
+    const auto keys = std::vector<std::vector<uint8_t>>{
+      {}, {0}, {0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0, 1}, {1}, {1, 2, 3, 4}, {1, 2, 3, 4, 0}, {1, 2, 3, 4, 5}, {255}};
+    for (const auto & key : keys)
+      node.items.push_back(Item{key, bytes("value")});
+
+    const auto page = types::Serializer<Node>::serialize(node).map_error([&](const auto && error) {
+      return error.panic();
+    });
+    const auto view = Node_view{page.value()};
+
+    for (uint32_t i = 1; i < keys.size(); i++)
+      if (view.fingerprint(i - 1) > view.fingerprint(i))
+        fatal(fmt::format("the fingerprint of the item {} is not ordered", i));
+
+    for (uint32_t i = 0; i < keys.size(); i++)
+      if (view.find_key_in_node(keys[i]) != std::tuple{true, i})
+        fatal(fmt::format("the item {} was not told apart from the same fingerprint", i));
+
+    for (const auto & searched :
+         {bytes(std::string{"\0\0\0", 3}), bytes(std::string{"\x01\x02\x03\x04\x00\x00", 6}), bytes("\x02")})
+      if (view.find_key_in_node(searched) != node.find_key_in_node(searched))
+        fatal("a key missing from the node was not placed between the same fingerprints");
+  }
+
+  /* A separator is the shortest key after the left one, up to the right one. */
+  if (
+    Node::separator(bytes("tenant:a:0042"), bytes("tenant:b:0001")) != bytes("tenant:b")
+    || Node::separator(bytes("tenant"), bytes("tenant:a")) != bytes("tenant:")
+    || Node::separator(bytes("Key0199"), bytes("Key0200")) != bytes("Key02"))
+    fatal("a separator was not truncated to the first differing byte");
+
+  /* A collection of keys sharing a long prefix, inserted in random order. */
+  std::filesystem::remove(path);
+  auto dal = Data_access_layer{path, builtin_options::BEST_FILE_SIZE};
+  auto collection = Collection{&dal, {'c'}, 0};
+
+  auto order = std::vector<uint32_t>(data_size);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937{42});
+
+  for (const auto i : order)
+    collection.put(key(i), key(i)).map_error([&](const auto && error) { return error.panic(); });
+
+  for (uint32_t i = 0; i < data_size; i++)
+    collection.find(key(i))
+      .map([&](const auto && item) {
+        if (item == tl::nullopt || item->value != key(i))
+          fatal(fmt::format("the item {} was not found", i));
+      })
+      .map_error([&](const auto && error) { return error.panic(); });
+
+  auto cursor = cursor::Cursor{&collection};
+  auto count = uint32_t{0};
+  for (auto valid = cursor.first().value(); valid; valid = cursor.next().value(), count++)
+    if (!std::ranges::equal(cursor.key(), key(count)))
+      fatal(fmt::format("the cursor read another key than {}", count));
+
+  if (count != data_size)
+    fatal(fmt::format("the cursor read {} keys instead of {}", count, data_size));
+
+  /* The separators of the root stop at the first byte telling the leaves
+   * apart, which is often before the last one. */
+  const auto root = dal.get_node(collection.root).value();
+  if (std::ranges::none_of(root.items, [&](const auto & item) { return item.key.size() < key(0).size(); }))
+    fatal("the separators were not truncated");
+
+  spdlog::info("{} keys of {} bytes in {} pages", data_size, key(0).size(), dal.freelist.max_page);
+
+  std::filesystem::remove(dal.path);
+  dal.close();
+  return 0;
+}
@@ -0,0 +1,380 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "snapshot.h"
+#include "transaction.h"
+#include "cursor.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <mutex>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::snapshot;
+using namespace toocal::core::page;
+
+/** Kills the process when a copy of the meta is written, after the pages of
+ ** the commit reached the file. */
+class Crashing_storage final : public storage::File_storage
+{
+public:
+  using File_storage::File_storage;
+
+  [[nodiscard]] auto write(const Page_num page_num, const std::span<const uint8_t> buffer) noexcept
+    -> tl::expected<std::nullptr_t, Error> override
+  {
+    if (page_num < meta::Meta::PAGES)
+      kill(getpid(), SIGKILL);
+    return File_storage::write(page_num, buffer);
+  }
+};
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 2000, generations = 20, readers_count = 4;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+  const auto options = Options{
+    .page_size = Page::DEFAULT_PAGE_SIZE,
+    .min_fill_percent = 0.125f,
+    .max_fill_percent = 0.125f,
+    .copy_on_write = true};
+
+  const auto key = [](const uint32_t i) {
+    const auto key = fmt::format("Key{:05}", i);
+    return std::vector<uint8_t>{key.begin(), key.end()};
+  };
+
+  const auto value = [](const uint32_t generation) {
+    const auto value = fmt::format("Generation{:04}", generation);
+    return std::vector<uint8_t>{value.begin(), value.end()};
+  };
+
+  /* Every generation is committed at once: the odd ones remove the odd keys,
+   * and every key of a snapshot holds the value of the same generation. */
+  const auto check = [&](const Snapshot & snapshot) {
+    auto count = uint32_t{0};
+    auto generation = tl::optional<std::vector<uint8_t>>{};
+
+    snapshot
+      .scan(
+        {},
+        [&](const auto & item) {
+          if (generation == tl::nullopt)
+            generation = item.value;
+          if (item.value != generation.value())
+            fatal("a snapshot saw the items of two generations");
+          count++;
+          return true;
+        })
+      .map_error([&](const auto && error) { return error.panic(); });
+
+    const auto number = std::stoul(std::string{generation->begin() + 10, generation->end()});
+    if (count != (number % 2 == 1 ? data_size / 2 : data_size))
+      fatal(fmt::format("a snapshot of generation {} holds {} items", number, count));
+
+    snapshot.find(key(data_size / 2))
+      .map([&](const auto && item) {
+        if (item == tl::nullopt || item->value != generation.value())
+          fatal("a snapshot found an item of another generation");
+      })
+      .map_error([&](const auto && error) { return error.panic(); });
+
+    return number;
+  };
+
+  std::filesystem::remove(path);
+
+  auto root = page::Page_num{0};
+  {
+    auto  dal = Data_access_layer{path, options};
+    auto &collection = *dal.create_collection({'c'}).value();
+
+    {
+      auto transaction = transaction::Transaction{&dal};
+      for (uint32_t i = 0; i < data_size; i++)
+        collection.put(key(i), value(0)).map_error([&](const auto && error) { return error.panic(); });
+
+      transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+    }
+
+    /* The first snapshot is kept through every generation. */
+    auto first = std::make_unique<Snapshot>(collection);
+
+    auto published_mutex = std::mutex{};
+    auto published = std::make_shared<Snapshot>(collection);
+    auto done = std::atomic<bool>{false};
+    auto checks = std::atomic<uint64_t>{0};
+
+    auto readers = std::vector<std::thread>{};
+    for (uint32_t t = 0; t < readers_count; t++)
+      readers.emplace_back([&] {
+        while (!done)
+          {
+            auto snapshot = [&] {
+              const auto lock = std::lock_guard{published_mutex};
+              return published;
+            }();
+
+            check(*snapshot);
+            checks++;
+          }
+      });
+
+    for (uint32_t generation = 1; generation <= generations; generation++)
+      {
+        {
+          auto transaction = transaction::Transaction{&dal};
+          for (uint32_t i = 0; i < data_size; i++)
+            if (generation % 2 == 1 && i % 2 == 1)
+              collection.remove(key(i)).map_error([&](const auto && error) { return error.panic(); });
+            else
+              collection.put(key(i), value(generation)).map_error([&](const auto && error) {
+                return error.panic();
+              });
+
+          transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+        }
+
+        auto snapshot = std::make_shared<Snapshot>(collection);
+        const auto lock = std::lock_guard{published_mutex};
+        published = std::move(snapshot);
+      }
+
+    done = true;
+    for (auto & reader : readers)
+      reader.join();
+
+    spdlog::info(
+      "{} snapshots checked by {} readers during {} generations, {} pages",
+      checks.load(),
+      readers_count,
+      generations,
+      dal.freelist.max_page);
+
+    if (check(*first) != 0 || check(*published) != generations)
+      fatal("the snapshots did not keep their generation");
+
+    /* Once the snapshots are gone, the retired pages are reused. */
+    first.reset();
+    published.reset();
+    const auto max_page = dal.freelist.max_page;
+    {
+      auto transaction = transaction::Transaction{&dal};
+      if (dal.freelist.released_count() == 0)
+        fatal("the retired pages were not released");
+
+      for (uint32_t i = 0; i < data_size; i++)
+        collection.put(key(i), value(generations)).map_error([&](const auto && error) {
+          return error.panic();
+        });
+
+      transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+    }
+
+    if (dal.freelist.max_page != max_page)
+      fatal("the file grew although the retired pages were released");
+
+    root = collection.root;
+  }
+
+  /* A commit waiting for the fsync of the write-ahead log, here held back
+   * by the commit delay, does not stall the readers of the snapshots. */
+  {
+    const auto commit_delay = std::chrono::milliseconds{200};
+    const auto wal_options = Options{
+      .page_size = Page::DEFAULT_PAGE_SIZE,
+      .min_fill_percent = 0.125f,
+      .max_fill_percent = 0.125f,
+      .write_ahead_log = true,
+      .commit_delay = commit_delay,
+      .copy_on_write = true};
+
+    std::filesystem::remove(path + ".wal");
+    auto dal = Data_access_layer{path + ".wal", wal_options};
+    auto collection = Collection{&dal, {'c'}, 0};
+
+    {
+      auto transaction = transaction::Transaction{&dal};
+      for (uint32_t i = 0; i < data_size; i++)
+        collection.put(key(i), value(0)).map_error([&](const auto && error) { return error.panic(); });
+      transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+    }
+
+    auto snapshot = Snapshot{collection};
+    auto done = std::atomic<bool>{false};
+    auto longest = std::chrono::nanoseconds{};
+    auto reader = std::thread{[&] {
+      while (!done)
+        {
+          const auto start_time = std::chrono::high_resolution_clock::now();
+          snapshot.find(key(data_size / 2)).map_error([&](const auto && error) { return error.panic(); });
+          longest = std::max<std::chrono::nanoseconds>(longest, std::chrono::high_resolution_clock::now() - start_time);
+        }
+    }};
+
+    for (uint32_t generation = 1; generation <= 3; generation++)
+      collection.put(key(generation), value(generation)).map_error([&](const auto && error) {
+        return error.panic();
+      });
+
+    done = true;
+    reader.join();
+
+    spdlog::info(
+      "the longest find of a snapshot took {}us during commits delayed by {}ms",
+      std::chrono::duration_cast<std::chrono::microseconds>(longest).count(),
+      commit_delay.count());
+
+    if (longest > commit_delay / 2)
+      fatal("a find of a snapshot waited for the fsync of a commit");
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  /* The commit finds the nodes to copy from those the transaction modified
+   * and descended through, instead of searching every modified node from the
+   * root of every collection modified. */
+  {
+    const auto collections_count = 8;
+    const auto uncached_options = Options{
+      .page_size = Page::DEFAULT_PAGE_SIZE,
+      .min_fill_percent = 0.125f,
+      .max_fill_percent = 0.125f,
+      .page_cache_capacity = 0,
+      .copy_on_write = true};
+
+    std::filesystem::remove(path + ".catalog");
+    auto dal = Data_access_layer{path + ".catalog", uncached_options};
+
+    auto collections = std::vector<Collection *>{};
+    for (uint32_t c = 0; c < collections_count; c++)
+      {
+        collections.push_back(dal.create_collection({'c', static_cast<uint8_t>('0' + c)})
+                                .map_error([&](const auto && error) { return error.panic(); })
+                                .value());
+
+        auto transaction = transaction::Transaction{&dal};
+        for (uint32_t i = 0; i < data_size; i++)
+          collections.back()->put(key(i), value(0)).map_error([&](const auto && error) { return error.panic(); });
+        transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+      }
+
+    const auto depth = collections.front()->descend(key(0)).value().nodes.size();
+    auto       pages_read = uint64_t{};
+    for (uint32_t i = 0; i < data_size; i += data_size / 10)
+      {
+        auto transaction = transaction::Transaction{&dal};
+        for (auto * collection : collections)
+          collection->put(key(i), value(1)).map_error([&](const auto && error) { return error.panic(); });
+
+        const auto start_pages_read = dal.statistics.pages_read;
+        transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+        pages_read = std::max(pages_read, dal.statistics.pages_read - start_pages_read);
+      }
+
+    spdlog::info(
+      "a commit of a put in each of {} collections of depth {} read at most {} pages",
+      collections_count,
+      depth,
+      pages_read);
+
+    /* The nodes of every path are read to be copied, and the catalog to
+     * write the new roots. */
+    if (pages_read > 3 * depth * (collections_count + 1))
+      fatal(fmt::format("a commit of {} puts read {} pages", collections_count, pages_read));
+
+    for (uint32_t c = 0; c < collections_count; c++)
+      for (uint32_t i = 0; i < data_size; i++)
+        if (collections[c]->find(key(i)).value()->value != value(i % (data_size / 10) == 0 ? 1 : 0))
+          fatal(fmt::format("the item {} of the collection {} was not read back", i, c));
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  /* The last copied root was written to the catalog. */
+  {
+    auto       dal = Data_access_layer{path, options};
+    const auto collection = dal.get_collection({'c'}).value();
+
+    if (collection == nullptr || collection->root != root)
+      fatal("the catalog did not follow the copied root");
+
+    if (check(Snapshot{*collection}) != generations)
+      fatal("the last generation was not read back");
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  /* A crash once the pages of a commit are written, before its meta, leaves
+   * the committed tree whole: its leaves were not relinked to the copies. */
+  {
+    std::filesystem::remove(path + ".crash");
+    if (const auto pid = fork(); pid == 0)
+      {
+        auto  dal = Data_access_layer{path + ".crash", options};
+        auto &collection = *dal.create_collection({'c'}).value();
+        {
+          auto transaction = transaction::Transaction{&dal};
+          for (uint32_t i = 0; i < data_size; i++)
+            collection.put(key(i), value(0)).map_error([&](const auto && error) { return error.panic(); });
+          transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+        }
+
+        /* Leaves split and copied here and there, between leaves left in place. */
+        dal.storage = std::make_unique<Crashing_storage>(dal.path, options.page_size);
+        auto transaction = transaction::Transaction{&dal};
+        for (uint32_t i = 0; i < data_size; i += 97)
+          {
+            auto between = key(i);
+            between.push_back('x');
+            collection.put(key(i), value(1)).map_error([&](const auto && error) { return error.panic(); });
+            collection.put(between, value(1)).map_error([&](const auto && error) { return error.panic(); });
+          }
+        transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+        _exit(0);
+      }
+    else
+      {
+        auto status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGKILL)
+          fatal("the process did not crash while writing the meta");
+      }
+
+    auto       dal = Data_access_layer{path + ".crash", options};
+    const auto collection = dal.get_collection({'c'}).value();
+    if (collection == nullptr)
+      fatal("the collection was not read back after the crash");
+
+    auto cursor = cursor::Cursor{collection};
+    auto count = uint32_t{0};
+    for (auto valid = cursor.first().value(); valid; valid = cursor.next().value(), count++)
+      if (!std::ranges::equal(cursor.key(), key(count)) || !std::ranges::equal(cursor.value().value(), value(0)))
+        fatal(fmt::format("the scan after the crash did not find Key{:05}", count));
+
+    if (count != data_size)
+      fatal(fmt::format("the scan after the crash visited {} keys instead of {}", count, data_size));
+
+    for (auto valid = cursor.last().value(); valid; valid = cursor.prev().value())
+      count--;
+
+    if (count != 0)
+      fatal("the backward scan after the crash did not visit every committed key once");
+
+    spdlog::info("{} committed keys scanned after a crash before the meta", data_size);
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  return 0;
+}
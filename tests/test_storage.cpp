@@ -0,0 +1,85 @@
+#include "storage.h"
+#include "page.h"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace toocal::core;
+using namespace toocal::core::storage;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto pages_count = 4096, threads_count = 8, rounds = 4;
+  const auto page_size = Page::DEFAULT_PAGE_SIZE;
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  /* Every page is filled with a byte made of its number and the round that
+   * wrote it. */
+  const auto fill = [](const Page_num page_num, const uint32_t round) {
+    return static_cast<uint8_t>(page_num * 7 + round);
+  };
+
+  std::filesystem::remove(path);
+  std::ofstream{path}.close();
+
+  auto storage = File_storage{path, page_size};
+  if (!storage.is_thread_safe())
+    fatal("File_storage must be usable from several threads");
+
+  /* Each thread writes and reads back its own pages, interleaved with the
+   * pages of the others, and reads the pages of the others written by the
+   * previous round. */
+  auto checked = std::atomic<uint64_t>{0};
+  for (uint32_t round = 0; round < rounds; round++)
+    {
+      auto threads = std::vector<std::thread>{};
+      for (uint32_t t = 0; t < threads_count; t++)
+        threads.emplace_back([&, t] {
+          auto buffer = std::vector<uint8_t>(page_size);
+          for (Page_num page_num = t; page_num < pages_count; page_num += threads_count)
+            {
+              std::fill(buffer.begin(), buffer.end(), fill(page_num, round));
+              storage.write(page_num, buffer).map_error([&](const auto && error) {
+                return error.panic();
+              });
+
+              std::fill(buffer.begin(), buffer.end(), 0);
+              storage.read(page_num, buffer).map_error([&](const auto && error) {
+                return error.panic();
+              });
+              if (std::count(buffer.begin(), buffer.end(), fill(page_num, round)) != page_size)
+                fatal(fmt::format("page {} was not read back", page_num));
+
+              const auto other = (page_num + 1) % pages_count;
+              if (round > 0 && storage.read(other, buffer).has_value()
+                  && buffer.front() != fill(other, round - 1) && buffer.front() != fill(other, round))
+                fatal(fmt::format("page {} holds the bytes of another page", other));
+
+              checked++;
+            }
+        });
+
+      for (auto & thread : threads)
+        thread.join();
+    }
+
+  spdlog::info("{} pages written and read by {} threads", checked.load(), threads_count);
+
+  /* Reading past the end of the file is an error, not a short page. */
+  auto buffer = std::vector<uint8_t>(page_size);
+  if (storage.read(pages_count, buffer).has_value())
+    fatal("a page past the end of the file was read");
+
+  storage.truncate(pages_count / 2)
+    .and_then([&](const auto && _) { return storage.sync(); })
+    .map_error([&](const auto && error) { return error.panic(); });
+
+  if (std::filesystem::file_size(path) != pages_count / 2 * page_size)
+    fatal("the file was not truncated");
+
+  storage.close();
+  std::filesystem::remove(path);
+  return 0;
+}
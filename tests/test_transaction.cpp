@@ -0,0 +1,198 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include "transaction.h"
+#include <csignal>
+#include <sys/resource.h>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::transaction;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 1000;
+  const auto collection_name = std::string{"collection1"};
+  const auto path = std::string{__FILE_NAME__ ".db"};
+
+  std::string keys[data_size], values[data_size];
+
+  for (uint32_t i = 0; i < data_size; i++)
+    {
+      keys[i] = fmt::format("Key{}", i);
+      values[i] = fmt::format("Value{}", i);
+    }
+
+  const auto put_all = [&](Collection & collection) {
+    for (uint32_t i = 0; i < data_size; i++)
+      {
+        collection
+          .put(
+            std::vector<uint8_t>{keys[i].begin(), keys[i].end()},
+            std::vector<uint8_t>{values[i].begin(), values[i].end()})
+          .map_error([&](const auto && error) { return error.panic(); });
+      }
+  };
+
+  const auto find_all = [&](const Collection & collection, const bool exist) {
+    for (uint32_t i = 0; i < data_size; i++)
+      {
+        collection.find(std::vector<uint8_t>{keys[i].begin(), keys[i].end()})
+          .map([&](const auto && item) {
+            if ((item != tl::nullopt) != exist)
+              fatal(fmt::format("{} should {}exist", keys[i], exist ? "" : "not "));
+          })
+          .map_error([&](const auto && error) { return error.panic(); });
+      }
+  };
+
+  std::filesystem::remove(path);
+
+  /* Every put commits on its own. */
+  uint64_t autocommit_pages_written = 0;
+  {
+    auto dal = Data_access_layer{path, builtin_options::BEST_PERFORMANCE};
+    auto collection = Collection{
+      &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, dal.meta.root};
+
+    const auto pages_written = dal.statistics.pages_written;
+    put_all(collection);
+    autocommit_pages_written = dal.statistics.pages_written - pages_written;
+
+    find_all(collection, true);
+    std::filesystem::remove(dal.path);
+  }
+
+  /* All the puts in one transaction. */
+  {
+    auto dal = Data_access_layer{path, builtin_options::BEST_PERFORMANCE};
+    auto collection = Collection{
+      &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, dal.meta.root};
+
+    const auto pages_written = dal.statistics.pages_written;
+    auto       transaction = Transaction{&dal};
+    put_all(collection);
+
+    /* The transaction sees its own writes before they are committed. */
+    find_all(collection, true);
+    if (dal.statistics.pages_written != pages_written)
+      fatal("pages were written before the transaction committed");
+
+    transaction.commit().map_error([&](const auto && error) { return error.panic(); });
+    const auto batched_pages_written = dal.statistics.pages_written - pages_written;
+
+    spdlog::info(
+      "{} puts: {} pages written with a commit per put, {} with one transaction",
+      data_size,
+      autocommit_pages_written,
+      batched_pages_written);
+
+    if (batched_pages_written * 10 > autocommit_pages_written)
+      fatal("batching the puts in a transaction did not save enough page writes");
+
+    find_all(collection, true);
+    std::filesystem::remove(dal.path);
+  }
+
+  /* A rolled back transaction leaves no trace. */
+  {
+    auto dal = Data_access_layer{path, builtin_options::BEST_PERFORMANCE};
+    auto collection = Collection{
+      &dal, std::vector<uint8_t>{collection_name.begin(), collection_name.end()}, dal.meta.root};
+
+    const auto root = collection.root;
+    const auto freelist = dal.freelist;
+
+    {
+      auto transaction = Transaction{&dal};
+      put_all(collection);
+      transaction.rollback();
+    }
+
+    if (collection.root != root || !(dal.freelist == freelist))
+      fatal("the rollback did not restore the collection root and the freelist");
+
+    find_all(collection, false);
+
+    /* Leaving the scope of an active transaction rolls it back too. */
+    {
+      auto transaction = Transaction{&dal};
+      put_all(collection);
+    }
+
+    if (dal.transaction != nullptr || collection.root != root)
+      fatal("the destroyed transaction was not rolled back");
+
+    find_all(collection, false);
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  /* A commit whose pages cannot be written, here past the limit of the file
+   * size, is rolled back like any other transaction. Without the page cache
+   * write_pages fails, with it the sync before the meta does, and the pages
+   * the commit put in the page cache are dropped. */
+  for (const auto page_cache_capacity : {uint32_t{0}, Options::DEFAULT_PAGE_CACHE_CAPACITY})
+    {
+      const auto options = Options{
+        .page_size = Page::DEFAULT_PAGE_SIZE,
+        .min_fill_percent = 0.125f,
+        .max_fill_percent = 0.125f,
+        .page_cache_capacity = page_cache_capacity,
+        .copy_on_write = true};
+
+      std::filesystem::remove(path);
+      auto dal = Data_access_layer{path, options};
+      auto & collection = *dal.create_collection({collection_name.begin(), collection_name.end()})
+                             .map_error([&](const auto && error) { return error.panic(); })
+                             .value();
+
+      const auto root = collection.root;
+      const auto meta = dal.meta;
+      const auto freelist = dal.freelist;
+      const auto dirty_pages = dal.page_cache.dirty_pages();
+
+      std::signal(SIGXFSZ, SIG_IGN);
+      auto limit = rlimit{};
+      getrlimit(RLIMIT_FSIZE, &limit);
+      const auto limited = rlimit{std::filesystem::file_size(path), limit.rlim_max};
+      setrlimit(RLIMIT_FSIZE, &limited);
+
+      {
+        auto transaction = Transaction{&dal};
+        put_all(collection);
+        if (transaction.commit().has_value())
+          fatal("the pages of the transaction were written past the file size limit");
+        if (!transaction.is_active() || dal.transaction != &transaction)
+          fatal("the transaction whose pages were not written was ended");
+      }
+
+      setrlimit(RLIMIT_FSIZE, &limit);
+
+      if (collection.root != root || !(dal.meta == meta) || !(dal.freelist == freelist))
+        fatal("the failed commit did not restore the collection root, the meta and the freelist");
+      if (dal.page_cache.dirty_pages() != dirty_pages)
+        fatal("the failed commit left its pages in the page cache");
+
+      find_all(collection, false);
+
+      put_all(collection);
+      find_all(collection, true);
+
+      dal.close();
+
+      /* The pages the freelist hands out after the failed commit are free. */
+      auto reopened = Data_access_layer{path, options};
+      auto & read_back = *reopened.get_collection({collection_name.begin(), collection_name.end()}).value();
+      find_all(read_back, true);
+      put_all(read_back);
+      find_all(read_back, true);
+
+      std::filesystem::remove(reopened.path);
+      reopened.close();
+    }
+
+  return 0;
+}
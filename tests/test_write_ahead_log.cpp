@@ -0,0 +1,232 @@
+#include "data_access_layer.h"
+#include "collection.h"
+#include <csignal>
+#include <fstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace toocal::core;
+using namespace toocal::core::data_access_layer;
+using namespace toocal::core::collection;
+using namespace toocal::core::page;
+
+int main(int argc, char ** argv)
+{
+  const auto data_size = 10000;
+  const auto collection_name = std::string{"collection1"};
+  const auto path = std::string{__FILE_NAME__ ".db"};
+  const auto options = Options{
+    .page_size = Page::DEFAULT_PAGE_SIZE,
+    .min_fill_percent = 0.125f,
+    .max_fill_percent = 0.125f,
+    .write_ahead_log = true};
+
+  std::string keys[data_size], values[data_size];
+
+  for (uint32_t i = 0; i < data_size; i++)
+    {
+      keys[i] = fmt::format("Key{}", i);
+      values[i] = fmt::format("Value{}", i);
+    }
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(path + "-wal");
+
+  /* The child process crashes right after its last commit, without closing
+   * the database, so the committed pages are only in the write-ahead log. */
+  if (const auto pid = fork(); pid == 0)
+    {
+      auto  dal = Data_access_layer{path, options};
+      auto &collection =
+        *dal.create_collection(std::vector<uint8_t>{collection_name.begin(), collection_name.end()}).value();
+
+      const auto start_time = std::chrono::high_resolution_clock::now();
+      for (uint32_t i = 0; i < data_size; i++)
+        {
+          collection
+            .put(
+              std::vector<uint8_t>{keys[i].begin(), keys[i].end()},
+              std::vector<uint8_t>{values[i].begin(), values[i].end()})
+            .map_error([&](const auto && error) { return error.panic(); });
+        }
+      const auto end_time = std::chrono::high_resolution_clock::now();
+
+      const auto statistics = dal.wal->get_statistics();
+      spdlog::info(
+        "{} durable puts in {}ms: {} commits, {} syncs, {} checkpoints",
+        data_size,
+        std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count(),
+        statistics.commits,
+        statistics.syncs,
+        statistics.checkpoints);
+
+      _exit(0);
+    }
+  else
+    {
+      auto status = 0;
+      waitpid(pid, &status, 0);
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        fatal("the crashing process failed");
+    }
+
+  {
+    auto       dal = Data_access_layer{path, options};
+    const auto collection =
+      dal.get_collection(std::vector<uint8_t>{collection_name.begin(), collection_name.end()}).value();
+    if (collection == nullptr)
+      fatal("the collection was not recovered");
+
+    for (uint32_t i = 0; i < data_size; i++)
+      {
+        collection->find(std::vector<uint8_t>{keys[i].begin(), keys[i].end()})
+          .map([&](const auto && item) {
+            if (item == tl::nullopt)
+              fatal(fmt::format("{} was not recovered", keys[i]));
+
+            if (values[i] != std::string{item.value().value.begin(), item.value().value.end()})
+              fatal(fmt::format("the value of {} was not recovered", keys[i]));
+          })
+          .map_error([&](const auto && error) { return error.panic(); });
+      }
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  /* Concurrent commits share the fsync of the leader, each with the pages
+   * of its own batch. */
+  {
+    const auto threads_count = 8, commits_per_thread = 100;
+
+    auto wal = write_ahead_log::Write_ahead_log{
+      path + "-wal", Page::DEFAULT_PAGE_SIZE, std::chrono::microseconds{200}};
+    auto threads = std::vector<std::thread>{};
+
+    for (uint32_t t = 0; t < threads_count; t++)
+      threads.emplace_back([&, t] {
+        auto batch = write_ahead_log::Batch{};
+        for (uint32_t i = 0; i < commits_per_thread; i++)
+          {
+            wal.append(batch, Page{t * commits_per_thread + i, std::vector<uint8_t>(Page::DEFAULT_PAGE_SIZE)});
+            wal.sync(wal.commit(batch)).map_error([&](const auto && error) { return error.panic(); });
+            if (!batch.empty())
+              fatal("the batch was not emptied by its commit");
+          }
+      });
+
+    for (auto & thread : threads)
+      thread.join();
+
+    const auto statistics = wal.get_statistics();
+    spdlog::info("group commit: {} commits, {} syncs", statistics.commits, statistics.syncs);
+
+    if (statistics.syncs >= statistics.commits)
+      fatal("concurrent commits were not grouped");
+
+    std::filesystem::remove(path + "-wal");
+  }
+
+  /* The transactions of writers on several threads take turns, and their
+   * commits share the fsyncs. */
+  {
+    const auto threads_count = 4, puts_per_thread = 250;
+
+    std::filesystem::remove(path);
+    auto dal = Data_access_layer{
+      path,
+      Options{
+        .page_size = Page::DEFAULT_PAGE_SIZE,
+        .min_fill_percent = 0.125f,
+        .max_fill_percent = 0.125f,
+        .write_ahead_log = true,
+        .commit_delay = std::chrono::microseconds{1000}}};
+    auto &collection =
+      *dal.create_collection(std::vector<uint8_t>{collection_name.begin(), collection_name.end()}).value();
+    const auto before = dal.wal->get_statistics();
+
+    auto threads = std::vector<std::thread>{};
+    for (uint32_t t = 0; t < threads_count; t++)
+      threads.emplace_back([&, t] {
+        for (uint32_t i = t; i < threads_count * puts_per_thread; i += threads_count)
+          collection
+            .put(
+              std::vector<uint8_t>{keys[i].begin(), keys[i].end()},
+              std::vector<uint8_t>{values[i].begin(), values[i].end()})
+            .map_error([&](const auto && error) { return error.panic(); });
+      });
+
+    for (auto & thread : threads)
+      thread.join();
+
+    const auto statistics = dal.wal->get_statistics();
+    const auto commits = statistics.commits - before.commits, syncs = statistics.syncs - before.syncs;
+    spdlog::info("{} writers: {} commits, {} syncs", threads_count, commits, syncs);
+
+    if (commits < threads_count * puts_per_thread)
+      fatal("a put was committed by the transaction of another writer");
+    if (syncs >= commits)
+      fatal("the commits of concurrent writers were not grouped");
+
+    for (uint32_t i = 0; i < threads_count * puts_per_thread; i++)
+      collection.find(std::vector<uint8_t>{keys[i].begin(), keys[i].end()})
+        .map([&](const auto && item) {
+          if (item == tl::nullopt || values[i] != std::string{item->value.begin(), item->value.end()})
+            fatal(fmt::format("{} was lost by concurrent writers", keys[i]));
+        })
+        .map_error([&](const auto && error) { return error.panic(); });
+
+    std::filesystem::remove(dal.path);
+    dal.close();
+  }
+
+  /* A write of the log failing half way, here past the limit of the file
+   * size, leaves no torn record behind: its commit is written again by the
+   * next sync, and the commits synced after it are recovered. */
+  {
+    const auto page = [](const uint8_t fill) { return std::vector<uint8_t>(Page::DEFAULT_PAGE_SIZE, fill); };
+
+    std::signal(SIGXFSZ, SIG_IGN);
+    auto limit = rlimit{};
+    getrlimit(RLIMIT_FSIZE, &limit);
+
+    {
+      auto wal = write_ahead_log::Write_ahead_log{path + "-wal", Page::DEFAULT_PAGE_SIZE, std::chrono::microseconds{0}};
+      auto batch = write_ahead_log::Batch{};
+      wal.append(batch, Page{3, page(1)});
+      wal.sync(wal.commit(batch)).map_error([&](const auto && error) { return error.panic(); });
+
+      const auto limited = rlimit{std::filesystem::file_size(path + "-wal") + 100, limit.rlim_max};
+      setrlimit(RLIMIT_FSIZE, &limited);
+      wal.append(batch, Page{4, page(2)});
+      if (wal.sync(wal.commit(batch)).has_value())
+        fatal("a write of the write-ahead log past the file size limit succeeded");
+      setrlimit(RLIMIT_FSIZE, &limit);
+
+      wal.append(batch, Page{5, page(3)});
+      wal.sync(wal.commit(batch)).map_error([&](const auto && error) { return error.panic(); });
+    }
+
+    std::filesystem::remove(path);
+    std::ofstream{path};
+    auto storage = storage::open(storage::Backend::FILE, path, Page::DEFAULT_PAGE_SIZE);
+    auto wal = write_ahead_log::Write_ahead_log{path + "-wal", Page::DEFAULT_PAGE_SIZE, std::chrono::microseconds{0}};
+    wal.recover(*storage).map_error([&](const auto && error) { return error.panic(); });
+
+    for (const auto & [page_num, fill] : {std::pair{3, 1}, std::pair{4, 2}, std::pair{5, 3}})
+      {
+        auto data = std::vector<uint8_t>(Page::DEFAULT_PAGE_SIZE);
+        storage->read(page_num, data).map_error([&](const auto && error) { return error.panic(); });
+        if (data != page(fill))
+          fatal(fmt::format("the page {} was not recovered after a failed write", page_num));
+      }
+
+    storage->close();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+  }
+
+  return 0;
+}